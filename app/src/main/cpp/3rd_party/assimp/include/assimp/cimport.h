@@ -217,6 +217,23 @@ ASSIMP_API const C_STRUCT aiScene* aiApplyPostProcessing(
 	const C_STRUCT aiScene* pScene,
 	unsigned int pFlags);
 
+// --------------------------------------------------------------------------------
+/** Merges vertices of meshes on voxel grid in-place, as #aiProcess_VoxelDownsample does.
+ *
+ * Unlike #aiApplyPostProcessing() works on any modifiable scene, such as a copy
+ * made by aiCopyScene(), so that the imported scene is kept intact.
+ * @param pScene Scene to work on.
+ * @param voxelSize Edge of voxel, takes precedence if positive.
+ * @param targetVertices Number of vertices to fit otherwise.
+ * @param primitiveTypes Bitwise combination of #aiPrimitiveType of processed meshes.
+ * @return Total number of vertices in processed meshes after downsampling.
+ */
+ASSIMP_API unsigned int aiDownsampleScene(
+	C_STRUCT aiScene* pScene,
+	float voxelSize,
+	unsigned int targetVertices,
+	unsigned int primitiveTypes);
+
 // --------------------------------------------------------------------------------
 /** Get one of the predefine log streams. This is the quick'n'easy solution to 
  *  access Assimp's log system. Attaching a log stream can slightly reduce Assimp's
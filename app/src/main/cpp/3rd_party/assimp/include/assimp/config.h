@@ -318,6 +318,68 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #	define AI_SLM_DEFAULT_MAX_VERTICES		1000000
 #endif
 
+// ---------------------------------------------------------------------------
+/** @brief  Store normalization of the ScaleToUnitBox step in the root node.
+ *
+ * Instead of rewriting all vertices, scaling is prepended to the transform of
+ * the root node, the step then only reads the vertices.
+ * Property type: bool. Default value: false.
+ */
+#define AI_CONFIG_PP_SUB_ROOT_TRANSFORM \
+	"PP_SUB_ROOT_TRANSFORM"
+
+// ---------------------------------------------------------------------------
+/** @brief  Set the edge length of a voxel for the VoxelDownsample step.
+ *
+ * Vertices within one voxel are merged. If the value is not positive, the
+ * size is searched to fit #AI_CONFIG_PP_VD_TARGET_VERTICES instead.
+ * Property type: float. Default value: 0.
+ */
+#define AI_CONFIG_PP_VD_VOXEL_SIZE \
+	"PP_VD_VOXEL_SIZE"
+
+// ---------------------------------------------------------------------------
+/** @brief  Set the maximum number of vertices left by the VoxelDownsample step.
+ *
+ * The number is counted over all processed meshes, it is used only when
+ * #AI_CONFIG_PP_VD_VOXEL_SIZE is not set. Zero disables downsampling.
+ * @note The default value is AI_VD_DEFAULT_TARGET_VERTICES
+ * Property type: integer.
+ */
+#define AI_CONFIG_PP_VD_TARGET_VERTICES \
+	"PP_VD_TARGET_VERTICES"
+
+// default value for AI_CONFIG_PP_VD_TARGET_VERTICES
+#if (!defined AI_VD_DEFAULT_TARGET_VERTICES)
+#	define AI_VD_DEFAULT_TARGET_VERTICES		1000000
+#endif
+
+// ---------------------------------------------------------------------------
+/** @brief  Select meshes processed by the VoxelDownsample step.
+ *
+ * This is a bitwise combination of the aiPrimitiveType flags, a mesh is
+ * processed if it has any of the given primitive types.
+ * @note The default value is AI_VD_DEFAULT_PTYPES, all primitive types
+ * Property type: integer.
+ */
+#define AI_CONFIG_PP_VD_PTYPES \
+	"PP_VD_PTYPES"
+
+// default value for AI_CONFIG_PP_VD_PTYPES
+#if (!defined AI_VD_DEFAULT_PTYPES)
+#	define AI_VD_DEFAULT_PTYPES		0xf
+#endif
+
+// ---------------------------------------------------------------------------
+/** @brief  Weight faces by their angle at vertex in the GenIndexedNormals step.
+ *
+ * By default faces are weighted by their area, which is cheaper but lets
+ * long thin triangles dominate the normal.
+ * Property type: bool. Default value: false.
+ */
+#define AI_CONFIG_PP_GIN_ANGLE_WEIGHTED \
+	"PP_GIN_ANGLE_WEIGHTED"
+
 // ---------------------------------------------------------------------------
 /** @brief Set the maximum number of bones affecting a single vertex
  *
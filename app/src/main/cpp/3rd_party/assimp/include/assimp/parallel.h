@@ -0,0 +1,45 @@
+/*
+ * parallel.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alov Maxim <alovmax@yandex.ru>
+ */
+
+/** @file parallel.h
+ *  @brief Lets the application run parallel parts of post processing steps
+ *    on its own threads instead of threads spawned per call.
+ */
+#ifndef AI_PARALLEL_H_INC
+#define AI_PARALLEL_H_INC
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Runs task(data, index) once for each index in [0, tasks) and returns when
+ *  all of them have completed. The calling thread may run some of them itself.
+ */
+typedef void (*aiParallelRunner)( unsigned int tasks,
+    void (*task)( void* data, unsigned int index ), void* data );
+
+/** Installs runner used by post processing steps, NULL restores threads
+ *  spawned per call.
+ *  @param runner The runner, must be safe to call from any thread.
+ *  @param concurrency Number of threads runner executes tasks on, the calling
+ *    one included. Zero means hardware concurrency.
+ */
+ASSIMP_API void aiSetParallelRunner( aiParallelRunner runner, unsigned int concurrency );
+
+/** Returns the installed runner or NULL. */
+ASSIMP_API aiParallelRunner aiGetParallelRunner( void );
+
+/** Returns number of threads parallel parts of post processing steps run on. */
+ASSIMP_API unsigned int aiGetParallelConcurrency( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AI_PARALLEL_H_INC
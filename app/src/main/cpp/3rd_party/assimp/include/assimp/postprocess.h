@@ -534,12 +534,46 @@ enum aiPostProcessSteps
 	 * <hr>This step scales meshes' vertices to unit box obtaining
 	 * center and radius of resulting scene.
 	 *
+	 * Use <tt>#AI_CONFIG_PP_SUB_ROOT_TRANSFORM</tt> to scale the root node
+	 * instead of the vertices.
+	 *
 	 * It is recommended to use this flag with aiProcess_GenNormals or
 	 * aiProcess_GenSmoothNormals to ensure normals being recomputed.
 	 *
 	 * <author> Alov Maxim <alovmaxy@yandex.ru>
 	 */
-	aiProcess_ScaleToUnitBox = 0x8000000
+	aiProcess_ScaleToUnitBox = 0x8000000,
+
+  // -------------------------------------------------------------------------
+	/**
+	 * <hr>This step thins out meshes' vertices on a uniform voxel grid.
+	 *
+	 * Vertices falling into the same voxel are merged into one, their positions,
+	 * normals, colors and texture coordinates are averaged. Faces collapsed
+	 * inside a voxel are removed, points are kept once per voxel. Meshes with
+	 * bones or animation are left intact.
+	 *
+	 * Use <tt>#AI_CONFIG_PP_VD_VOXEL_SIZE</tt> or <tt>#AI_CONFIG_PP_VD_TARGET_VERTICES</tt>
+	 * to control the grid and <tt>#AI_CONFIG_PP_VD_PTYPES</tt> to choose meshes.
+	 *
+	 * <author> Alov Maxim <alovmaxy@yandex.ru>
+	 */
+	aiProcess_VoxelDownsample = 0x10000000,
+
+  // -------------------------------------------------------------------------
+	/**
+	 * <hr>Generates smooth normals through faces' indices, a faster alternative
+	 * to #aiProcess_GenSmoothNormals for large meshes.
+	 *
+	 * Face normals are accumulated at shared positions, vertices with identical
+	 * positions are shared. Faces are weighted by area, or by angle at vertex if
+	 * <tt>#AI_CONFIG_PP_GIN_ANGLE_WEIGHTED</tt> is set. The crease angle is taken
+	 * from <tt>#AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE</tt>, vertices are split
+	 * only where it separates their faces. Meshes having normals are left intact.
+	 *
+	 * <author> Alov Maxim <alovmaxy@yandex.ru>
+	 */
+	aiProcess_GenIndexedNormals = 0x20000000
 };
 
 
@@ -0,0 +1,395 @@
+/*
+ * GenIndexedNormalsProcess.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alov Maxim <alovmax@yandex.ru>
+ */
+
+/// @file GenIndexedNormalsProcess.cpp
+/// Implementation of the GenIndexedNormals postprocessing step
+
+#include "AssimpPCH.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+// internal headers of the post-processing framework
+#include "GenIndexedNormalsProcess.h"
+#include "ParallelHelper.h"
+#include "TinyFormatter.h"
+
+using namespace Assimp;
+
+namespace
+{
+
+/// Minimum number of faces worth a separate thread.
+const unsigned int facesPerThread = 16384;
+
+/// Bit pattern of a position, vertices are shared only if their positions are identical.
+struct PositionKey
+{
+  uint32_t x, y, z;
+
+  bool operator == ( const PositionKey& rhs ) const
+  {
+    return x == rhs.x && y == rhs.y && z == rhs.z;
+  }
+};
+
+struct PositionKeyHash
+{
+  size_t operator () ( const PositionKey& key ) const
+  {
+    return (key.x * 73856093u) ^ (key.y * 19349663u) ^ (key.z * 83492791u);
+  }
+};
+
+inline uint32_t bitsOf( float value )
+{
+  uint32_t bits = 0;
+  if (value != 0.0f) {  // -0 and +0 are the same position
+    std::memcpy(&bits, &value, sizeof(bits));
+  }
+  return bits;
+}
+
+/// Normalizes vectors stored as separate x, y, z arrays. The loop has no
+/// branches and no stride, so that the compiler emits NEON or SSE for it.
+void normalizePacked( float* x, float* y, float* z, unsigned int begin, unsigned int end )
+{
+  for (unsigned int i = begin; i < end; ++i) {
+    float length2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+    float inverse = length2 > 0.0f ? 1.0f / std::sqrt(length2) : 0.0f;
+    x[i] *= inverse;
+    y[i] *= inverse;
+    z[i] *= inverse;
+  }
+}
+
+/// Counting sort of items by their bucket, result is in CSR layout.
+void bucketize( const std::vector<unsigned int>& buckets, unsigned int totalBuckets,
+    std::vector<unsigned int>& starts, std::vector<unsigned int>& items )
+{
+  starts.assign(totalBuckets + 1, 0);
+  for (unsigned int bucket : buckets) {
+    ++starts[bucket + 1];
+  }
+  for (unsigned int b = 0; b < totalBuckets; ++b) {
+    starts[b + 1] += starts[b];
+  }
+  items.resize(buckets.size());
+  std::vector<unsigned int> cursor(starts.begin(), starts.end() - 1);
+  for (unsigned int i = 0; i < buckets.size(); ++i) {
+    items[cursor[buckets[i]]++] = i;
+  }
+}
+
+/// Vertex copy with its own normal, taking over some corners of the original.
+struct Split
+{
+  unsigned int vertex;
+  aiVector3D normal;
+  unsigned int firstCorner;  // in thread's corner list
+  unsigned int totalCorners;
+};
+
+} // end of anonymous namespace
+
+// ------------------------------------------------------------------------------------------------
+// Constructor
+GenIndexedNormalsProcess::GenIndexedNormalsProcess()
+  : mMaxAngle(AI_DEG_TO_RAD(175.0f))
+  , mAngleWeighted(false)
+{
+  // nothing to do here
+}
+
+// ------------------------------------------------------------------------------------------------
+// Destructor
+GenIndexedNormalsProcess::~GenIndexedNormalsProcess()
+{
+  // nothing to do here
+}
+
+// ------------------------------------------------------------------------------------------------
+// Returns whether the processing step is present in the given flag.
+bool GenIndexedNormalsProcess::IsActive( unsigned int pFlags ) const
+{
+  return !!(pFlags & aiProcess_GenIndexedNormals);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Updates internal properties
+void GenIndexedNormalsProcess::SetupProperties( const Importer* pImp )
+{
+  // the same crease angle as for GenSmoothNormals
+  float maxAngle = pImp->GetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 175.0f);
+  mMaxAngle = AI_DEG_TO_RAD(std::max(std::min(maxAngle, 175.0f), 0.0f));
+  mAngleWeighted = pImp->GetPropertyInteger(AI_CONFIG_PP_GIN_ANGLE_WEIGHTED, 0) != 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Executes the post processing step on the given imported data.
+void GenIndexedNormalsProcess::Execute( aiScene* pScene )
+{
+  DefaultLogger::get()->debug("GenIndexedNormalsProcess begin");
+  unsigned int generated = 0;
+  for (unsigned int a = 0; a < pScene->mNumMeshes; ++a) {
+    if (GenMeshNormals(pScene->mMeshes[a], mMaxAngle, mAngleWeighted)) {
+      ++generated;
+    }
+  }
+  if (generated > 0) {
+    DefaultLogger::get()->info((Formatter::format(),
+        "GenIndexedNormalsProcess finished. Vertex normals have been calculated for ", generated, " meshes"));
+  } else {
+    DefaultLogger::get()->debug("GenIndexedNormalsProcess finished. Normals are already there");
+  }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Accumulates weighted face normals at shared positions, splitting vertices at creases.
+bool GenIndexedNormalsProcess::GenMeshNormals( aiMesh* pMesh, float maxAngle, bool angleWeighted )
+{
+  if (pMesh->mNormals != NULL) {
+    return false;
+  }
+  if (!(pMesh->mPrimitiveTypes & (aiPrimitiveType_TRIANGLE | aiPrimitiveType_POLYGON))) {
+    DefaultLogger::get()->info("Normal vectors are undefined for line and point meshes");
+    return false;
+  }
+  const unsigned int numVertices = pMesh->mNumVertices;
+  const unsigned int numFaces = pMesh->mNumFaces;
+  const unsigned int threads = ThreadsFor(numFaces, facesPerThread);
+
+  // shared positions: every vertex refers to the first one with the same position
+  std::vector<unsigned int> positionOf(numVertices);
+  {
+    std::unordered_map<PositionKey, unsigned int, PositionKeyHash> first;
+    first.reserve(numVertices);
+    for (unsigned int i = 0; i < numVertices; ++i) {
+      const aiVector3D& v = pMesh->mVertices[i];
+      PositionKey key = {bitsOf(v.x), bitsOf(v.y), bitsOf(v.z)};
+      positionOf[i] = first.insert(std::make_pair(key, i)).first->second;
+    }
+  }
+
+  // corners of polygons, lines and points have none
+  std::vector<unsigned int> faceCorners(numFaces + 1, 0);
+  for (unsigned int f = 0; f < numFaces; ++f) {
+    unsigned int count = pMesh->mFaces[f].mNumIndices;
+    faceCorners[f + 1] = faceCorners[f] + (count >= 3 ? count : 0);
+  }
+  const unsigned int numCorners = faceCorners[numFaces];
+  std::vector<unsigned int> cornerFace(numCorners);
+  std::vector<unsigned int> cornerVertex(numCorners);
+  std::vector<unsigned int> cornerPosition(numCorners);
+  std::vector<aiVector3D> faceNormals(numFaces);  // unit, to compare against crease angle
+  std::vector<aiVector3D> cornerNormals(numCorners);  // weighted contribution of face to its corner
+  RunChunks(numFaces, threads, [&](unsigned int, unsigned int begin, unsigned int end) {
+    for (unsigned int f = begin; f < end; ++f) {
+      const aiFace& face = pMesh->mFaces[f];
+      if (faceCorners[f + 1] == faceCorners[f]) {
+        continue;
+      }
+      const aiVector3D& v1 = pMesh->mVertices[face.mIndices[0]];
+      const aiVector3D& v2 = pMesh->mVertices[face.mIndices[1]];
+      const aiVector3D& v3 = pMesh->mVertices[face.mIndices[face.mNumIndices - 1]];
+      aiVector3D normal = (v2 - v1) ^ (v3 - v1);  // length is twice the area
+      float length = normal.Length();
+      faceNormals[f] = length > 0.0f ? normal / length : aiVector3D();
+      for (unsigned int k = 0; k < face.mNumIndices; ++k) {
+        unsigned int corner = faceCorners[f] + k;
+        cornerFace[corner] = f;
+        cornerVertex[corner] = face.mIndices[k];
+        cornerPosition[corner] = positionOf[face.mIndices[k]];
+        if (!angleWeighted) {
+          cornerNormals[corner] = normal;
+          continue;
+        }
+        const aiVector3D& v = pMesh->mVertices[face.mIndices[k]];
+        aiVector3D e1 = pMesh->mVertices[face.mIndices[(k + 1) % face.mNumIndices]] - v;
+        aiVector3D e2 = pMesh->mVertices[face.mIndices[(k + face.mNumIndices - 1) % face.mNumIndices]] - v;
+        float lengths = e1.Length() * e2.Length();
+        float angle = lengths > 0.0f ? std::acos(std::max(-1.0f, std::min(1.0f, (e1 * e2) / lengths))) : 0.0f;
+        cornerNormals[corner] = faceNormals[f] * angle;
+      }
+    }
+  });
+
+  std::vector<unsigned int> positionStarts, positionCorners;
+  bucketize(cornerPosition, numVertices, positionStarts, positionCorners);
+  const float qnan = std::numeric_limits<float>::quiet_NaN();
+  pMesh->mNormals = new aiVector3D[numVertices];
+
+  if (maxAngle >= AI_DEG_TO_RAD(175.0f)) {
+    // no crease angle, each position gets the sum of all its corners
+    std::vector<float> x(numVertices, 0.0f), y(numVertices, 0.0f), z(numVertices, 0.0f);
+    RunChunks(numVertices, threads, [&](unsigned int, unsigned int begin, unsigned int end) {
+      for (unsigned int p = begin; p < end; ++p) {
+        for (unsigned int c = positionStarts[p]; c < positionStarts[p + 1]; ++c) {
+          const aiVector3D& n = cornerNormals[positionCorners[c]];
+          x[p] += n.x;  y[p] += n.y;  z[p] += n.z;
+        }
+      }
+      normalizePacked(&x[0], &y[0], &z[0], begin, end);
+    });
+    RunChunks(numVertices, threads, [&](unsigned int, unsigned int begin, unsigned int end) {
+      for (unsigned int i = begin; i < end; ++i) {
+        unsigned int p = positionOf[i];
+        pMesh->mNormals[i] = positionStarts[p] == positionStarts[p + 1] ? aiVector3D(qnan) : aiVector3D(x[p], y[p], z[p]);
+      }
+    });
+    return true;
+  }
+
+  // with crease angle the corners of a vertex are grouped by their face normals,
+  // the first group stays with the vertex, the others go to its copies
+  const float limit = std::cos(maxAngle);
+  const bool canSplit = pMesh->mNumAnimMeshes == 0;  // morph targets would lose their vertices
+  std::vector<unsigned int> vertexStarts, vertexCorners;
+  bucketize(cornerVertex, numVertices, vertexStarts, vertexCorners);
+  std::vector<std::vector<Split> > splits(threads);
+  std::vector<std::vector<unsigned int> > splitCorners(threads);
+  RunChunks(numVertices, threads, [&](unsigned int t, unsigned int begin, unsigned int end) {
+    std::vector<aiVector3D> seeds;
+    std::vector<unsigned int> groups;
+    for (unsigned int i = begin; i < end; ++i) {
+      unsigned int first = vertexStarts[i], last = vertexStarts[i + 1];
+      if (first == last) {
+        pMesh->mNormals[i] = aiVector3D(qnan);
+        continue;
+      }
+      seeds.clear();
+      groups.resize(last - first);
+      for (unsigned int c = first; c < last; ++c) {
+        const aiVector3D& normal = faceNormals[cornerFace[vertexCorners[c]]];
+        unsigned int group = 0;
+        if (normal.SquareLength() > 0.0f) {  // degenerate faces neither seed nor split groups
+          if (!seeds.empty() && seeds[0].SquareLength() == 0.0f) {
+            seeds[0] = normal;
+          }
+          while (canSplit && group < seeds.size() && normal * seeds[group] < limit) {
+            ++group;
+          }
+        }
+        if (group == seeds.size()) {
+          seeds.push_back(normal);
+        }
+        groups[c - first] = group;
+      }
+      unsigned int p = positionOf[i];
+      for (unsigned int group = 0; group < seeds.size(); ++group) {
+        aiVector3D sum;
+        for (unsigned int c = positionStarts[p]; c < positionStarts[p + 1]; ++c) {
+          unsigned int corner = positionCorners[c];
+          if (faceNormals[cornerFace[corner]] * seeds[group] >= limit) {
+            sum += cornerNormals[corner];
+          }
+        }
+        float length = sum.Length();
+        if (length > 0.0f) {
+          sum /= length;
+        }
+        if (group == 0) {
+          pMesh->mNormals[i] = sum;
+          continue;
+        }
+        Split split = {i, sum, (unsigned int)splitCorners[t].size(), 0};
+        for (unsigned int c = first; c < last; ++c) {
+          if (groups[c - first] == group) {
+            splitCorners[t].push_back(vertexCorners[c]);
+            ++split.totalCorners;
+          }
+        }
+        splits[t].push_back(split);
+      }
+    }
+  });
+
+  // copies are appended in order of threads, so the result does not depend on timing
+  std::vector<unsigned int> sources;
+  std::vector<aiVector3D> normals;
+  for (unsigned int t = 0; t < threads; ++t) {
+    for (const Split& split : splits[t]) {
+      unsigned int copy = numVertices + (unsigned int)sources.size();
+      for (unsigned int c = split.firstCorner; c < split.firstCorner + split.totalCorners; ++c) {
+        unsigned int corner = splitCorners[t][c];
+        unsigned int f = cornerFace[corner];
+        pMesh->mFaces[f].mIndices[corner - faceCorners[f]] = copy;
+      }
+      sources.push_back(split.vertex);
+      normals.push_back(split.normal);
+    }
+  }
+  if (!sources.empty()) {
+    DuplicateVertices(pMesh, sources);
+    std::copy(normals.begin(), normals.end(), pMesh->mNormals + numVertices);
+    DefaultLogger::get()->debug((Formatter::format(),
+        "GenIndexedNormalsProcess: ", sources.size(), " vertices split at creases"));
+  }
+  return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Grows all vertex arrays of the mesh by copies of the given vertices.
+void GenIndexedNormalsProcess::DuplicateVertices( aiMesh* pMesh, const std::vector<unsigned int>& sources )
+{
+  const unsigned int numVertices = pMesh->mNumVertices;
+  const unsigned int total = numVertices + (unsigned int)sources.size();
+  auto grow = [&](aiVector3D*& array) {
+    if (array == NULL) {
+      return;
+    }
+    aiVector3D* grown = new aiVector3D[total];
+    std::copy(array, array + numVertices, grown);
+    for (unsigned int i = 0; i < sources.size(); ++i) {
+      grown[numVertices + i] = array[sources[i]];
+    }
+    delete[] array;
+    array = grown;
+  };
+  grow(pMesh->mVertices);
+  grow(pMesh->mNormals);
+  grow(pMesh->mTangents);
+  grow(pMesh->mBitangents);
+  for (unsigned int a = 0; a < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++a) {
+    grow(pMesh->mTextureCoords[a]);
+  }
+  for (unsigned int a = 0; a < AI_MAX_NUMBER_OF_COLOR_SETS; ++a) {
+    if (pMesh->mColors[a] == NULL) {
+      continue;
+    }
+    aiColor4D* grown = new aiColor4D[total];
+    std::copy(pMesh->mColors[a], pMesh->mColors[a] + numVertices, grown);
+    for (unsigned int i = 0; i < sources.size(); ++i) {
+      grown[numVertices + i] = pMesh->mColors[a][sources[i]];
+    }
+    delete[] pMesh->mColors[a];
+    pMesh->mColors[a] = grown;
+  }
+
+  // copies are influenced by the same bones as their originals
+  if (pMesh->HasBones()) {
+    std::vector<unsigned int> copyStarts, copies;
+    bucketize(sources, numVertices, copyStarts, copies);
+    for (unsigned int b = 0; b < pMesh->mNumBones; ++b) {
+      aiBone* bone = pMesh->mBones[b];
+      std::vector<aiVertexWeight> weights(bone->mWeights, bone->mWeights + bone->mNumWeights);
+      for (unsigned int w = 0; w < bone->mNumWeights; ++w) {
+        unsigned int vertex = bone->mWeights[w].mVertexId;
+        for (unsigned int c = copyStarts[vertex]; c < copyStarts[vertex + 1]; ++c) {
+          weights.push_back(aiVertexWeight(numVertices + copies[c], bone->mWeights[w].mWeight));
+        }
+      }
+      delete[] bone->mWeights;
+      bone->mNumWeights = (unsigned int)weights.size();
+      bone->mWeights = new aiVertexWeight[weights.size()];
+      std::copy(weights.begin(), weights.end(), bone->mWeights);
+    }
+  }
+  pMesh->mNumVertices = total;
+}
@@ -0,0 +1,72 @@
+/*
+ * GenIndexedNormalsProcess.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alov Maxim <alovmax@yandex.ru>
+ */
+
+/// @file GenIndexedNormalsProcess.h
+/// Defines a post processing step to compute smooth normals through index buffers
+#ifndef AI_GENINDEXEDNORMALSPROCESS_H_INC
+#define AI_GENINDEXEDNORMALSPROCESS_H_INC
+
+#include "BaseProcess.h"
+
+#include "../include/assimp/mesh.h"
+#include "../include/assimp/scene.h"
+
+namespace Assimp
+{
+
+/** Faster alternative to GenVertexNormalsProcess. Instead of querying a
+ *  SpatialSort around every vertex, face normals are accumulated at shared
+ *  positions through the faces' indices, vertices with bit-identical positions
+ *  are treated as shared. Vertices are split only where the smoothing angle
+ *  separates their faces.
+ */
+class GenIndexedNormalsProcess : public BaseProcess
+{
+public:
+
+  GenIndexedNormalsProcess();
+  ~GenIndexedNormalsProcess();
+
+public:
+  /** Returns whether the processing step is present in the given flag.
+  * @param pFlags The processing flags the importer was called with. A
+  *   bitwise combination of #aiPostProcessSteps.
+  * @return true if the process is present in this flag fields,
+  *   false if not.
+  */
+  bool IsActive( unsigned int pFlags ) const;
+
+  /** Called prior to ExecuteOnScene().
+  * The function is a request to the process to update its configuration
+  * basing on the Importer's configuration property list.
+  */
+  virtual void SetupProperties( const Importer* pImp );
+
+  /// Computes smooth normals of the mesh, if it has none.
+  /// @param maxAngle largest angle in radians between smoothed faces.
+  /// @param angleWeighted weight faces by their angle at vertex instead of area.
+  /// @return true if normals have been generated.
+  static bool GenMeshNormals( aiMesh* pMesh, float maxAngle, bool angleWeighted );
+
+protected:
+  /** Executes the post processing step on the given imported data.
+  * At the moment a process is not supposed to fail.
+  * @param pScene The imported data to work at.
+  */
+  void Execute( aiScene* pScene);
+
+  /// Appends copies of the given vertices with all their attributes and weights.
+  static void DuplicateVertices( aiMesh* pMesh, const std::vector<unsigned int>& sources );
+
+  float mMaxAngle;
+  bool mAngleWeighted;
+};
+
+} // end of namespace Assimp
+
+
+#endif // !!AI_GENINDEXEDNORMALSPROCESS_H_INC
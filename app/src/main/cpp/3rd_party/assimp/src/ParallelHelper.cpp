@@ -0,0 +1,39 @@
+/*
+ * ParallelHelper.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alov Maxim <alovmax@yandex.ru>
+ */
+
+/// @file ParallelHelper.cpp
+/// Implementation of the application provided parallel runner hook
+
+#include "AssimpPCH.h"
+
+#include "ParallelHelper.h"
+
+namespace
+{
+  std::atomic<aiParallelRunner> gRunner(nullptr);
+  std::atomic<unsigned int> gConcurrency(0);
+}
+
+// ------------------------------------------------------------------------------------------------
+ASSIMP_API void aiSetParallelRunner( aiParallelRunner runner, unsigned int concurrency )
+{
+  gConcurrency.store(concurrency);
+  gRunner.store(runner);
+}
+
+// ------------------------------------------------------------------------------------------------
+ASSIMP_API aiParallelRunner aiGetParallelRunner()
+{
+  return gRunner.load();
+}
+
+// ------------------------------------------------------------------------------------------------
+ASSIMP_API unsigned int aiGetParallelConcurrency()
+{
+  unsigned int concurrency = gRunner.load() != nullptr ? gConcurrency.load() : 0;
+  return concurrency > 0 ? concurrency : std::max(1u, std::thread::hardware_concurrency());
+}
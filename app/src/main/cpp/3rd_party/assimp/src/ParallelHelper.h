@@ -0,0 +1,67 @@
+/*
+ * ParallelHelper.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alov Maxim <alovmax@yandex.ru>
+ */
+
+/// @file ParallelHelper.h
+/// Minimal fork-join helpers shared by post processing steps
+#ifndef AI_PARALLELHELPER_H_INC
+#define AI_PARALLELHELPER_H_INC
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../include/assimp/parallel.h"
+
+namespace Assimp
+{
+
+/// Number of threads worth running over the given number of items.
+inline unsigned int ThreadsFor( unsigned int items, unsigned int itemsPerThread )
+{
+  return std::max(1u, std::min(aiGetParallelConcurrency(), items / itemsPerThread));
+}
+
+/// Runs fn(thread_index) on the given number of threads, the calling one included.
+/// Goes through the application runner, when one is installed.
+template <typename Fn>
+void RunThreads( unsigned int threads, Fn fn )
+{
+  if (threads <= 1) {
+    fn(0);
+    return;
+  }
+  if (aiParallelRunner runner = aiGetParallelRunner()) {
+    runner(threads, [](void* data, unsigned int t) { (*static_cast<Fn*>(data))(t); }, &fn);
+    return;
+  }
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (unsigned int t = 1; t < threads; ++t) {
+    workers.push_back(std::thread(fn, t));
+  }
+  fn(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+/// Runs fn(thread_index, begin, end) over contiguous chunks of [0, total).
+template <typename Fn>
+void RunChunks( unsigned int total, unsigned int threads, Fn fn )
+{
+  unsigned int chunk = (total + threads - 1) / threads;
+  RunThreads(threads, [&](unsigned int t) {
+    unsigned int begin = std::min(total, t * chunk);
+    unsigned int end = std::min(total, begin + chunk);
+    fn(t, begin, end);
+  });
+}
+
+} // end of namespace Assimp
+
+#endif // !!AI_PARALLELHELPER_H_INC
@@ -126,6 +126,14 @@ corresponding preprocessor flag to selectively disable steps.
 # include "ScaleToUnitBoxProcess.h"
 #endif
 
+#ifndef ASSIMP_BUILD_NO_VOXELDOWNSAMPLE_PROCESS
+# include "VoxelDownsampleProcess.h"
+#endif
+
+#ifndef ASSIMP_BUILD_NO_GENINDEXEDNORMALS_PROCESS
+# include "GenIndexedNormalsProcess.h"
+#endif
+
 namespace Assimp {
 
 // ------------------------------------------------------------------------------------------------
@@ -197,6 +205,9 @@ void GetPostProcessingStepInstanceList(std::vector< BaseProcess* >& out)
 #if (!defined ASSIMP_BUILD_NO_SCALETOUNITBOX_PROCESS)
 	out.push_back( new ScaleToUnitBoxProcess());
 #endif
+#if (!defined ASSIMP_BUILD_NO_VOXELDOWNSAMPLE_PROCESS)
+	out.push_back( new VoxelDownsampleProcess());
+#endif
 
 	// .........................................................................
 	// DON'T change the order of these five ..
@@ -209,6 +220,9 @@ void GetPostProcessingStepInstanceList(std::vector< BaseProcess* >& out)
 #if (!defined ASSIMP_BUILD_NO_GENVERTEXNORMALS_PROCESS)
 	out.push_back( new GenVertexNormalsProcess());
 #endif
+#if (!defined ASSIMP_BUILD_NO_GENINDEXEDNORMALS_PROCESS)
+	out.push_back( new GenIndexedNormalsProcess());
+#endif
 #if (!defined ASSIMP_BUILD_NO_CALCTANGENTS_PROCESS)
 	out.push_back( new CalcTangentsProcess());
 #endif
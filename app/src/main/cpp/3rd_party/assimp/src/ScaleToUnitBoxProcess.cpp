@@ -12,12 +12,23 @@
 
 // internal headers of the post-processing framework
 #include "ScaleToUnitBoxProcess.h"
+#include "ParallelHelper.h"
+#include "TinyFormatter.h"
 
 using namespace Assimp;
 
+namespace
+{
+
+/// Minimum number of vertices worth a separate thread.
+const unsigned int verticesPerThread = 65536;
+
+} // end of anonymous namespace
+
 // ------------------------------------------------------------------------------------------------
 // Constructor
 ScaleToUnitBoxProcess::ScaleToUnitBoxProcess()
+  : mRootTransform(false)
 {
   // nothing to do here
 }
@@ -40,7 +51,7 @@ bool ScaleToUnitBoxProcess::IsActive( unsigned int pFlags ) const
 // Updates internal properties
 void ScaleToUnitBoxProcess::SetupProperties( const Importer* pImp )
 {
-  // nothing to do here
+  mRootTransform = pImp->GetPropertyInteger(AI_CONFIG_PP_SUB_ROOT_TRANSFORM, 0) != 0;
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -49,7 +60,8 @@ void ScaleToUnitBoxProcess::Execute( aiScene* pScene )
 {
   DefaultLogger::get()->debug("ScaleToUnitBoxProcess begin");
   ScaleScene(pScene);
-  DefaultLogger::get()->info("ScaleToUnitBoxProcess finished. "
+  DefaultLogger::get()->info(mRootTransform ? "ScaleToUnitBoxProcess finished. "
+        "Root transform scales scene to unit box" : "ScaleToUnitBoxProcess finished. "
         "Mesh vertices have been scaled to unit box");
 }
 
@@ -70,18 +82,43 @@ void ScaleToUnitBoxProcess::ScaleMesh( const aiMesh* pMesh ) const
 
 void ScaleToUnitBoxProcess::ScaleScene( aiScene* pScene ) const
 {
-  aiVector3D center = findCenter(pScene);
-  float radius = findRadius(pScene);
-  // TODO: adjust root transform, do not change meshes
+  aiVector3D min, max, center;
+  float radius = 0.0f;
+  if (!FindBounds(pScene, min, max, center, radius) || radius <= 0.0f) {
+    return;
+  }
+  DefaultLogger::get()->debug((Formatter::format(), "ScaleToUnitBoxProcess: radius ", radius,
+      ", box extent ", (max - min).Length()));
+  // vertices are scaled about the origin, so are placements of meshes in the node graph
+  const float factor = 1.0f / radius;
+  if (mRootTransform) {
+    aiMatrix4x4 scaling;
+    aiMatrix4x4::Scaling(aiVector3D(factor, factor, factor), scaling);
+    pScene->mRootNode->mTransformation = scaling * pScene->mRootNode->mTransformation;
+    return;
+  }
   for (unsigned int a = 0; a < pScene->mNumMeshes; ++a) {
     aiMesh* pMesh = pScene->mMeshes[a];
-    for (unsigned int i = 0; i < pMesh->mNumVertices; ++i) {
-      aiVector3D segment = pMesh->mVertices[i];
-      segment -= center;
-      segment /= radius;
-      segment += center / radius;
-      pMesh->mVertices[i].Set(segment.x, segment.y, segment.z);
-    }
+    RunChunks(pMesh->mNumVertices, ThreadsFor(pMesh->mNumVertices, verticesPerThread),
+        [&](unsigned int, unsigned int begin, unsigned int end) {
+      for (unsigned int i = begin; i < end; ++i) {
+        pMesh->mVertices[i] *= factor;
+      }
+    });
+  }
+  ScaleNode(pScene->mRootNode, factor);
+}
+
+void ScaleToUnitBoxProcess::ScaleNode( aiNode* pNode, float factor ) const
+{
+  if (pNode == NULL) {
+    return;
+  }
+  pNode->mTransformation.a4 *= factor;
+  pNode->mTransformation.b4 *= factor;
+  pNode->mTransformation.c4 *= factor;
+  for (unsigned int i = 0; i < pNode->mNumChildren; ++i) {
+    ScaleNode(pNode->mChildren[i], factor);
   }
 }
 
@@ -95,17 +132,6 @@ aiVector3D ScaleToUnitBoxProcess::findCenter( const aiMesh* pMesh ) const
   return center;
 }
 
-aiVector3D ScaleToUnitBoxProcess::findCenter( const aiScene* pScene ) const
-{
-  aiVector3D scene_center = aiVector3D(0.0f, 0.0f, 0.0f);
-  for (unsigned int a = 0; a < pScene->mNumMeshes; ++a) {
-    aiVector3D center = this->findCenter(pScene->mMeshes[a]);
-    scene_center += center;
-  }
-  scene_center /= float(pScene->mNumMeshes);
-  return scene_center;
-}
-
 float ScaleToUnitBoxProcess::findRadius( const aiMesh* pMesh, const aiVector3D& center ) const
 {
   float radius = 0.0f;
@@ -120,20 +146,82 @@ float ScaleToUnitBoxProcess::findRadius( const aiMesh* pMesh, const aiVector3D&
   return radius;
 }
 
-float ScaleToUnitBoxProcess::findRadius( const aiScene* pScene ) const
+// ------------------------------------------------------------------------------------------------
+// Finds box and bounding sphere of the scene as it is drawn: vertices of each mesh are placed by
+// global transforms of all nodes referencing it. Box is found over placed vertices in parallel,
+// sphere is centered in it and its squared radius is found in the second parallel pass.
+bool ScaleToUnitBoxProcess::FindBounds( const aiScene* pScene, aiVector3D& min, aiVector3D& max,
+    aiVector3D& center, float& radius ) const
 {
-  aiVector3D center = findCenter(pScene);
-  float radius = 0.0f;
-  for (unsigned int a = 0; a < pScene->mNumMeshes; ++a) {
-    const aiMesh* pMesh = pScene->mMeshes[a];
-    for (unsigned int i = 0; i < pMesh->mNumVertices; ++i) {
-      aiVector3D distanceValues = center;
-      distanceValues -= pMesh->mVertices[i];
-      float vDistance = distanceValues.Length();
-      if (vDistance > radius) {
-        radius = vDistance;
+  std::vector<std::pair<unsigned int, aiMatrix4x4> > instances;
+  CollectInstances(pScene, pScene->mRootNode, aiMatrix4x4(), instances);
+  if (instances.empty()) {
+    return false;
+  }
+
+  min = aiVector3D(1e10f, 1e10f, 1e10f);
+  max = aiVector3D(-1e10f, -1e10f, -1e10f);
+  for (const std::pair<unsigned int, aiMatrix4x4>& instance : instances) {
+    const aiMesh* pMesh = pScene->mMeshes[instance.first];
+    const aiMatrix4x4& transform = instance.second;
+    unsigned int threads = ThreadsFor(pMesh->mNumVertices, verticesPerThread);
+    std::vector<aiVector3D> mins(threads, min), maxs(threads, max);
+    RunChunks(pMesh->mNumVertices, threads, [&](unsigned int t, unsigned int begin, unsigned int end) {
+      aiVector3D lo = mins[t], hi = maxs[t];
+      for (unsigned int i = begin; i < end; ++i) {
+        const aiVector3D v = transform * pMesh->mVertices[i];
+        lo.x = std::min(lo.x, v.x);  hi.x = std::max(hi.x, v.x);
+        lo.y = std::min(lo.y, v.y);  hi.y = std::max(hi.y, v.y);
+        lo.z = std::min(lo.z, v.z);  hi.z = std::max(hi.z, v.z);
       }
+      mins[t] = lo;  maxs[t] = hi;
+    });
+    for (unsigned int t = 0; t < threads; ++t) {
+      min.x = std::min(min.x, mins[t].x);  max.x = std::max(max.x, maxs[t].x);
+      min.y = std::min(min.y, mins[t].y);  max.y = std::max(max.y, maxs[t].y);
+      min.z = std::min(min.z, mins[t].z);  max.z = std::max(max.z, maxs[t].z);
     }
   }
-  return radius;
+  center = (min + max) * 0.5f;
+
+  float radius2 = 0.0f;
+  for (const std::pair<unsigned int, aiMatrix4x4>& instance : instances) {
+    const aiMesh* pMesh = pScene->mMeshes[instance.first];
+    const aiMatrix4x4& transform = instance.second;
+    unsigned int threads = ThreadsFor(pMesh->mNumVertices, verticesPerThread);
+    std::vector<float> farthest(threads, 0.0f);
+    RunChunks(pMesh->mNumVertices, threads, [&](unsigned int t, unsigned int begin, unsigned int end) {
+      float local = 0.0f;
+      for (unsigned int i = begin; i < end; ++i) {
+        local = std::max(local, (transform * pMesh->mVertices[i] - center).SquareLength());
+      }
+      farthest[t] = local;
+    });
+    for (unsigned int t = 0; t < threads; ++t) {
+      radius2 = std::max(radius2, farthest[t]);
+    }
+  }
+  radius = std::sqrt(radius2);
+  return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Appends meshes with vertices referenced by the node and its children, with their global transforms.
+void ScaleToUnitBoxProcess::CollectInstances( const aiScene* pScene, const aiNode* pNode,
+    const aiMatrix4x4& parent, std::vector<std::pair<unsigned int, aiMatrix4x4> >& instances ) const
+{
+  if (pNode == NULL) {
+    return;
+  }
+  aiMatrix4x4 transform = parent * pNode->mTransformation;
+  for (unsigned int m = 0; m < pNode->mNumMeshes; ++m) {
+    unsigned int index = pNode->mMeshes[m];
+    if (index >= pScene->mNumMeshes || pScene->mMeshes[index]->mNumVertices == 0) {
+      continue;
+    }
+    instances.push_back(std::make_pair(index, transform));
+  }
+  for (unsigned int i = 0; i < pNode->mNumChildren; ++i) {
+    CollectInstances(pScene, pNode->mChildren[i], transform, instances);
+  }
 }
@@ -53,10 +53,23 @@ protected:
   void ScaleMesh( const aiMesh* pMesh ) const;
   void ScaleScene( aiScene* pScene ) const;
 
+  /// Scales translations of the node and its children, so that
+  /// node transforms stay consistent with scaled vertices.
+  void ScaleNode( aiNode* pNode, float factor ) const;
+
   aiVector3D findCenter( const aiMesh* pMesh ) const;
-  aiVector3D findCenter( const aiScene* pScene ) const;
   float findRadius( const aiMesh* pMesh, const aiVector3D& center ) const;
-  float findRadius( const aiScene* pScene ) const;
+
+  /// Computes box and bounding sphere of the scene with meshes placed by node transforms.
+  /// @return false if the scene has no vertices referenced by nodes.
+  bool FindBounds( const aiScene* pScene, aiVector3D& min, aiVector3D& max,
+      aiVector3D& center, float& radius ) const;
+
+  /// Appends meshes referenced by the node and its children with their global transforms.
+  void CollectInstances( const aiScene* pScene, const aiNode* pNode, const aiMatrix4x4& parent,
+      std::vector<std::pair<unsigned int, aiMatrix4x4> >& instances ) const;
+
+  bool mRootTransform;
 };
 
 } // end of namespace Assimp
@@ -0,0 +1,383 @@
+/*
+ * VoxelDownsampleProcess.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alov Maxim <alovmax@yandex.ru>
+ */
+
+/// @file VoxelDownsampleProcess.cpp
+/// Implementation of the VoxelDownsample postprocessing step
+
+#include "AssimpPCH.h"
+
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+// internal headers of the post-processing framework
+#include "VoxelDownsampleProcess.h"
+#include "../include/assimp/cimport.h"
+#include "ParallelHelper.h"
+#include "TinyFormatter.h"
+
+using namespace Assimp;
+
+namespace
+{
+
+/// Voxel coordinates are packed by 21 bits per axis into a single key.
+const uint64_t voxelAxisMask = (1ull << 21) - 1;
+/// Minimum number of vertices worth a separate thread.
+const unsigned int verticesPerThread = 16384;
+/// Iterations to search for voxel size matching target number of vertices.
+const int maxSizeIterations = 8;
+
+inline uint64_t voxelKey( const aiVector3D& v, const aiVector3D& origin, float inverseSize )
+{
+  uint64_t x = std::min(uint64_t(std::max(0.0f, (v.x - origin.x) * inverseSize)), voxelAxisMask);
+  uint64_t y = std::min(uint64_t(std::max(0.0f, (v.y - origin.y) * inverseSize)), voxelAxisMask);
+  uint64_t z = std::min(uint64_t(std::max(0.0f, (v.z - origin.z) * inverseSize)), voxelAxisMask);
+  return (x << 42) | (y << 21) | z;
+}
+
+/// Each voxel is owned by exactly one thread, so that threads never share a cluster.
+inline unsigned int ownerOf( uint64_t key, unsigned int threads )
+{
+  return (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> 40) % threads;
+}
+
+unsigned int threadsFor( unsigned int items )
+{
+  return ThreadsFor(items, verticesPerThread);
+}
+
+void computeKeys( const aiMesh* pMesh, const aiVector3D& origin, float voxelSize,
+    unsigned int threads, std::vector<uint64_t>& keys )
+{
+  float inverseSize = 1.0f / voxelSize;
+  keys.resize(pMesh->mNumVertices);
+  RunChunks(pMesh->mNumVertices, threads, [&](unsigned int, unsigned int begin, unsigned int end) {
+    for (unsigned int i = begin; i < end; ++i) {
+      keys[i] = voxelKey(pMesh->mVertices[i], origin, inverseSize);
+    }
+  });
+}
+
+void normalize( aiVector3D* vectors, unsigned int begin, unsigned int end )
+{
+  for (unsigned int i = begin; i < end; ++i) {
+    float length = vectors[i].Length();
+    if (length > 0.0f) {
+      vectors[i] /= length;
+    }
+  }
+}
+
+} // end of anonymous namespace
+
+// ------------------------------------------------------------------------------------------------
+// Constructor
+VoxelDownsampleProcess::VoxelDownsampleProcess()
+  : mVoxelSize(0.0f)
+  , mTargetVertices(AI_VD_DEFAULT_TARGET_VERTICES)
+  , mPrimitiveTypes(AI_VD_DEFAULT_PTYPES)
+{
+  // nothing to do here
+}
+
+// ------------------------------------------------------------------------------------------------
+// Destructor
+VoxelDownsampleProcess::~VoxelDownsampleProcess()
+{
+  // nothing to do here
+}
+
+// ------------------------------------------------------------------------------------------------
+// Returns whether the processing step is present in the given flag.
+bool VoxelDownsampleProcess::IsActive( unsigned int pFlags ) const
+{
+  return !!(pFlags & aiProcess_VoxelDownsample);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Updates internal properties
+void VoxelDownsampleProcess::SetupProperties( const Importer* pImp )
+{
+  mVoxelSize = pImp->GetPropertyFloat(AI_CONFIG_PP_VD_VOXEL_SIZE, 0.0f);
+  mTargetVertices = pImp->GetPropertyInteger(AI_CONFIG_PP_VD_TARGET_VERTICES, AI_VD_DEFAULT_TARGET_VERTICES);
+  mPrimitiveTypes = pImp->GetPropertyInteger(AI_CONFIG_PP_VD_PTYPES, AI_VD_DEFAULT_PTYPES);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Executes the post processing step on the given imported data.
+void VoxelDownsampleProcess::Execute( aiScene* pScene )
+{
+  DefaultLogger::get()->debug("VoxelDownsampleProcess begin");
+  if (mVoxelSize <= 0.0f && mTargetVertices == 0) {
+    DefaultLogger::get()->debug("VoxelDownsampleProcess skipped, neither voxel size nor target is set");
+    return;
+  }
+  unsigned int total = Downsample(pScene, mVoxelSize, mTargetVertices, mPrimitiveTypes);
+  DefaultLogger::get()->info((Formatter::format(),
+      "VoxelDownsampleProcess finished. Meshes keep ", total, " vertices"));
+}
+
+// ------------------------------------------------------------------------------------------------
+// Downsamples suitable meshes of the scene on a common voxel grid.
+unsigned int VoxelDownsampleProcess::Downsample( aiScene* pScene, float voxelSize,
+    unsigned int targetVertices, unsigned int primitiveTypes )
+{
+  std::vector<aiMesh*> meshes;
+  unsigned int total = 0;
+  aiVector3D min(1e10f, 1e10f, 1e10f), max(-1e10f, -1e10f, -1e10f);
+  for (unsigned int a = 0; a < pScene->mNumMeshes; ++a) {
+    aiMesh* pMesh = pScene->mMeshes[a];
+    if (!(pMesh->mPrimitiveTypes & primitiveTypes) || pMesh->mNumVertices == 0) {
+      continue;
+    }
+    if (pMesh->HasBones() || pMesh->mNumAnimMeshes > 0) {
+      // merged vertices would need merged weights and morph targets
+      DefaultLogger::get()->warn("VoxelDownsampleProcess: skipping mesh with bones or animation");
+      continue;
+    }
+    meshes.push_back(pMesh);
+    total += pMesh->mNumVertices;
+    for (unsigned int i = 0; i < pMesh->mNumVertices; ++i) {
+      const aiVector3D& v = pMesh->mVertices[i];
+      min.x = std::min(min.x, v.x);  max.x = std::max(max.x, v.x);
+      min.y = std::min(min.y, v.y);  max.y = std::max(max.y, v.y);
+      min.z = std::min(min.z, v.z);  max.z = std::max(max.z, v.z);
+    }
+  }
+  if (meshes.empty()) {
+    return 0;
+  }
+
+  aiVector3D diagonal = max - min;
+  float extent = std::max(diagonal.x, std::max(diagonal.y, diagonal.z));
+  if (extent <= 0.0f) {
+    return total;
+  }
+  float smallest = extent / float(voxelAxisMask);  // grid must fit into key
+  if (voxelSize <= 0.0f) {
+    if (targetVertices == 0 || total <= targetVertices) {
+      return total;
+    }
+    // count of occupied voxels falls as size^-d, where d is 2 for surfaces and 3 for volumes;
+    // estimate d from the last two probes and keep the size bracketed
+    float fitting = extent * 2.0f;  // any mesh fits into one voxel
+    float overflowing = 0.0f;
+    float dimension = 2.0f;
+    float size = extent / std::sqrt(float(targetVertices));
+    float previousSize = 0.0f;
+    unsigned int previousCount = 0;
+    for (int iteration = 0; iteration < maxSizeIterations; ++iteration) {
+      size = std::max(size, smallest);
+      unsigned int count = CountVoxels(meshes, min, size);
+      if (count <= targetVertices) {
+        fitting = std::min(fitting, size);
+        if (count >= targetVertices - targetVertices / 20) {
+          break;  // close enough
+        }
+      } else {
+        overflowing = std::max(overflowing, size);
+      }
+      if (previousCount > 0 && previousCount != count && previousSize != size) {
+        dimension = std::log(float(count) / previousCount) / std::log(previousSize / size);
+        dimension = std::min(3.0f, std::max(1.0f, dimension));
+      }
+      previousSize = size;
+      previousCount = count;
+      size *= std::pow(float(count) / targetVertices, 1.0f / dimension);
+      if (size <= overflowing || size >= fitting) {
+        size = overflowing > 0.0f ? std::sqrt(overflowing * fitting) : fitting * 0.5f;
+      }
+    }
+    voxelSize = fitting;
+  }
+  voxelSize = std::max(voxelSize, smallest);
+
+  total = 0;
+  for (aiMesh* pMesh : meshes) {
+    DownsampleMesh(pMesh, min, voxelSize);
+    total += pMesh->mNumVertices;
+  }
+  DefaultLogger::get()->debug((Formatter::format(),
+      "VoxelDownsampleProcess: voxel size ", voxelSize, ", extent ", extent));
+  return total;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Counts occupied voxels, every thread hashes only the voxels it owns.
+unsigned int VoxelDownsampleProcess::CountVoxels( const std::vector<aiMesh*>& meshes,
+    const aiVector3D& origin, float voxelSize )
+{
+  unsigned int count = 0;
+  std::vector<uint64_t> keys;
+  for (const aiMesh* pMesh : meshes) {
+    unsigned int threads = threadsFor(pMesh->mNumVertices);
+    computeKeys(pMesh, origin, voxelSize, threads, keys);
+    std::vector<unsigned int> counts(threads, 0);
+    RunThreads(threads, [&](unsigned int t) {
+      std::unordered_set<uint64_t> voxels;
+      voxels.reserve(keys.size() / threads);
+      for (uint64_t key : keys) {
+        if (ownerOf(key, threads) == t) {
+          voxels.insert(key);
+        }
+      }
+      counts[t] = (unsigned int)voxels.size();
+    });
+    for (unsigned int t = 0; t < threads; ++t) {
+      count += counts[t];
+    }
+  }
+  return count;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Clusters vertices of the mesh by voxels and rebuilds its faces over the clusters.
+void VoxelDownsampleProcess::DownsampleMesh( aiMesh* pMesh, const aiVector3D& origin, float voxelSize )
+{
+  unsigned int threads = threadsFor(pMesh->mNumVertices);
+  std::vector<uint64_t> keys;
+  computeKeys(pMesh, origin, voxelSize, threads, keys);
+
+  // assign cluster ids local to the owning thread
+  std::vector<unsigned int> remap(pMesh->mNumVertices);
+  std::vector<unsigned int> offsets(threads + 1, 0);
+  RunThreads(threads, [&](unsigned int t) {
+    std::unordered_map<uint64_t, unsigned int> clusters;
+    clusters.reserve(keys.size() / threads);
+    for (unsigned int i = 0; i < pMesh->mNumVertices; ++i) {
+      if (ownerOf(keys[i], threads) == t) {
+        auto it = clusters.insert(std::make_pair(keys[i], (unsigned int)clusters.size())).first;
+        remap[i] = it->second;
+      }
+    }
+    offsets[t + 1] = (unsigned int)clusters.size();
+  });
+  for (unsigned int t = 0; t < threads; ++t) {
+    offsets[t + 1] += offsets[t];
+  }
+  unsigned int total = offsets[threads];
+  if (total == pMesh->mNumVertices) {
+    return;  // every vertex occupies its own voxel
+  }
+
+  // accumulate attributes, a cluster is written by its owner only
+  aiVector3D* vertices = new aiVector3D[total];
+  aiVector3D* normals = pMesh->HasNormals() ? new aiVector3D[total] : NULL;
+  aiVector3D* tangents = pMesh->HasTangentsAndBitangents() ? new aiVector3D[total] : NULL;
+  aiVector3D* bitangents = pMesh->HasTangentsAndBitangents() ? new aiVector3D[total] : NULL;
+  aiColor4D* colors[AI_MAX_NUMBER_OF_COLOR_SETS] = {NULL};
+  aiVector3D* texcoords[AI_MAX_NUMBER_OF_TEXTURECOORDS] = {NULL};
+  for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c) {
+    if (pMesh->HasVertexColors(c)) {
+      colors[c] = new aiColor4D[total];
+    }
+  }
+  for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++c) {
+    if (pMesh->HasTextureCoords(c)) {
+      texcoords[c] = new aiVector3D[total];
+    }
+  }
+  std::vector<unsigned int> weights(total, 0);
+  RunThreads(threads, [&](unsigned int t) {
+    for (unsigned int i = 0; i < pMesh->mNumVertices; ++i) {
+      if (ownerOf(keys[i], threads) != t) {
+        continue;
+      }
+      unsigned int cluster = remap[i] += offsets[t];
+      ++weights[cluster];
+      vertices[cluster] += pMesh->mVertices[i];
+      if (normals) {
+        normals[cluster] += pMesh->mNormals[i];
+      }
+      if (tangents) {
+        tangents[cluster] += pMesh->mTangents[i];
+        bitangents[cluster] += pMesh->mBitangents[i];
+      }
+      for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS && colors[c]; ++c) {
+        colors[c][cluster] += pMesh->mColors[c][i];
+      }
+      for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS && texcoords[c]; ++c) {
+        texcoords[c][cluster] += pMesh->mTextureCoords[c][i];
+      }
+    }
+  });
+  RunChunks(total, threadsFor(total), [&](unsigned int, unsigned int begin, unsigned int end) {
+    for (unsigned int i = begin; i < end; ++i) {
+      float inverse = 1.0f / weights[i];
+      vertices[i] *= inverse;
+      for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS && colors[c]; ++c) {
+        colors[c][i] *= inverse;
+      }
+      for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS && texcoords[c]; ++c) {
+        texcoords[c][i] *= inverse;
+      }
+    }
+    if (normals) {
+      normalize(normals, begin, end);
+    }
+    if (tangents) {
+      normalize(tangents, begin, end);
+      normalize(bitangents, begin, end);
+    }
+  });
+
+  delete [] pMesh->mVertices;  pMesh->mVertices = vertices;
+  delete [] pMesh->mNormals;  pMesh->mNormals = normals;
+  delete [] pMesh->mTangents;  pMesh->mTangents = tangents;
+  delete [] pMesh->mBitangents;  pMesh->mBitangents = bitangents;
+  for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c) {
+    delete [] pMesh->mColors[c];  pMesh->mColors[c] = colors[c];
+  }
+  for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++c) {
+    delete [] pMesh->mTextureCoords[c];  pMesh->mTextureCoords[c] = texcoords[c];
+  }
+  pMesh->mNumVertices = total;
+
+  // faces collapsed inside a voxel are dropped, points are kept once per voxel
+  std::vector<bool> emitted(total, false);
+  unsigned int kept = 0;
+  unsigned int types = 0;
+  for (unsigned int f = 0; f < pMesh->mNumFaces; ++f) {
+    aiFace& face = pMesh->mFaces[f];
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < face.mNumIndices; ++i) {
+      unsigned int index = remap[face.mIndices[i]];
+      if (n == 0 || (index != face.mIndices[n - 1] && (i + 1 < face.mNumIndices || index != face.mIndices[0]))) {
+        face.mIndices[n++] = index;
+      }
+    }
+    if (n < std::min(face.mNumIndices, 3u)) {
+      continue;
+    }
+    if (n == 1) {
+      if (emitted[face.mIndices[0]]) {
+        continue;
+      }
+      emitted[face.mIndices[0]] = true;
+    }
+    face.mNumIndices = n;
+    types |= n == 1 ? aiPrimitiveType_POINT : n == 2 ? aiPrimitiveType_LINE :
+             n == 3 ? aiPrimitiveType_TRIANGLE : aiPrimitiveType_POLYGON;
+    if (kept != f) {
+      std::swap(pMesh->mFaces[kept].mNumIndices, face.mNumIndices);
+      std::swap(pMesh->mFaces[kept].mIndices, face.mIndices);
+    }
+    ++kept;
+  }
+  pMesh->mNumFaces = kept;
+  if (types != 0) {
+    pMesh->mPrimitiveTypes = types;
+  }
+}
+
+// ------------------------------------------------------------------------------------------------
+ASSIMP_API unsigned int aiDownsampleScene( aiScene* pScene, float voxelSize,
+    unsigned int targetVertices, unsigned int primitiveTypes )
+{
+  return VoxelDownsampleProcess::Downsample(pScene, voxelSize, targetVertices, primitiveTypes);
+}
@@ -0,0 +1,74 @@
+/*
+ * VoxelDownsampleProcess.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Alov Maxim <alovmax@yandex.ru>
+ */
+
+/// @file VoxelDownsampleProcess.h
+/// Defines a post processing step to thin out mesh vertices on a voxel grid
+#ifndef AI_VOXELDOWNSAMPLEPROCESS_H_INC
+#define AI_VOXELDOWNSAMPLEPROCESS_H_INC
+
+#include <vector>
+#include "BaseProcess.h"
+
+#include "../include/assimp/mesh.h"
+#include "../include/assimp/scene.h"
+
+namespace Assimp
+{
+
+class VoxelDownsampleProcess : public BaseProcess
+{
+public:
+
+  VoxelDownsampleProcess();
+  ~VoxelDownsampleProcess();
+
+public:
+  /** Returns whether the processing step is present in the given flag.
+  * @param pFlags The processing flags the importer was called with. A
+  *   bitwise combination of #aiPostProcessSteps.
+  * @return true if the process is present in this flag fields,
+  *   false if not.
+  */
+  bool IsActive( unsigned int pFlags ) const;
+
+  /** Called prior to ExecuteOnScene().
+  * The function is a request to the process to update its configuration
+  * basing on the Importer's configuration property list.
+  */
+  virtual void SetupProperties( const Importer* pImp );
+
+  /// Downsamples meshes of the scene, which primitive types intersect with the
+  /// given mask. Either voxel size or target number of vertices must be positive,
+  /// voxel size takes precedence.
+  /// @return total number of vertices in processed meshes after downsampling.
+  static unsigned int Downsample( aiScene* pScene, float voxelSize,
+      unsigned int targetVertices, unsigned int primitiveTypes );
+
+protected:
+  /** Executes the post processing step on the given imported data.
+  * At the moment a process is not supposed to fail.
+  * @param pScene The imported data to work at.
+  */
+  void Execute( aiScene* pScene);
+
+  /// Counts occupied voxels of the given size over all meshes.
+  static unsigned int CountVoxels( const std::vector<aiMesh*>& meshes,
+      const aiVector3D& origin, float voxelSize );
+
+  /// Merges vertices of the mesh falling into the same voxel, averaging
+  /// their attributes, and drops faces which have become degenerate.
+  static void DownsampleMesh( aiMesh* pMesh, const aiVector3D& origin, float voxelSize );
+
+  float mVoxelSize;
+  unsigned int mTargetVertices;
+  unsigned int mPrimitiveTypes;
+};
+
+} // end of namespace Assimp
+
+
+#endif // !!AI_VOXELDOWNSAMPLEPROCESS_H_INC
@@ -101,3 +101,16 @@ bool AssetStorage::read(void* buffer, size_t size) {
   }
   return true;
 }
+
+const void* AssetStorage::buffer() {
+  if (m_asset == nullptr) {
+    ERR("Asset is not opened!");
+    return nullptr;
+  }
+  // direct pointer into memory-mapped asset, valid until close()
+  const void* data = AAsset_getBuffer(m_asset);
+  if (data == nullptr) {
+    WRN("Failed to get buffer of asset from file: %s!", m_asset_filename);
+  }
+  return data;
+}
@@ -26,21 +26,113 @@
  * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 
+#include <assimp/cexport.h>
+#include <assimp/cimport.h>
+#include <assimp/config.h>
+
 #include "macro.h"
 #include "assimp_utils.h"
 #include "AsyncContext.h"
-#include "EGLConfigChooser.h"
+#include "ContextGroup.h"
 #include "exceptions.h"
+#include "GpuResources.h"
 #include "illumination.h"
+#include "JobSystem.h"
 #include "logger.h"
+#include "optimizer.h"
+#include "simplifier.h"
 #include "rgbstruct.h"
 #include "utils.h"
+#include "wireframe.h"
 
 
 /* Public API */
+// ----------------------------------------------------------------------------
+/// @brief Meshes of points and lines are left after SortByPType, they have no triangles to draw.
+static bool isTriangleMesh(const aiMesh* mesh) {
+  return mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
+}
+
+/// @brief Transforms of each mesh accumulated along node graph, one per node referencing it.
+static void collectPlacements(const aiScene* scene, std::vector<std::vector<utils::Matrix4f>>* placements) {
+  placements->assign(scene->mNumMeshes, std::vector<utils::Matrix4f>());
+  std::vector<std::pair<const aiNode*, utils::Matrix4f>> stack;  // explicit, graphs of some formats are deep
+  if (scene->mRootNode != nullptr) {
+    stack.emplace_back(scene->mRootNode, utils::Matrix4f::identity());
+  }
+  while (!stack.empty()) {
+    const aiNode* node = stack.back().first;
+    utils::Matrix4f local;
+    utils::assimp::getRawTransformNegativeXYZ(node->mTransformation, &local.m[0]);
+    utils::Matrix4f transform = stack.back().second * local;
+    stack.pop_back();
+    for (unsigned int k = 0; k < node->mNumMeshes; ++k) {
+      if (node->mMeshes[k] < scene->mNumMeshes) {
+        (*placements)[node->mMeshes[k]].push_back(transform);
+      }
+    }
+    for (unsigned int k = 0; k < node->mNumChildren; ++k) {
+      stack.emplace_back(node->mChildren[k], transform);
+    }
+  }
+}
+
+static bool isIdentity(const utils::Matrix4f& transform) {
+  utils::Matrix4f identity = utils::Matrix4f::identity();
+  return std::equal(&transform.m[0], &transform.m[16], &identity.m[0]);
+}
+
+/// @brief Moves vertices (x, y, z, w) and unit normals of mesh by transform.
+static void transformGeometry(const utils::Matrix4f& transform, GLfloat* vertices, GLfloat* normals, GLsizeiptr total) {
+  utils::Matrix4f inverse = utils::Matrix4f::identity();
+  transform.inverse(&inverse);
+  for (GLsizeiptr i = 0; i < total; ++i) {
+    utils::Vector3Df p = transform.transformPoint(utils::Vector3Df(vertices[i * 4 + 0], vertices[i * 4 + 1], vertices[i * 4 + 2]));
+    vertices[i * 4 + 0] = p[0];  vertices[i * 4 + 1] = p[1];  vertices[i * 4 + 2] = p[2];
+    if (normals == nullptr) {
+      continue;
+    }
+    // inverse transpose keeps normals perpendicular to surface under non-uniform scale
+    GLfloat* n = &normals[i * 3];
+    GLfloat x = inverse.m[0] * n[0] + inverse.m[1] * n[1] + inverse.m[2] * n[2];
+    GLfloat y = inverse.m[4] * n[0] + inverse.m[5] * n[1] + inverse.m[6] * n[2];
+    GLfloat z = inverse.m[8] * n[0] + inverse.m[9] * n[1] + inverse.m[10] * n[2];
+    GLfloat length = std::sqrt(x * x + y * y + z * z);
+    if (length > 0.0f) {
+      n[0] = x / length;  n[1] = y / length;  n[2] = z / length;
+    }
+  }
+}
+
+/// @brief Interleaves 10 bits of each coordinate normalized to the box.
+static uint32_t mortonCode(const utils::Vector3Df& point, const utils::Vector3Df& box_min, const utils::Vector3Df& box_max) {
+  uint32_t code = 0;
+  uint32_t cell[3];
+  for (int k = 0; k < 3; ++k) {
+    GLfloat extent = box_max[k] - box_min[k];
+    GLfloat unit = extent > 0.0f ? (point[k] - box_min[k]) / extent : 0.0f;
+    cell[k] = static_cast<uint32_t>(std::min(1023.0f, std::max(0.0f, unit * 1024.0f)));
+  }
+  for (int bit = 9; bit >= 0; --bit) {
+    for (int k = 0; k < 3; ++k) {
+      code = (code << 1) | ((cell[k] >> bit) & 1);
+    }
+  }
+  return code;
+}
+
+/// @brief Runs function for each index in [0, total) on the shared job system.
+/// @return number of threads used.
+template <typename Function>
+static unsigned int parallelFor(GLsizeiptr total, Function function) {
+  return JobSystem::get().parallelFor(total, function);
+}
+
 // ----------------------------------------------------------------------------
 AsyncContext::MeshHelper::MeshHelper()
   : has_colors(false)
@@ -51,7 +143,24 @@ AsyncContext::MeshHelper::MeshHelper()
   , normals(nullptr)
   , indices(nullptr)
   , short_indices(nullptr)
-  , texture_coords(nullptr) {
+  , texture_coords(nullptr)
+  , material_index(-1)
+  , texture(nullptr)
+  , residency_index(-1)
+  , sort_key(0)
+  , radius(0.0f)
+  , visible(true)
+  , pixels_per_unit(0.0f)
+  , lod_error(0.0f)
+  , total_lods(0)
+  , lods(nullptr)
+  , first_instance(0)
+  , total_instances(0)
+  , hierarchy(nullptr)
+  , num_edges(0)
+  , edge_indices(nullptr)
+  , edge_geometry(nullptr)
+  , batch_index(-1) {
   DBG("MeshHelper::ctor");
 }
 
@@ -63,20 +172,31 @@ AsyncContext::MeshHelper::~MeshHelper() {
   delete [] indices;  indices = nullptr;
   delete [] short_indices;  short_indices = nullptr;
   delete [] texture_coords;  texture_coords = nullptr;
+  delete [] lods;  lods = nullptr;
+  delete hierarchy;  hierarchy = nullptr;
+  delete [] edge_indices;  edge_indices = nullptr;
+  delete edge_geometry;  edge_geometry = nullptr;
+  texture = nullptr;
+}
+
+AsyncContext::MaterialHelper::MaterialHelper()
+  : texture(nullptr) {
+  color[0] = 1.0f;  color[1] = 1.0f;  color[2] = 1.0f;  color[3] = 1.0f;
 }
 
 // ----------------------------------------------------------------------------
 AsyncContext::AsyncContext()
   : m_jenv(nullptr)
   , m_master_object(nullptr)
-  , m_fireStringEvent_id(nullptr)
+  , m_events()
   , m_window(nullptr)
   , m_display(EGL_NO_DISPLAY)
   , m_surface(EGL_NO_SURFACE)
+  , m_pbuffer(EGL_NO_SURFACE)
   , m_context(EGL_NO_CONTEXT)
+  , m_uploader(nullptr)
   , m_width(0), m_height(0)
   , m_config(nullptr)
-  , m_num_configs(0)
   , m_format(0)
   , m_supremum_vertices(supremumVertices)
   , m_point_diameter(2.5f)
@@ -86,7 +206,9 @@ AsyncContext::AsyncContext()
   , m_axis_y_colors(new GLfloat[8]), m_axis_y_vertices(new GLfloat[8])
   , m_axis_z_colors(new GLfloat[8]), m_axis_z_vertices(new GLfloat[8])
   , m_draw_mode(GL_TRIANGLES)
-  , m_data_loaded(false) {
+  , m_data_loaded(false)
+  , m_projection(utils::Matrix4f::identity())
+  , m_modelview(utils::Matrix4f::identity()) {
 
   DBG("enter AsyncContext ctor");
   m_error_code = AsyncContextError::ACONTEXT_OK;
@@ -94,28 +216,47 @@ AsyncContext::AsyncContext()
   for (int i = 0; i < 9; ++i) m_bgColor[i] = 0;
 
   m_surface_recovery_received.store(false);
+  m_surface_lost_received.store(false);
+  m_importing.store(false);
   m_context_initialized.store(false);
-  m_translation_gesture_received.store(false);
-  m_rotation_gesture_received.store(false);
-  m_zoom_gesture_received.store(false);
+  m_coast_pending.store(false);
+  m_gesture_backlog_pending.store(false);
   m_drop_gestures_received.store(false);
   m_drop_translation_gesture_received.store(false);
   m_drop_rotation_gesture_received.store(false);
   m_drop_zoom_gesture_received.store(false);
   m_clear_surface_received.store(false);
   m_textures_enabled_received.store(false);
+  m_flat_shading_received.store(false);
   m_vertex_limit_received.store(false);
   m_draw_type_received.store(false);
   m_bg_color_received.store(false);
   m_axis_visibility_received.store(false);
   m_scene_received.store(false);
+  m_residency_pending.store(false);
+  if (GpuResources::get().getBudget(GpuCategory::TEXTURES) == 0) {
+    GpuResources::get().setBudget(GpuCategory::TEXTURES, textureBudget);
+  }
 
+  m_last_rotation = gesture::Rotation(false, false, false, 0.0f, 0.0f, 0.0f);
   m_axis_visible = false;
   m_textures_enabled = true;
+  m_flat_shading = false;
   m_has_textures = false;
   m_scene = nullptr;
+  m_downsampled_scene = nullptr;
   m_total_meshes = 0;
   m_meshes = nullptr;
+  m_total_materials = 0;
+  m_materials = nullptr;
+  m_total_batches = 0;
+  m_batches = nullptr;
+  m_frame_stats = FrameStatistics{0, 0, 0, 0, 0, 0, 0};
+  m_point_cloud = nullptr;
+  m_point_cloud_pending.store(false);
+  m_pick_transform = utils::Matrix4f::identity();
+  m_pick_width = 0;
+  m_pick_height = 0;
 
   __drop__();  // set initial position of 3d scene
   DBG("exit AsyncContext ctor");
@@ -131,11 +272,16 @@ AsyncContext::~AsyncContext() {
 void AsyncContext::setEnvironment(JNIEnv* jenv, const jobject& global_object, jmethodID method_id) {
   m_jenv = jenv;
   m_master_object = global_object;
-  m_fireStringEvent_id = method_id;
+  m_events.bind(jenv, global_object, method_id);
 }
 
 /* Callbacks */
 // ----------------------------------------------------------------------------
+void AsyncContext::setCacheDirectory(const char* path) {
+  std::unique_lock<std::mutex> lock(m_scene_mutex);
+  m_cache_directory = path != nullptr ? path : "";
+}
+
 void AsyncContext::callback_setWindow(ANativeWindow* window) {
   std::unique_lock<std::mutex> lock(m_surface_recovery_mutex);
   m_window = window;
@@ -143,6 +289,24 @@ void AsyncContext::callback_setWindow(ANativeWindow* window) {
   interrupt();
 }
 
+/// @brief Blocks until rendering thread stops drawing to window, which is released afterwards.
+/// @details Returns as soon as import is running, even if it starts while waiting:
+/// window is not drawn until loss is handled.
+void AsyncContext::callback_surfaceLost(bool dummy) {
+  std::unique_lock<std::mutex> lock(m_surface_recovery_mutex);
+  m_surface_lost_received.store(true);
+  interrupt();
+  if (m_is_runnning && !m_surface_lost_condition.wait_for(lock, std::chrono::milliseconds(surfaceLossTimeout),
+      [this]() { return !m_surface_lost_received.load() || m_importing.load(); })) {
+    WRN("Loss of surface has not been handled in %i ms", surfaceLossTimeout);
+  }
+}
+
+void AsyncContext::callback_uploadCompleted(bool result) {
+  m_residency_pending.store(true);  // staged texture is published on the next frame
+  interrupt();
+}
+
 void AsyncContext::callback_setVertexLimit(uint32_t limit) {
   std::unique_lock<std::mutex> lock(m_vertex_limit_mutex);
   m_supremum_vertices = limit;
@@ -171,24 +335,24 @@ void AsyncContext::callback_setAxisVisibility(bool isVisible) {
   interrupt();
 }
 
-void AsyncContext::callback_gestureTranslation(gesture::Translation::Ptr gesture) {
-  std::unique_lock<std::mutex> lock(m_translation_gesture_mutex);
-  m_translation_gesture = gesture;
-  m_translation_gesture_received.store(true);
+void AsyncContext::callback_gestureTranslation(gesture::Translation gesture) {
+  __pushGesture__(gesture::Sample(gesture));
+  interrupt();
+}
+
+void AsyncContext::callback_gestureRotation(gesture::Rotation gesture) {
+  m_last_rotation = gesture;
+  __pushGesture__(gesture::Sample(gesture));
   interrupt();
 }
 
-void AsyncContext::callback_gestureRotation(gesture::Rotation::Ptr gesture) {
-  std::unique_lock<std::mutex> lock(m_rotation_gesture_mutex);
-  m_rotation_gesture = gesture;
-  m_rotation_gesture_received.store(true);
+void AsyncContext::callback_gestureZoom(gesture::Zoom gesture) {
+  __pushGesture__(gesture::Sample(gesture));
   interrupt();
 }
 
-void AsyncContext::callback_gestureZoom(gesture::Zoom::Ptr gesture) {
-  std::unique_lock<std::mutex> lock(m_zoom_gesture_mutex);
-  m_zoom_gesture = gesture;
-  m_zoom_gesture_received.store(true);
+void AsyncContext::callback_gestureTouch(gesture::Touch touch) {
+  __pushGesture__(gesture::Sample(touch));
   interrupt();
 }
 
@@ -229,6 +393,13 @@ void AsyncContext::callback_texturesEnabled(bool enabled) {
   interrupt();
 }
 
+void AsyncContext::callback_setFlatShading(bool enabled) {
+  std::unique_lock<std::mutex> lock(m_flat_shading_mutex);
+  m_flat_shading = enabled;
+  m_flat_shading_received.store(true);
+  interrupt();
+}
+
 void AsyncContext::callback_sceneUploaded(native::Scene* scene) {
   std::unique_lock<std::mutex> lock(m_scene_mutex);
   m_scene = scene;
@@ -236,49 +407,108 @@ void AsyncContext::callback_sceneUploaded(native::Scene* scene) {
   interrupt();
 }
 
+/* Picking */
+// ----------------------------------------------------------------------------
+bool AsyncContext::pick(GLfloat x, GLfloat y, PickResult* result) {
+  std::unique_lock<std::mutex> lock(m_scene_mutex, std::try_to_lock);
+  if (!lock.owns_lock() || m_meshes == nullptr) {
+    return false;  // scene is being uploaded
+  }
+  utils::Matrix4f transform, inverse;
+  EGLint width = 0, height = 0;
+  {
+    std::unique_lock<std::mutex> pick_lock(m_pick_mutex);
+    transform = m_pick_transform;
+    width = m_pick_width;
+    height = m_pick_height;
+  }
+  if (width <= 0 || height <= 0 || !transform.inverse(&inverse)) {
+    return false;  // no frame has been drawn yet
+  }
+
+  // ray from near to far plane through the pixel, in scene coordinates; viewport
+  // starts at (-margin, -margin) and spans width + margin, y goes down on surface
+  GLfloat ndc_x = 2.0f * (x + viewportMargin) / (width + viewportMargin) - 1.0f;
+  GLfloat ndc_y = 1.0f - 2.0f * y / (height + viewportMargin);
+  utils::Vector3Df near = inverse.transformProjective(utils::Vector3Df(ndc_x, ndc_y, -1.0f));
+  utils::Vector3Df far = inverse.transformProjective(utils::Vector3Df(ndc_x, ndc_y, 1.0f));
+  utils::Vector3Df direction = far - near;
+  GLfloat origin[3] = {near[0], near[1], near[2]};
+  GLfloat inverse_direction[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+
+  utils::TriangleHierarchy::Hit hit = {0, 1.0f, 0.0f, 0.0f};  // distance is in units of near-far segment
+  int hit_instance = -1;
+  for (size_t ii = 0; ii < m_instances.size(); ++ii) {
+    const InstanceHelper& instance = m_instances[ii];
+    const MeshHelper& mesh = m_meshes[instance.mesh];
+    GLfloat box_min[3] = {instance.box_min[0], instance.box_min[1], instance.box_min[2]};
+    GLfloat box_max[3] = {instance.box_max[0], instance.box_max[1], instance.box_max[2]};
+    if (mesh.hierarchy == nullptr ||
+        utils::TriangleHierarchy::intersectBox(box_min, box_max, origin, inverse_direction, hit.distance) < 0.0f) {
+      continue;
+    }
+    // transform is affine, so the ray moved to mesh space keeps its parameter
+    utils::Vector3Df local_near = near, local_direction = direction;
+    utils::Matrix4f inverse_transform;
+    if (!instance.identity) {
+      if (!instance.transform.inverse(&inverse_transform)) {
+        continue;
+      }
+      local_near = inverse_transform.transformPoint(near);
+      local_direction = inverse_transform.transformPoint(far) - local_near;
+    }
+    if (mesh.hierarchy->intersect(local_near, local_direction, &hit)) {
+      hit_instance = ii;
+    }
+  }
+  if (hit_instance < 0) {
+    return false;
+  }
+  result->mesh = m_instances[hit_instance].mesh;
+  result->instance = hit_instance;
+  result->triangle = hit.triangle;
+  result->u = hit.u;
+  result->v = hit.v;
+  result->position = near + direction * hit.distance;
+  return true;
+}
+
 /* Virtual methods */
 // ----------------------------------------------------------------------------
 bool AsyncContext::checkForWakeUp() {
-  return m_surface_recovery_received.load() ||
-      m_translation_gesture_received.load() ||
-      m_rotation_gesture_received.load() ||
-      m_zoom_gesture_received.load() ||
+  return m_surface_lost_received.load() ||
+      m_surface_recovery_received.load() ||
+      (m_context_initialized.load() &&  // gestures are handled only with window
+       (!m_gestures.empty() || m_gesture_backlog_pending.load() || m_coast_pending.load())) ||
       m_drop_gestures_received.load() ||
       m_drop_translation_gesture_received.load() ||
       m_drop_rotation_gesture_received.load() ||
       m_drop_zoom_gesture_received.load() ||
       m_clear_surface_received.load() ||
       m_textures_enabled_received.load() ||
+      m_flat_shading_received.load() ||
       m_vertex_limit_received.load() ||
       m_draw_type_received.load() ||
       m_bg_color_received.load() ||
       m_axis_visibility_received.load() ||
-      m_scene_received.load();
+      m_scene_received.load() ||
+      m_residency_pending.load() ||
+      m_point_cloud_pending.load();
 }
 
 void AsyncContext::eventHandler() {
+  m_residency_pending.store(false);  // set again by render(), if promotions remain
+  m_point_cloud_pending.store(false);
+  if (m_surface_lost_received.load()) {
+    process_surfaceLost();
+  }
   if (m_surface_recovery_received.load()) {
     m_surface_recovery_received.store(false);
     process_setWindow();
   }
   if (m_context_initialized.load()) {
-    if (m_translation_gesture_received.load()) {
-      m_translation_gesture_received.store(false);
-      process_gestureTranslation();
-      if (!m_data_loaded) {
-        return;  // prevent render() call
-      }
-    }
-    if (m_rotation_gesture_received.load()) {
-      m_rotation_gesture_received.store(false);
-      process_gestureRotation();
-      if (!m_data_loaded) {
-        return;  // prevent render() call
-      }
-    }
-    if (m_zoom_gesture_received.load()) {
-      m_zoom_gesture_received.store(false);
-      process_gestureZoom();
+    if (!m_gestures.empty() || m_gesture_backlog_pending.load() || m_coast_pending.load()) {
+      process_gestures();
       if (!m_data_loaded) {
         return;  // prevent render() call
       }
@@ -322,6 +552,10 @@ void AsyncContext::eventHandler() {
         return;  // prevent render() call
       }
     }
+    if (m_flat_shading_received.load()) {
+      m_flat_shading_received.store(false);
+      process_setFlatShading();  // requests upload
+    }
     if (m_vertex_limit_received.load()) {
       m_vertex_limit_received.store(false);
       process_setVertexLimit();
@@ -346,7 +580,16 @@ void AsyncContext::eventHandler() {
     }
     if (m_scene_received.load()) {
       m_scene_received.store(false);
+      {
+        std::unique_lock<std::mutex> lock(m_surface_recovery_mutex);
+        m_importing.store(true);
+      }
+      m_surface_lost_condition.notify_all();  // loss of surface is not waited for during import
       process_sceneUploaded();
+      m_importing.store(false);
+      if (m_surface_lost_received.load()) {
+        return;  // lost during import, handled before window is drawn again
+      }
     }
     render();
   } else {
@@ -354,19 +597,35 @@ void AsyncContext::eventHandler() {
   }
 }
 
+void AsyncContext::onStop() {
+  m_events.unbind();  // rendering thread is detached from JVM afterwards
+  ActiveObject::onStop();
+}
+
 /* Private methods */
 // ----------------------------------------------------------------------------
+void AsyncContext::process_surfaceLost() {
+  std::unique_lock<std::mutex> lock(m_surface_recovery_mutex);
+  m_context_initialized.store(false);
+  __releaseSurface__();
+  __dropPendingGestures__();
+  m_surface_lost_received.store(false);
+  m_surface_lost_condition.notify_all();
+  INF("Window has been lost, context is kept");
+}
+
 void AsyncContext::process_setWindow() {
   std::unique_lock<std::mutex> lock(m_surface_recovery_mutex);
+  bool resumed = m_context != EGL_NO_CONTEXT;
   if (__initDisplay__()) {
-    INF("Window has been successfully set for Context");
+    INF("Window has been successfully set for %s Context", resumed ? "existing" : "new");
     m_context_initialized.store(true);
     m_error_code = AsyncContextError::ACONTEXT_OK;
   } else {
     ERR("Initialization has failed, window was not set!");
     m_context_initialized.store(false);
     m_error_code = AsyncContextError::ACONTEXT_WINDOW_NOT_SET;
-    __fireStringEvent__("Failed to set window!");
+    __fireErrorEvent__(m_error_code);
     return;
   }
 
@@ -383,10 +642,16 @@ void AsyncContext::process_setDrawType() {
   std::unique_lock<std::mutex> lock(m_draw_type_mutex);
   switch (m_draw_type) {
     case DrawType::POINT_CLOUD:
-      m_draw_mode = GL_POINTS;
+      m_draw_mode = GL_POINTS;  // meshes are drawn this way, if octree could not be built
+      if (m_data_loaded && m_point_cloud == nullptr) {
+        __buildPointCloud__(false);
+      }
       break;
     case DrawType::WIREFRAME:
       m_draw_mode = GL_LINES;
+      if (m_data_loaded) {
+        __buildWireframes__();
+      }
       break;
     case DrawType::MESH:
       m_draw_mode = GL_TRIANGLES;
@@ -404,20 +669,87 @@ void AsyncContext::process_setAxisVisibility() {
   // no-op
 }
 
-void AsyncContext::process_gestureTranslation() {
-  std::unique_lock<std::mutex> lock(m_translation_gesture_mutex);
-  m_translation_x = m_translation_gesture->x;
-  m_translation_y = m_translation_gesture->y;
-  m_translation_z = m_translation_gesture->z;
+/// @brief All samples queued since the last frame are merged and applied at once.
+/// Touches are recognized in order of arrival, then released view coasts frame by frame.
+void AsyncContext::process_gestures() {
+  gesture::Accumulator merged;
+  gesture::Motion motion;
+  bool coasting = m_tracker.coasting();
+  gesture::Sample sample;
+  do {
+    while (m_gestures.pop(&sample)) {
+      if (sample.type == gesture::Sample::Type::TOUCH) {
+        m_tracker.touch(sample.touch, m_width, m_height, &motion);
+      } else {
+        merged.add(sample);
+      }
+    }
+  } while (__drainGestureBacklog__());
+  auto now = std::chrono::steady_clock::now();
+  if (coasting && m_tracker.coasting()) {
+    std::chrono::duration<GLfloat, std::milli> elapsed = now - m_coast_time;
+    m_tracker.coast(elapsed.count(), m_width, m_height, &motion);
+  }
+  m_coast_time = now;
+  m_coast_pending.store(m_tracker.coasting());
+
+  if (!motion.empty()) {
+    process_gestureRotation(gesture::Rotation(true, true, false, motion.angle_x, motion.angle_y, 0.0f));
+    m_translation_x += motion.translation_x;
+    m_translation_y += motion.translation_y;
+    m_scale_x *= motion.zoom;
+    m_scale_y *= motion.zoom;
+    m_scale_z *= motion.zoom;
+  }
+  if (merged.translated) {
+    process_gestureTranslation(merged.translation);
+  }
+  if (merged.rotated) {
+    process_gestureRotation(merged.rotation);
+  }
+  if (merged.zoomed) {
+    process_gestureZoom(merged.zoom);
+  }
 }
 
-void AsyncContext::process_gestureRotation() {
-  std::unique_lock<std::mutex> lock(m_rotation_gesture_mutex);
-  GLfloat x_angle = m_rotation_gesture->angle_x;
-  GLfloat y_angle = m_rotation_gesture->angle_y;
-  GLfloat z_angle = m_rotation_gesture->angle_z;
+/// @brief Gestures come from JNI thread only. While render thread is busy and
+/// queue is full, samples are merged aside: into the queue they are moved by
+/// the next samples or by render thread, whichever comes first.
+void AsyncContext::__pushGesture__(const gesture::Sample& sample) {
+  if (!m_gesture_backlog_pending.load() && m_gestures.push(sample)) {
+    return;  // render thread pushes only while backlog is pending
+  }
+  std::unique_lock<std::mutex> lock(m_gesture_backlog_mutex);
+  if (!m_gesture_backlog.empty() || !m_gestures.push(sample)) {
+    m_gesture_backlog.add(sample);
+    m_gesture_backlog.flush(&m_gestures);
+  }
+  m_gesture_backlog_pending.store(!m_gesture_backlog.empty());
+}
+
+/// @return true, if backlog was pending, so queue could have been refilled.
+bool AsyncContext::__drainGestureBacklog__() {
+  if (!m_gesture_backlog_pending.load()) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(m_gesture_backlog_mutex);
+  m_gesture_backlog.flush(&m_gestures);
+  m_gesture_backlog_pending.store(!m_gesture_backlog.empty());  // after the last push
+  return true;
+}
 
-  if (m_rotation_gesture->x_axis) {
+void AsyncContext::process_gestureTranslation(const gesture::Translation& gesture) {
+  m_translation_x = gesture.x;
+  m_translation_y = gesture.y;
+  m_translation_z = gesture.z;
+}
+
+void AsyncContext::process_gestureRotation(const gesture::Rotation& gesture) {
+  GLfloat x_angle = gesture.angle_x;
+  GLfloat y_angle = gesture.angle_y;
+  GLfloat z_angle = gesture.angle_z;
+
+  if (gesture.x_axis) {
     m_rotation_angle_x += x_angle;
 //    m_y_axis[0] = 0.0f;
 //    m_y_axis[1] = cos(x_angle / 180.0f * M_PI);
@@ -427,7 +759,7 @@ void AsyncContext::process_gestureRotation() {
 //    m_z_axis[1] = sin(x_angle / 180.0f * M_PI);
 //    m_z_axis[2] = cos(x_angle / 180.0f * M_PI);
   }
-  if (m_rotation_gesture->y_axis) {
+  if (gesture.y_axis) {
     m_rotation_angle_y += y_angle;
 //    m_x_axis[0] = cos(y_angle / 180.0f * M_PI);
 //    m_x_axis[1] = 0.0f;
@@ -437,16 +769,15 @@ void AsyncContext::process_gestureRotation() {
 //    m_z_axis[1] = 0.0f;
 //    m_z_axis[2] = cos(y_angle / 180.0f * M_PI);
   }
-  if (m_rotation_gesture->z_axis) {
+  if (gesture.z_axis) {
     m_rotation_angle_z += z_angle;
   }
 }
 
-void AsyncContext::process_gestureZoom() {
-  std::unique_lock<std::mutex> lock(m_zoom_gesture_mutex);
-  m_scale_x = m_zoom_gesture->scale_x;
-  m_scale_y = m_zoom_gesture->scale_y;
-  m_scale_z = m_zoom_gesture->scale_z;
+void AsyncContext::process_gestureZoom(const gesture::Zoom& gesture) {
+  m_scale_x = gesture.scale_x;
+  m_scale_y = gesture.scale_y;
+  m_scale_z = gesture.scale_z;
 }
 
 inline void AsyncContext::process_dropGestures() {
@@ -471,6 +802,7 @@ inline void AsyncContext::process_dropZoom() {
 
 inline void AsyncContext::process_clearSurface() {
   std::unique_lock<std::mutex> lock(m_clear_surface_mutex);
+  std::unique_lock<std::mutex> scene_lock(m_scene_mutex);  // pick() reads meshes
   clear();
 }
 
@@ -479,29 +811,52 @@ inline void AsyncContext::process_texturesEnabled() {
   // no-op
 }
 
+void AsyncContext::process_setFlatShading() {
+  if (m_data_loaded && m_scene != nullptr) {
+    m_scene_received.store(true);  // meshes are de-indexed at upload
+  }
+}
+
 void AsyncContext::process_sceneUploaded() {
   std::unique_lock<std::mutex> lock(m_scene_mutex);
   clear();  // clear previous scene
-  unsigned int total_meshes = m_scene->scene->mNumMeshes;
+  unsigned int total_meshes = __sourceScene__()->mNumMeshes;
   if (total_meshes <= 0) {
     m_error_code = AsyncContextError::ACONTEXT_NO_MESHES;
-    __fireStringEvent__("Failed to load scene! No meshes");
+    __fireErrorEvent__(m_error_code);
     return;
   }
 
   // preliminary check
   unsigned int total_vertices = 0;
   unsigned int total_polygons = 0;
+  unsigned int total_points = 0;  // vertices of other primitives, they go to point cloud only
   for (unsigned int mi = 0; mi < total_meshes; ++mi) {
-    aiMesh* pMesh = m_scene->scene->mMeshes[mi];
+    aiMesh* pMesh = __sourceScene__()->mMeshes[mi];
+    if (!isTriangleMesh(pMesh)) {
+      total_points += pMesh->mNumVertices;
+      continue;
+    }
     total_vertices += pMesh->mNumVertices;
     total_polygons += pMesh->mNumFaces;
   }
-  DBG("Scene: meshes=%zu, vertices=%zu, polygons=%zu", total_meshes, total_vertices, total_polygons);
+  DBG("Scene: meshes=%zu, vertices=%zu, polygons=%zu, points=%zu", total_meshes, total_vertices, total_polygons, total_points);
+  if (downsampleScenes && total_vertices > m_supremum_vertices &&
+      (!simplifyMeshes || 0.9f * m_supremum_vertices / total_vertices < lodMinRatio)) {
+    // too large even for levels of detail, thin it out on voxel grid first
+    unsigned int target_vertices = simplifyMeshes ? 0.9f * m_supremum_vertices / lodCoarsestRatio : m_supremum_vertices;
+    __downsampleScene__(target_vertices, &total_vertices, &total_polygons);
+  }
+  GLfloat coarsest_ratio = lodCoarsestRatio;
   if (total_vertices > m_supremum_vertices) {
-    m_error_code = AsyncContextError::ACONTEXT_SCENE_TOO_LARGE;
-    __fireStringEvent__("Scene is too large, buffer overflow!");
-    return;
+    // large scene is still accepted, if its coarsest level of detail fits into limit
+    coarsest_ratio = std::min(lodCoarsestRatio, 0.9f * m_supremum_vertices / total_vertices);
+    if (!simplifyMeshes || coarsest_ratio < lodMinRatio) {
+      m_error_code = AsyncContextError::ACONTEXT_SCENE_TOO_LARGE;
+      __fireErrorEvent__(m_error_code);
+      return;
+    }
+    INF("Scene exceeds vertex limit %u, coarsest level of detail keeps %.3f of polygons", m_supremum_vertices, coarsest_ratio);
   }
   m_data_loaded = true;
 
@@ -520,8 +875,17 @@ void AsyncContext::process_sceneUploaded() {
       total_textures = m_scene->totalSeparateTextures();
       DBG("Scene: has %zu textures", total_textures);
       m_has_textures = total_textures > 0;
+      // decode on workers, only uploads stay on this thread
+      JobSystem::get().parallelFor(total_textures, [this](size_t ti) {
+        if (!m_scene->textures[ti]->isResident() && m_scene->textures[ti]->canDecodeConcurrently()) {
+          m_scene->textures[ti]->decode(native::Texture::placeholderSize);
+        }
+      }, JobPriority::HIGH);
       for (GLuint ti = 0; ti < total_textures; ++ti) {
-        if (m_scene->textures[ti]->load()) {
+        // start from placeholders, residency promotes visible ones on first frames
+        if (m_scene->textures[ti]->isResident()) {
+          m_textures[ti] = m_scene->textures[ti];  // uploaded by another view of the group
+        } else if (m_scene->textures[ti]->load(native::Texture::placeholderSize)) {
           m_textures[ti] = m_scene->textures[ti];
         }
       }
@@ -534,18 +898,53 @@ void AsyncContext::process_sceneUploaded() {
     }
 
     // materials
-    unsigned int total_materials = m_scene->scene->mNumMaterials;
+    unsigned int total_materials = __sourceScene__()->mNumMaterials;
     DBG("Scene: has %zu materials", total_materials);
   }
 
+  // material records, resolved once
+  m_total_materials = __sourceScene__()->mNumMaterials;
+  m_materials = new MaterialHelper[m_total_materials];
+  for (GLsizeiptr mti = 0; mti < m_total_materials; ++mti) {
+    aiMaterial* material = __sourceScene__()->mMaterials[mti];
+    MaterialHelper& helper = m_materials[mti];
+    utils::assimp::getMaterial(material, &helper.material);
+    helper.color[0] = helper.material.diffuse[0];
+    helper.color[1] = helper.material.diffuse[1];
+    helper.color[2] = helper.material.diffuse[2];
+    helper.color[3] = helper.material.transparency;
+    if (m_has_textures) {
+      int tex_index = 0;
+      if (total_textures > 1) {
+        aiString tex_name;
+        utils::assimp::findTexture(material, &tex_name);
+        tex_index = m_scene->findTextureIndexByName(tex_name.C_Str());
+      }
+      // sometimes there is no material file, but texture file is present
+      // thus it is impossible to figure out, which material should be assigned
+      // to which mesh in the scene. If there is just the only texture, it is implied
+      // that such texture should be mapped to each mesh in the scene.
+      // Usually, there is also a single mesh with single texture in such cases.
+      auto it = m_textures.find(tex_index);
+      if (tex_index >= 0 && it != m_textures.end()) {
+        helper.texture = it->second;
+      }
+    }
+  }
+
   // data loading
   for (unsigned int mi = 0; mi < total_meshes; ++mi) {
-    aiMesh* pMesh = m_scene->scene->mMeshes[mi];
+    aiMesh* pMesh = __sourceScene__()->mMeshes[mi];
+    if (!isTriangleMesh(pMesh)) {
+      continue;  // left empty, not queued for drawing
+    }
     m_meshes[mi].num_vertices = pMesh->mNumVertices;
     m_meshes[mi].num_polygons = pMesh->mNumFaces;
     m_meshes[mi].vertices = new GLfloat[m_meshes[mi].num_vertices * 4];
     m_meshes[mi].normals = new GLfloat[m_meshes[mi].num_vertices * 3];
     utils::assimp::getRawVerticesNegativeXYZ(pMesh->mVertices, m_meshes[mi].num_vertices, &m_meshes[mi].vertices[0]);
+    utils::boundingSphere(&m_meshes[mi].vertices[0], m_meshes[mi].num_vertices, 4, &m_meshes[mi].center, &m_meshes[mi].radius);
+    utils::boundingBox(&m_meshes[mi].vertices[0], m_meshes[mi].num_vertices, 4, &m_meshes[mi].box_min, &m_meshes[mi].box_max);
     utils::assimp::getRawNormals(pMesh->mNormals, m_meshes[mi].num_vertices, &m_meshes[mi].normals[0]);
     if (pMesh->HasVertexColors(0)) {  // use first color set if any
       m_meshes[mi].has_colors = true;
@@ -558,37 +957,44 @@ void AsyncContext::process_sceneUploaded() {
     }
     m_meshes[mi].indices = new GLuint[m_meshes[mi].num_polygons * 3];
     utils::assimp::getRawTriangles(pMesh->mFaces, m_meshes[mi].num_polygons, &m_meshes[mi].indices[0]);
-    if (m_meshes[mi].num_vertices > rearrangeLimit) {
-      utils::rearrange4(m_meshes[mi].num_polygons, m_meshes[mi].indices, &m_meshes[mi].vertices[0], m_meshes[mi].num_vertices);
-      utils::rearrange3(m_meshes[mi].num_polygons, m_meshes[mi].indices, &m_meshes[mi].normals[0], m_meshes[mi].num_vertices);
-      if (pMesh->HasVertexColors(0)) {
-        utils::rearrange4(m_meshes[mi].num_polygons, m_meshes[mi].indices, &m_meshes[mi].colors[0], m_meshes[mi].num_vertices);
+    // meshes are simplified, then rearranged or optimized and narrowed to short indices afterwards
+    if (static_cast<GLsizeiptr>(pMesh->mMaterialIndex) < m_total_materials) {
+      m_meshes[mi].material_index = pMesh->mMaterialIndex;
+      if (m_meshes[mi].texture_coords != nullptr) {
+        m_meshes[mi].texture = m_materials[pMesh->mMaterialIndex].texture;
       }
-      if (pMesh->HasTextureCoords(0)) {
-        utils::rearrange2(m_meshes[mi].num_polygons, m_meshes[mi].indices, &m_meshes[mi].texture_coords[0], m_meshes[mi].num_vertices);
-      }
-    } else {
-      m_meshes[mi].short_indices = new GLushort[m_meshes[mi].num_polygons * 3];
-      utils::copy(&m_meshes[mi].indices[0], &m_meshes[mi].short_indices[0], m_meshes[mi].num_polygons * 3);
     }
-    if (m_has_textures) {
-      if (total_textures == 1) {
-        // sometimes there is no material file, but texture file is present
-        // thus it is impossible to figure out, which material should be assigned
-        // to which mesh in the scene. If there is just the only texture, it is implied
-        // that such texture should be mapped to each mesh in the scene.
-        // Usually, there is also a single mesh with single texture in such cases.
-        m_meshes[mi].tex_index = 0;
-      } else {
-        unsigned int mtl_index = pMesh->mMaterialIndex;
-        aiString tex_name;
-        aiMaterial* material = m_scene->scene->mMaterials[mtl_index];
-        aiTextureType type = utils::assimp::findTexture(material, &tex_name);
-        m_meshes[mi].tex_index = m_scene->findTextureIndexByName(tex_name.C_Str());
-      }
+  }
+  __placeInstances__();
+  __simplifyMeshes__(coarsest_ratio);
+  if (total_vertices > m_supremum_vertices) {
+    GLsizeiptr coarsest_vertices = 0;
+    for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+      const MeshHelper& mesh = m_meshes[mi];
+      coarsest_vertices += mesh.total_lods > 0 ? mesh.lods[mesh.total_lods - 1].num_vertices : mesh.num_vertices;
     }
-    delete [] m_meshes[mi].indices;  m_meshes[mi].indices = nullptr;
+    if (coarsest_vertices > m_supremum_vertices) {
+      WRN("Coarsest level of detail has %zu vertices, limit is %u", coarsest_vertices, m_supremum_vertices);
+      clear();
+      m_error_code = AsyncContextError::ACONTEXT_SCENE_TOO_LARGE;
+      __fireErrorEvent__(m_error_code);
+      return;
+    }
+  }
+  __optimizeMeshes__();
+  __buildTextureAtlases__();
+  __initTextureResidency__();
+  __buildBoundingVolumes__();
+  __buildRenderQueue__();
+  __buildBatches__();
+  if (total_points > 0 || m_draw_type == DrawType::POINT_CLOUD) {
+    __buildPointCloud__(true);
   }
+  if (m_draw_type == DrawType::WIREFRAME) {
+    __buildWireframes__();
+  }
+  __buildPickingHierarchies__();  // pick() is called on UI thread, it must not build them
+  GpuResources::get().logStats();
 }
 
 /* Draw procedure */
@@ -597,18 +1003,52 @@ inline void AsyncContext::render() {
   if (__checkScene__()) {
     __orientScene__();
     __drawAxis__();
-    for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
-      __drawMesh__(mi);
+    {
+      std::unique_lock<std::mutex> lock(m_pick_mutex);
+      m_pick_transform = m_projection * m_modelview;
+      m_pick_width = m_width;
+      m_pick_height = m_height;
     }
+    __projectMeshes__();
+    __updateTextureResidency__();
+    __selectLevelsOfDetail__();
+    m_frame_stats.drawn_meshes = 0;
+    m_frame_stats.draw_calls = 0;
+    m_frame_stats.drawn_polygons = 0;
+    m_frame_stats.drawn_edges = 0;
+    m_frame_stats.drawn_points = 0;
+    if (m_draw_type == DrawType::POINT_CLOUD && m_point_cloud != nullptr) {
+      __drawPointCloud__();
+    } else {
+      __beginMeshes__();
+      for (GLsizeiptr mi : m_render_queue) {
+        int bi = m_meshes[mi].batch_index;
+        if (bi >= 0) {
+          if (m_batches[bi].submeshes.front().mesh == mi) {
+            __drawBatch__(bi);  // once for all its meshes
+          }
+        } else if (m_meshes[mi].visible) {
+          __drawMesh__(mi);
+        }
+      }
+      __endMeshes__();
+    }
+    __fireFrameStatistics__();
     eglSwapInterval(m_display, 0);
     eglSwapBuffers(m_display, m_surface);
+    GpuResources::get().collect();  // objects released during frame or from other threads
   }
 }
 
 inline void AsyncContext::clear() {
+  __releaseTextureResidency__();  // before atlases, which could be staged
   m_error_code = AsyncContextError::ACONTEXT_OK;
   m_has_textures = false;
   m_textures.clear();
+  for (native::AtlasTexture* atlas : m_atlases) {
+    delete atlas;
+  }
+  m_atlases.clear();
 
   if (m_data_loaded) {
     m_data_loaded = false;
@@ -616,65 +1056,104 @@ inline void AsyncContext::clear() {
 
   m_total_meshes = 0;
   delete [] m_meshes;  m_meshes = nullptr;
+  m_total_materials = 0;
+  delete [] m_materials;  m_materials = nullptr;
+  m_total_batches = 0;
+  delete [] m_batches;  m_batches = nullptr;
+  m_instances.clear();
+  m_render_queue.clear();
+  m_mesh_bvh.clear();
+  m_visible_instances.clear();
+  delete m_point_cloud;  m_point_cloud = nullptr;
+  aiFreeScene(m_downsampled_scene);  m_downsampled_scene = nullptr;
+  m_point_nodes.clear();
+  m_missing_point_nodes.clear();
+  m_point_cloud_pending.store(false);
 }
 
 /* Configuration methods */
 // ----------------------------------------------------------------------------
+/// @brief Creates context on first call, then only window surface is replaced.
 bool AsyncContext::__initDisplay__() {
   DBG("enter AsyncContext::__initDisplay__().");
 
-  if ((m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY)) == EGL_NO_DISPLAY) {
-    ERR("eglGetDisplay() returned error %d", eglGetError());
+  if (m_context == EGL_NO_CONTEXT && !__initContext__()) {
     return false;
   }
+  __releaseSurface__();  // of previous window, if it has been changed without loss
 
-  if (!eglInitialize(m_display, 0, 0)) {
-    ERR("eglInitialize() returned error %d", eglGetError());
+  if (!(m_surface = eglCreateWindowSurface(m_display, m_config, m_window, 0))) {
+    ERR("eglCreateWindowSurface() returned error %d", eglGetError());
+    m_surface = EGL_NO_SURFACE;
     return false;
   }
 
-  {
-    EGLConfigChooser eglConfigChooser(5, 6, 5, 0, 16, 0);
-    m_config = eglConfigChooser.chooseConfig(m_display);
-    m_num_configs = eglConfigChooser.getNumberConfigs();
-    DBG("Number of EGL display configs: %i", m_num_configs);
+  if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context)) {
+    ERR("eglMakeCurrent() returned error %d", eglGetError());
+    __releaseSurface__();
+    return false;
   }
 
-  if (!eglGetConfigAttrib(m_display, m_config, EGL_NATIVE_VISUAL_ID, &m_format)) {
-    ERR("eglGetConfigAttrib() returned error %d", eglGetError());
-    this->__destroy__();
+  if (!eglQuerySurface(m_display, m_surface, EGL_WIDTH, &m_width) ||
+      !eglQuerySurface(m_display, m_surface, EGL_HEIGHT, &m_height)) {
+    ERR("eglQuerySurface() returned error %d", eglGetError());
+    __releaseSurface__();
     return false;
   }
 
-  if (!(m_surface = eglCreateWindowSurface(m_display, m_config, m_window, 0))) {
-    ERR("eglCreateWindowSurface() returned error %d", eglGetError());
-    this->__destroy__();
+  DBG("exit AsyncContext::__initDisplay__().");
+  return true;
+}
+
+bool AsyncContext::__initContext__() {
+  if ((m_display = ContextGroup::get().getDisplay()) == EGL_NO_DISPLAY) {
     return false;
   }
 
-  if (!(m_context = eglCreateContext(m_display, m_config, 0, 0))) {
-    ERR("eglCreateContext() returned error %d", eglGetError());
-    this->__destroy__();
+  if ((m_config = ContextGroup::get().getConfig()) == nullptr) {
+    ERR("No suitable EGL config");
     return false;
   }
 
-  if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context)) {
-    ERR("eglMakeCurrent() returned error %d", eglGetError());
-    this->__destroy__();
+  if (!eglGetConfigAttrib(m_display, m_config, EGL_NATIVE_VISUAL_ID, &m_format)) {
+    ERR("eglGetConfigAttrib() returned error %d", eglGetError());
     return false;
   }
 
-  if (!eglQuerySurface(m_display, m_surface, EGL_WIDTH, &m_width) ||
-      !eglQuerySurface(m_display, m_surface, EGL_HEIGHT, &m_height)) {
-    ERR("eglQuerySurface() returned error %d", eglGetError());
-    this->__destroy__();
+  // shares textures with other views, so the same scene is not uploaded twice
+  if ((m_context = ContextGroup::get().createContext(m_config)) == EGL_NO_CONTEXT) {
     return false;
   }
 
-  DBG("exit AsyncContext::__initDisplay__().");
+  const EGLint attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+  if ((m_pbuffer = eglCreatePbufferSurface(m_display, m_config, attributes)) == EGL_NO_SURFACE) {
+    WRN("eglCreatePbufferSurface() returned error %d, context is not current without window", eglGetError());
+  }
+
+  if (uploadThread) {
+    m_uploader = new Uploader(m_display, m_config);
+    if (m_uploader->start()) {
+      upload_completed_eventlistener = m_uploader->upload_completed_event.createListener(&AsyncContext::callback_uploadCompleted, this);
+    } else {
+      WRN("No upload thread, textures are uploaded on rendering thread");
+      delete m_uploader;  m_uploader = nullptr;
+    }
+  }
   return true;
 }
 
+/// @brief Context and all its objects outlive window: it stays current on pbuffer.
+void AsyncContext::__releaseSurface__() {
+  if (m_surface == EGL_NO_SURFACE) {
+    return;
+  }
+  if (m_pbuffer == EGL_NO_SURFACE || !eglMakeCurrent(m_display, m_pbuffer, m_pbuffer, m_context)) {
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  }
+  eglDestroySurface(m_display, m_surface);
+  m_surface = EGL_NO_SURFACE;
+}
+
 void AsyncContext::__windowConfig__() {
   ANativeWindow_setBuffersGeometry(m_window, 0, 0, m_format);
 }
@@ -685,7 +1164,7 @@ void AsyncContext::__initGLOptions__() {
   /* Surface options */
   DBG("Surface sizes: width=%i height=%i", m_width, m_height);
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-  glViewport(-4, -4, m_width + 4, m_height + 4);
+  glViewport(-viewportMargin, -viewportMargin, m_width + viewportMargin, m_height + viewportMargin);
 
   __setBgColor__();
   __setAxis__();
@@ -703,6 +1182,7 @@ void AsyncContext::__initGLOptions__() {
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
   glFrustumf(-ratio, ratio, -1.0f, 1.0f, 1.0f, 10.0f);
+  m_projection = utils::Matrix4f::frustum(-ratio, ratio, -1.0f, 1.0f, 1.0f, 10.0f);
 //  __setProjectionMatrix__();
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
@@ -732,6 +1212,7 @@ void AsyncContext::__setProjectionMatrix__() {  // replacement for gluPerspectiv
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
   glFrustumf(left, right, bottom, top, zNear, zFar);
+  m_projection = utils::Matrix4f::frustum(left, right, bottom, top, zNear, zFar);
 
   DBG("exit AsyncContext::__setProjectionMatrix__()");
 }
@@ -770,17 +1251,27 @@ void AsyncContext::__setAxis__() {
 
 void AsyncContext::__destroy__() {
   DBG("enter AsyncContext::__destroy__().");
+  __releaseTextureResidency__();
+  delete m_uploader;  m_uploader = nullptr;
+  for (native::AtlasTexture* atlas : m_atlases) {
+    delete atlas;
+  }
+  m_atlases.clear();
   if (m_display != EGL_NO_DISPLAY) {
+    GpuResources::get().collect();  // while context is still current
     eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-    if (m_context != EGL_NO_CONTEXT) {
-      eglDestroyContext(m_display, m_context);
-      m_context = EGL_NO_CONTEXT;
-    }
     if (m_surface != EGL_NO_SURFACE) {
       eglDestroySurface(m_display, m_surface);
       m_surface = EGL_NO_SURFACE;
     }
-    eglTerminate(m_display);
+    if (m_pbuffer != EGL_NO_SURFACE) {
+      eglDestroySurface(m_display, m_pbuffer);
+      m_pbuffer = EGL_NO_SURFACE;
+    }
+    if (m_context != EGL_NO_CONTEXT) {
+      ContextGroup::get().destroyContext(m_context);  // the last one terminates display
+      m_context = EGL_NO_CONTEXT;
+    }
     m_display = EGL_NO_DISPLAY;
   }
 
@@ -788,6 +1279,10 @@ void AsyncContext::__destroy__() {
   delete [] m_background_quad_vertices;  m_background_quad_vertices = nullptr;
   delete [] m_bgColor;  m_bgColor = nullptr;
   delete [] m_meshes;  m_meshes = nullptr;
+  delete [] m_materials;  m_materials = nullptr;
+  delete [] m_batches;  m_batches = nullptr;
+  delete m_point_cloud;  m_point_cloud = nullptr;
+  aiFreeScene(m_downsampled_scene);  m_downsampled_scene = nullptr;
 
   delete [] m_axis_x_colors;  m_axis_x_colors = nullptr;
   delete [] m_axis_y_colors;  m_axis_y_colors = nullptr;
@@ -820,54 +1315,1149 @@ void AsyncContext::__orientScene__() {
   this->__translate__();
   this->__rotate__();
   this->__zoom__();
+
+  // same transformations on CPU side, fixed-function matrices could not be read back cheaply
+  m_modelview = utils::Matrix4f::translation(m_translation_x, m_translation_y, m_translation_z) *
+                utils::Matrix4f::rotation(m_rotation_angle_y, m_y_axis[0], m_y_axis[1], m_y_axis[2]) *
+                utils::Matrix4f::rotation(-m_rotation_angle_x, m_x_axis[0], m_x_axis[1], m_x_axis[2]) *
+                utils::Matrix4f::rotation(m_rotation_angle_z, m_z_axis[0], m_z_axis[1], m_z_axis[2]) *
+                utils::Matrix4f::scale(m_scale_x, m_scale_y, m_scale_z);
 }
 
-void AsyncContext::__drawMesh__(int id) {
-  if (m_meshes == nullptr) {
+void AsyncContext::__buildRenderQueue__() {
+  m_render_queue.clear();
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    if (m_meshes[mi].num_polygons == 0) {
+      continue;
+    }
+    // texture binds are the most expensive, then material switches, then client states;
+    // textures are keyed by residency record, as their GL names change on reloading
+    m_meshes[mi].sort_key = (static_cast<uint64_t>(m_meshes[mi].residency_index + 1) << 32) |
+                            (static_cast<uint64_t>(m_meshes[mi].material_index + 1) << 1) |
+                            (m_meshes[mi].has_colors ? 1 : 0);
+    m_render_queue.push_back(mi);
+  }
+
+  GLsizeiptr unsorted_binds = 0, unsorted_switches = 0;
+  GLsizeiptr sorted_binds = 0, sorted_switches = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass == 1) {
+      std::stable_sort(m_render_queue.begin(), m_render_queue.end(),
+          [this](GLsizeiptr lhs, GLsizeiptr rhs) { return m_meshes[lhs].sort_key < m_meshes[rhs].sort_key; });
+    }
+    GLsizeiptr& binds = pass == 0 ? unsorted_binds : sorted_binds;
+    GLsizeiptr& switches = pass == 0 ? unsorted_switches : sorted_switches;
+    const native::Texture* texture = nullptr;
+    int material_index = -2;
+    for (GLsizeiptr mi : m_render_queue) {
+      if (m_meshes[mi].texture != nullptr && m_meshes[mi].texture != texture) {
+        texture = m_meshes[mi].texture;
+        ++binds;
+      }
+      if (m_meshes[mi].material_index != material_index) {
+        material_index = m_meshes[mi].material_index;
+        ++switches;
+      }
+    }
+  }
+  DBG("Render queue: %zu meshes, texture binds %zu -> %zu, material switches %zu -> %zu per frame",
+      m_total_meshes, unsorted_binds, sorted_binds, unsorted_switches, sorted_switches);
+}
+
+void AsyncContext::__buildBatches__() {
+  if (!batchMeshes) {
+    return;
+  }
+  auto batchable = [this](GLsizeiptr mi) {
+    const MeshHelper& mesh = m_meshes[mi];
+    return mesh.short_indices != nullptr && mesh.total_lods == 0 && mesh.num_vertices <= batchMaxVertices &&
+           mesh.total_instances == 1 && m_instances[mesh.first_instance].identity;  // placed once and baked
+  };
+  auto same_state = [this](GLsizeiptr lhs, GLsizeiptr rhs) {
+    return m_meshes[lhs].sort_key == m_meshes[rhs].sort_key && m_meshes[lhs].texture == m_meshes[rhs].texture;
+  };
+
+  // within the same state meshes follow Morton curve of their centers,
+  // so that culling leaves long runs of adjacent visible meshes in batch
+  utils::Vector3Df scene_min(1e30f, 1e30f, 1e30f), scene_max(-1e30f, -1e30f, -1e30f);
+  for (GLsizeiptr mi : m_render_queue) {
+    for (int k = 0; k < 3; ++k) {
+      scene_min[k] = std::min(scene_min[k], m_meshes[mi].center[k]);
+      scene_max[k] = std::max(scene_max[k], m_meshes[mi].center[k]);
+    }
+  }
+  std::vector<uint32_t> codes(m_total_meshes, 0);
+  for (GLsizeiptr mi : m_render_queue) {
+    codes[mi] = mortonCode(m_meshes[mi].center, scene_min, scene_max);
+  }
+  std::vector<std::pair<size_t, size_t>> groups;  // [begin, end) in render queue
+  for (size_t qi = 0; qi < m_render_queue.size(); ) {
+    size_t end = qi + 1;
+    while (end < m_render_queue.size() && same_state(m_render_queue[qi], m_render_queue[end])) {
+      ++end;
+    }
+    std::stable_sort(m_render_queue.begin() + qi, m_render_queue.begin() + end,
+        [&codes, &batchable](GLsizeiptr lhs, GLsizeiptr rhs) {
+          // meshes drawn alone go first, then batched ones in spatial order
+          return batchable(lhs) != batchable(rhs) ? !batchable(lhs) : codes[lhs] < codes[rhs];
+        });
+    // split batchable meshes of the group into batches within short index range
+    size_t begin = qi;
+    while (begin < end && !batchable(m_render_queue[begin])) {
+      ++begin;
+    }
+    while (begin < end) {
+      size_t last = begin;
+      GLsizeiptr total_vertices = 0;
+      while (last < end && total_vertices + m_meshes[m_render_queue[last]].num_vertices <= rearrangeLimit) {
+        total_vertices += m_meshes[m_render_queue[last]].num_vertices;
+        ++last;
+      }
+      if (last - begin > 1) {
+        groups.emplace_back(begin, last);
+      }
+      begin = last;
+    }
+    qi = end;
+  }
+  if (groups.empty()) {
     return;
   }
 
-  if (m_meshes[id].has_colors) {
-    glColorPointer(4, GL_FLOAT, 0, &m_meshes[id].colors[0]);
-    glEnableClientState(GL_COLOR_ARRAY);
+  m_total_batches = groups.size();
+  m_batches = new BatchHelper[m_total_batches];
+  GLsizeiptr total_batched = 0;
+  for (GLsizeiptr bi = 0; bi < m_total_batches; ++bi) {
+    BatchHelper& batch = m_batches[bi];
+    MeshHelper& geometry = batch.geometry;
+    const MeshHelper& head = m_meshes[m_render_queue[groups[bi].first]];
+    for (size_t qi = groups[bi].first; qi < groups[bi].second; ++qi) {
+      geometry.num_vertices += m_meshes[m_render_queue[qi]].num_vertices;
+      geometry.num_polygons += m_meshes[m_render_queue[qi]].num_polygons;
+    }
+    geometry.vertices = new GLfloat[geometry.num_vertices * 4];
+    geometry.normals = new GLfloat[geometry.num_vertices * 3];
+    if (head.has_colors) {
+      geometry.colors = new GLfloat[geometry.num_vertices * 4];
+    }
+    if (head.texture != nullptr) {
+      geometry.texture_coords = new GLfloat[geometry.num_vertices * 2];
+    }
+    geometry.short_indices = new GLushort[geometry.num_polygons * 3];
+
+    GLsizeiptr base_vertex = 0, first_index = 0;
+    for (size_t qi = groups[bi].first; qi < groups[bi].second; ++qi) {
+      GLsizeiptr mi = m_render_queue[qi];
+      MeshHelper& mesh = m_meshes[mi];
+      std::copy(&mesh.vertices[0], &mesh.vertices[mesh.num_vertices * 4], &geometry.vertices[base_vertex * 4]);
+      std::copy(&mesh.normals[0], &mesh.normals[mesh.num_vertices * 3], &geometry.normals[base_vertex * 3]);
+      if (geometry.colors != nullptr) {
+        std::copy(&mesh.colors[0], &mesh.colors[mesh.num_vertices * 4], &geometry.colors[base_vertex * 4]);
+      }
+      if (geometry.texture_coords != nullptr) {
+        std::copy(&mesh.texture_coords[0], &mesh.texture_coords[mesh.num_vertices * 2], &geometry.texture_coords[base_vertex * 2]);
+      }
+      GLsizeiptr total_indices = mesh.num_polygons * 3;
+      for (GLsizeiptr i = 0; i < total_indices; ++i) {
+        geometry.short_indices[first_index + i] = static_cast<GLushort>(mesh.short_indices[i] + base_vertex);
+      }
+      batch.submeshes.push_back(BatchHelper::Submesh{mi, first_index, total_indices});
+      mesh.batch_index = bi;
+      base_vertex += mesh.num_vertices;
+      first_index += total_indices;
+    }
+    total_batched += batch.submeshes.size();
   }
+  INF("Static batching: %zu meshes merged into %zu batches, %zu meshes drawn alone",
+      total_batched, m_total_batches, m_render_queue.size() - total_batched);
+}
 
-  if (!m_textures.empty() && m_textures_enabled && m_has_textures) {
-    if (m_meshes[id].tex_index != -1) {
-      m_textures.at(m_meshes[id].tex_index)->apply();
+void AsyncContext::__placeInstances__() {
+  std::vector<std::vector<utils::Matrix4f>> placements;
+  collectPlacements(__sourceScene__(), &placements);
+  GLsizeiptr total_baked = 0;
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    MeshHelper& mesh = m_meshes[mi];
+    mesh.first_instance = m_instances.size();
+    if (mesh.num_vertices == 0) {
+      continue;  // not drawn
+    }
+    std::vector<utils::Matrix4f>& transforms = placements[mi];
+    if (transforms.empty()) {
+      transforms.push_back(utils::Matrix4f::identity());  // not referenced by any node, drawn as is
+    }
+    if (transforms.size() == 1 && !isIdentity(transforms[0]) && mesh.num_vertices <= batchMaxVertices) {
+      // the only placement of small mesh goes into vertices, so that it could be batched,
+      // large ones are moved by modelview rather than by a pass over their vertices
+      transformGeometry(transforms[0], mesh.vertices, mesh.normals, mesh.num_vertices);
+      utils::boundingSphere(&mesh.vertices[0], mesh.num_vertices, 4, &mesh.center, &mesh.radius);
+      utils::boundingBox(&mesh.vertices[0], mesh.num_vertices, 4, &mesh.box_min, &mesh.box_max);
+      transforms[0] = utils::Matrix4f::identity();
+      ++total_baked;
     }
-    glEnable(GL_TEXTURE_2D);
-    glTexCoordPointer(2, GL_FLOAT, 0, &m_meshes[id].texture_coords[0]);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    for (const utils::Matrix4f& transform : transforms) {
+      InstanceHelper instance;
+      instance.mesh = mi;
+      instance.transform = transform;
+      instance.identity = isIdentity(transform);
+      instance.scale = transform.maxScale();
+      instance.center = transform.transformPoint(mesh.center);
+      instance.radius = mesh.radius * instance.scale;
+      for (int corner = 0; corner < 8; ++corner) {
+        utils::Vector3Df point = transform.transformPoint(utils::Vector3Df(
+            (corner & 1) ? mesh.box_max[0] : mesh.box_min[0],
+            (corner & 2) ? mesh.box_max[1] : mesh.box_min[1],
+            (corner & 4) ? mesh.box_max[2] : mesh.box_min[2]));
+        for (int k = 0; k < 3; ++k) {
+          instance.box_min[k] = corner == 0 ? point[k] : std::min(instance.box_min[k], point[k]);
+          instance.box_max[k] = corner == 0 ? point[k] : std::max(instance.box_max[k], point[k]);
+        }
+      }
+      instance.visible = true;
+      instance.pixels_per_unit = 0.0f;
+      instance.lod = 0;
+      m_instances.push_back(instance);
+    }
+    mesh.total_instances = transforms.size();
   }
+  INF("Scene graph: %zu instances of %zu meshes, %zu placements of small meshes baked into vertices",
+      m_instances.size(), m_total_meshes, total_baked);
+}
 
+void AsyncContext::__downsampleScene__(unsigned int target_vertices, unsigned int* total_vertices, unsigned int* total_polygons) {
+  auto start = std::chrono::steady_clock::now();
+  // triangle meshes only, other primitives go to point cloud, which has own budget
+  // on own copy: scene is shared by views and could be uploaded later with higher vertex limit
+  aiScene* scene = nullptr;
+  aiCopyScene(m_scene->scene, &scene);
+  if (scene == nullptr) {
+    ERR("Voxel downsampling has failed: scene could not be copied");
+    return;
+  }
+  aiDownsampleScene(scene, 0.0f, target_vertices, aiPrimitiveType_TRIANGLE);
+  m_downsampled_scene = scene;
+
+  unsigned int old_vertices = *total_vertices;
+  *total_vertices = 0;
+  *total_polygons = 0;
+  for (unsigned int mi = 0; mi < scene->mNumMeshes; ++mi) {
+    const aiMesh* pMesh = scene->mMeshes[mi];
+    if (isTriangleMesh(pMesh)) {
+      *total_vertices += pMesh->mNumVertices;
+      *total_polygons += pMesh->mNumFaces;
+    }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  INF("Voxel downsampling: vertices %u -> %u (target %u), polygons %u, %lli ms",
+      old_vertices, *total_vertices, target_vertices, *total_polygons, static_cast<long long>(elapsed.count()));
+}
+
+void AsyncContext::__simplifyMeshes__(GLfloat coarsest_ratio) {
+  if (!simplifyMeshes) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  unsigned int total_threads = parallelFor(m_total_meshes, [this, coarsest_ratio](GLsizeiptr mi) {
+    MeshHelper& mesh = m_meshes[mi];
+    if (mesh.num_polygons < lodMinPolygons) {
+      return;
+    }
+    // each level is simplified from the previous one, its ratio steps geometrically down to the coarsest
+    std::vector<std::vector<GLuint>> levels(lodLevels);
+    std::vector<GLfloat> errors(lodLevels, 0.0f);
+    const GLuint* indices = mesh.indices;
+    size_t total_indices = mesh.num_polygons * 3;
+    GLfloat error = 0.0f;
+    int total_levels = 0;
+    for (int li = 0; li < lodLevels; ++li) {
+      GLfloat ratio = std::pow(coarsest_ratio, static_cast<GLfloat>(li + 1) / lodLevels);
+      uint32_t target_indices = static_cast<uint32_t>(mesh.num_polygons * ratio) * 3;
+      error += utils::simplifier::simplify(mesh.vertices, 4, mesh.normals, mesh.texture_coords, mesh.num_vertices,
+          indices, total_indices, target_indices, &levels[li]);
+      if (levels[li].empty() || levels[li].size() > total_indices * 9 / 10) {
+        break;  // simplification is stuck, no use of more levels
+      }
+      errors[li] = error;
+      indices = &levels[li][0];
+      total_indices = levels[li].size();
+      ++total_levels;
+    }
+    if (total_levels == 0) {
+      return;
+    }
+
+    mesh.lods = new MeshHelper[total_levels];
+    mesh.total_lods = total_levels;
+    std::vector<GLuint> remap(mesh.num_vertices);
+    for (int li = 0; li < total_levels; ++li) {
+      MeshHelper& level = mesh.lods[li];
+      std::fill(remap.begin(), remap.end(), UINT32_MAX);
+      GLsizeiptr total_vertices = 0;
+      for (GLuint& index : levels[li]) {
+        if (remap[index] == UINT32_MAX) {
+          remap[index] = total_vertices++;
+        }
+      }
+      level.num_vertices = total_vertices;
+      level.num_polygons = levels[li].size() / 3;
+      level.lod_error = errors[li];
+      level.has_colors = mesh.has_colors;
+      level.vertices = new GLfloat[total_vertices * 4];
+      level.normals = new GLfloat[total_vertices * 3];
+      if (mesh.colors != nullptr) {
+        level.colors = new GLfloat[total_vertices * 4];
+      }
+      if (mesh.texture_coords != nullptr) {
+        level.texture_coords = new GLfloat[total_vertices * 2];
+      }
+      for (GLsizeiptr vi = 0; vi < mesh.num_vertices; ++vi) {
+        GLuint ni = remap[vi];
+        if (ni == UINT32_MAX) {
+          continue;
+        }
+        std::copy(&mesh.vertices[vi * 4], &mesh.vertices[vi * 4 + 4], &level.vertices[ni * 4]);
+        std::copy(&mesh.normals[vi * 3], &mesh.normals[vi * 3 + 3], &level.normals[ni * 3]);
+        if (level.colors != nullptr) {
+          std::copy(&mesh.colors[vi * 4], &mesh.colors[vi * 4 + 4], &level.colors[ni * 4]);
+        }
+        if (level.texture_coords != nullptr) {
+          std::copy(&mesh.texture_coords[vi * 2], &mesh.texture_coords[vi * 2 + 2], &level.texture_coords[ni * 2]);
+        }
+      }
+      level.indices = new GLuint[levels[li].size()];
+      for (size_t i = 0; i < levels[li].size(); ++i) {
+        level.indices[i] = remap[levels[li][i]];
+      }
+    }
+  });
+
+  GLsizeiptr total_polygons = 0, coarsest_polygons = 0, total_levels = 0;
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    const MeshHelper& mesh = m_meshes[mi];
+    total_polygons += mesh.num_polygons;
+    coarsest_polygons += mesh.total_lods > 0 ? mesh.lods[mesh.total_lods - 1].num_polygons : mesh.num_polygons;
+    total_levels += mesh.total_lods;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  INF("Mesh simplifier: %zu levels of detail, polygons %zu -> %zu at coarsest, %lli ms on %u threads",
+      total_levels, total_polygons, coarsest_polygons, static_cast<long long>(elapsed.count()), total_threads);
+}
+
+void AsyncContext::__optimizeMeshes__() {
+  struct Statistics {
+    bool indexed;
+    GLfloat acmr_before, acmr_after;
+    GLfloat atvr_before, atvr_after;
+  };
+  // every level of detail is a separate unit of work
+  std::vector<MeshHelper*> units;
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    units.push_back(&m_meshes[mi]);
+    for (int li = 0; li < m_meshes[mi].total_lods; ++li) {
+      units.push_back(&m_meshes[mi].lods[li]);
+    }
+  }
+  std::vector<Statistics> statistics(units.size(), Statistics{false, 0.0f, 0.0f, 0.0f, 0.0f});
+  auto start = std::chrono::steady_clock::now();
+
+  bool flat_shading = false;
+  {
+    std::unique_lock<std::mutex> lock(m_flat_shading_mutex);
+    flat_shading = m_flat_shading;
+  }
+  unsigned int total_threads = parallelFor(units.size(), [&units, &statistics, flat_shading](GLsizeiptr ui) {
+    MeshHelper& mesh = *units[ui];
+    if (mesh.indices == nullptr) {
+      return;
+    }
+    uint32_t total_indices = mesh.num_polygons * 3;
+    uint32_t total_vertices = mesh.num_vertices;
+    // too many vertices for short indices or flat shading, drawn with attributes per polygon vertex
+    bool deindex = flat_shading || mesh.num_vertices > rearrangeLimit;
+    statistics[ui].indexed = !deindex;
+    if (!deindex) {
+      statistics[ui].acmr_before = utils::optimizer::computeACMR(mesh.indices, total_indices, total_vertices);
+      statistics[ui].atvr_before = utils::optimizer::computeATVR(mesh.indices, total_indices, total_vertices);
+    }
+    if (optimizeMeshes) {
+      // de-indexed meshes are ordered as well, then their vertices are gathered mostly from cache
+      std::vector<uint32_t> clusters;
+      utils::optimizer::optimizeVertexCache(mesh.indices, total_indices, total_vertices,
+          utils::optimizer::cacheSize, optimizeOverdraw ? &clusters : nullptr);
+      if (optimizeOverdraw) {
+        utils::optimizer::optimizeOverdraw(mesh.indices, total_indices, mesh.vertices, 4, clusters);
+      }
+    }
+    if (deindex) {
+      __deindexMesh__(&mesh, flat_shading);
+      return;
+    }
+    if (optimizeMeshes) {
+      GLuint* remap = new GLuint[total_vertices];
+      utils::optimizer::optimizeVertexFetch(mesh.indices, total_indices, total_vertices, remap);
+      utils::optimizer::remapBuffer(mesh.vertices, 4, remap, total_vertices);
+      utils::optimizer::remapBuffer(mesh.normals, 3, remap, total_vertices);
+      if (mesh.colors != nullptr) {
+        utils::optimizer::remapBuffer(mesh.colors, 4, remap, total_vertices);
+      }
+      if (mesh.texture_coords != nullptr) {
+        utils::optimizer::remapBuffer(mesh.texture_coords, 2, remap, total_vertices);
+      }
+      delete [] remap;  remap = nullptr;
+    }
+    statistics[ui].acmr_after = utils::optimizer::computeACMR(mesh.indices, total_indices, total_vertices);
+    statistics[ui].atvr_after = utils::optimizer::computeATVR(mesh.indices, total_indices, total_vertices);
+
+    mesh.short_indices = new GLushort[total_indices];
+    utils::copy(&mesh.indices[0], &mesh.short_indices[0], total_indices);
+    delete [] mesh.indices;  mesh.indices = nullptr;
+  });
+
+  // averages are weighted by triangles and vertices respectively
+  GLfloat acmr_before = 0.0f, acmr_after = 0.0f, atvr_before = 0.0f, atvr_after = 0.0f;
+  GLsizeiptr total_polygons = 0, total_vertices = 0;
+  for (size_t ui = 0; ui < units.size(); ++ui) {
+    if (!statistics[ui].indexed) {
+      continue;
+    }
+    acmr_before += statistics[ui].acmr_before * units[ui]->num_polygons;
+    acmr_after += statistics[ui].acmr_after * units[ui]->num_polygons;
+    atvr_before += statistics[ui].atvr_before * units[ui]->num_vertices;
+    atvr_after += statistics[ui].atvr_after * units[ui]->num_vertices;
+    total_polygons += units[ui]->num_polygons;
+    total_vertices += units[ui]->num_vertices;
+  }
+  if (total_polygons > 0) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    INF("Mesh optimizer: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %lli ms on %u threads",
+        acmr_before / total_polygons, acmr_after / total_polygons,
+        atvr_before / total_vertices, atvr_after / total_vertices,
+        static_cast<long long>(elapsed.count()), total_threads);
+  }
+}
+
+/// @brief Replaces attributes of mesh by copies per polygon vertex, written out of place.
+/// Flat meshes take normal of triangle and color of its last vertex, as flat shade model
+/// of OpenGL does, and get consecutive vertices, so they are drawn as arrays only if
+/// short indices could not address them. Other meshes keep their number of vertices.
+void AsyncContext::__deindexMesh__(MeshHelper* mesh, bool flat) {
+  uint32_t total_indices = mesh->num_polygons * 3;
+  GLfloat* vertices = new GLfloat[total_indices * 4];
+  utils::gather<GLfloat, 4>(mesh->vertices, 4, mesh->indices, total_indices, vertices);
+  delete [] mesh->vertices;  mesh->vertices = vertices;
+
+  GLfloat* normals = new GLfloat[total_indices * 3];
+  if (flat) {
+    utils::faceNormals(vertices, 4, mesh->num_polygons, normals);
+  } else {
+    utils::gather<GLfloat, 3>(mesh->normals, 3, mesh->indices, total_indices, normals);
+  }
+  delete [] mesh->normals;  mesh->normals = normals;
+
+  if (mesh->texture_coords != nullptr) {
+    GLfloat* texture_coords = new GLfloat[total_indices * 2];
+    utils::gather<GLfloat, 2>(mesh->texture_coords, 2, mesh->indices, total_indices, texture_coords);
+    delete [] mesh->texture_coords;  mesh->texture_coords = texture_coords;
+  }
+
+  if (mesh->colors != nullptr) {
+    if (flat) {  // indices are not needed anymore, every polygon vertex refers to the last one
+      for (uint32_t i = 0; i < total_indices; i += 3) {
+        mesh->indices[i + 0] = mesh->indices[i + 2];
+        mesh->indices[i + 1] = mesh->indices[i + 2];
+      }
+    }
+    GLfloat* colors = new GLfloat[total_indices * 4];
+    utils::gather<GLfloat, 4>(mesh->colors, 4, mesh->indices, total_indices, colors);
+    delete [] mesh->colors;  mesh->colors = colors;
+  }
+  delete [] mesh->indices;  mesh->indices = nullptr;
+
+  if (flat) {
+    mesh->num_vertices = total_indices;
+    if (total_indices <= rearrangeLimit) {
+      mesh->short_indices = new GLushort[total_indices];
+      utils::populateIncremental(total_indices, &mesh->short_indices[0]);
+    }
+  }
+}
+
+/// @brief Rearranged meshes keep texture coords per polygon vertex.
+inline GLsizeiptr AsyncContext::__totalCoords__(const MeshHelper& mesh) {
+  return mesh.num_vertices > rearrangeLimit ? mesh.num_polygons * 3 : mesh.num_vertices;
+}
+
+void AsyncContext::__buildTextureAtlases__() {
+  if (!atlasTextures || m_textures.size() < 2) {
+    return;
+  }
+
+  // candidates: small textures, sampled only within [0, 1] by all their meshes
+  std::unordered_map<native::Texture*, bool> candidates;
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    const MeshHelper& mesh = m_meshes[mi];
+    if (mesh.texture == nullptr) {
+      continue;
+    }
+    auto it = candidates.find(mesh.texture);
+    if (it == candidates.end()) {
+      uint32_t size = std::max(mesh.texture->getWidth(), mesh.texture->getHeight());
+      bool candidate = size > 0 && size <= atlasTileLimit && mesh.texture->canDecodeRGBA();  // not compressed
+      it = candidates.emplace(mesh.texture, candidate).first;
+    }
+    // levels of detail reference a subset of the same coords
+    GLsizeiptr total_coords = __totalCoords__(mesh);
+    for (GLsizeiptr i = 0; it->second && i < total_coords * 2; ++i) {
+      if (mesh.texture_coords[i] < -0.001f || mesh.texture_coords[i] > 1.001f) {
+        it->second = false;  // repeated texture could not be atlased
+      }
+    }
+  }
+  std::vector<native::Texture*> textures;
+  for (auto& candidate : candidates) {
+    if (candidate.second) {
+      textures.push_back(candidate.first);
+    }
+  }
+  if (textures.size() < 2) {
+    return;
+  }
+
+  // skyline packing is tighter for tiles sorted by height
+  std::sort(textures.begin(), textures.end(), [](native::Texture* lhs, native::Texture* rhs) {
+    return lhs->getHeight() != rhs->getHeight() ? lhs->getHeight() > rhs->getHeight() : lhs->getWidth() > rhs->getWidth();
+  });
+  struct AtlasTile {
+    native::AtlasTexture* atlas;
+    GLfloat transform[4];
+  };
+  std::unordered_map<native::Texture*, AtlasTile> tiles;
+  native::AtlasTexture* atlas = nullptr;
+  for (native::Texture* texture : textures) {
+    uint32_t width = 0, height = 0;
+    uint8_t* pixels = texture->decodeRGBA(&width, &height);
+    if (pixels == nullptr) {
+      WRN("Texture %s could not be decoded, it is not atlased", texture->getName());
+      continue;  // decode failure never opens new atlas
+    }
+    AtlasTile tile;
+    bool added = atlas != nullptr && atlas->add(pixels, width, height, tile.transform);
+    if (!added) {
+      atlas = new native::AtlasTexture(atlasSize);
+      m_atlases.push_back(atlas);
+      added = atlas->add(pixels, width, height, tile.transform);
+    }
+    delete [] pixels;  pixels = nullptr;
+    if (!added) {
+      break;  // fresh atlas could not be allocated
+    }
+    tile.atlas = atlas;
+    tiles[texture] = tile;
+  }
+
+  // atlas of a single tile only wastes memory
+  for (auto it = m_atlases.begin(); it != m_atlases.end(); ) {
+    native::AtlasTexture* current = *it;
+    if (current->getTotalTiles() >= 2 && current->load(native::Texture::placeholderSize)) {
+      ++it;
+      continue;
+    }
+    for (auto tile = tiles.begin(); tile != tiles.end(); ) {
+      tile = tile->second.atlas == current ? tiles.erase(tile) : std::next(tile);
+    }
+    delete current;
+    it = m_atlases.erase(it);
+  }
+
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    MeshHelper& mesh = m_meshes[mi];
+    auto it = tiles.find(mesh.texture);
+    if (mesh.texture == nullptr || it == tiles.end()) {
+      continue;
+    }
+    const GLfloat* transform = it->second.transform;
+    for (int li = 0; li <= mesh.total_lods; ++li) {
+      MeshHelper& level = li == 0 ? mesh : mesh.lods[li - 1];
+      GLsizeiptr total_coords = __totalCoords__(level);
+      for (GLsizeiptr i = 0; i < total_coords; ++i) {
+        GLfloat u = std::min(std::max(level.texture_coords[i * 2 + 0], 0.0f), 1.0f);
+        GLfloat v = std::min(std::max(level.texture_coords[i * 2 + 1], 0.0f), 1.0f);
+        level.texture_coords[i * 2 + 0] = u * transform[0] + transform[2];
+        level.texture_coords[i * 2 + 1] = v * transform[1] + transform[3];
+      }
+    }
+    mesh.texture = it->second.atlas;
+  }
+  for (auto& tile : tiles) {
+    if (ContextGroup::get().getUsers(tile.first) == 0) {
+      tile.first->evict();  // not referenced by meshes anymore
+    }
+  }
+  INF("Texture atlases: %zu of %zu textures packed into %zu atlases, distinct textures %zu -> %zu",
+      tiles.size(), candidates.size(), m_atlases.size(), candidates.size(), candidates.size() - tiles.size() + m_atlases.size());
+}
+
+void AsyncContext::__initTextureResidency__() {
+  __releaseTextureResidency__();
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    native::Texture* texture = m_meshes[mi].texture;
+    if (texture == nullptr) {
+      continue;
+    }
+    auto it = std::find_if(m_residency.begin(), m_residency.end(),
+        [texture](const ResidencyItem& item) { return item.texture == texture; });
+    if (it == m_residency.end()) {
+      ResidencyItem item = {texture, 0.0f, 0, texture->getLevelSize(), false};
+      it = m_residency.insert(m_residency.end(), item);
+    }
+    m_meshes[mi].residency_index = static_cast<int>(it - m_residency.begin());
+  }
+  m_residency_order.resize(m_residency.size());
+  for (size_t ri = 0; ri < m_residency_order.size(); ++ri) {
+    m_residency_order[ri] = ri;
+    ContextGroup::get().retain(m_residency[ri].texture);
+  }
+  m_residency_pending.store(!m_residency.empty());
+  DBG("Texture residency: %zu textures, budget %zu bytes", m_residency.size(), GpuResources::get().getBudget(GpuCategory::TEXTURES));
+}
+
+void AsyncContext::__releaseTextureResidency__() {
+  if (m_uploader != nullptr) {
+    m_uploader->cancel();  // waits only for the texture being uploaded
+  }
+  for (const ResidencyItem& item : m_residency) {
+    ContextGroup::get().release(item.texture);
+  }
+  m_residency.clear();
+  m_residency_order.clear();
+  m_residency_pending.store(false);
+}
+
+void AsyncContext::__updateTextureResidency__() {
+  if (m_uploader != nullptr) {
+    m_uploader->collect();  // publish staged levels
+  }
+  if (m_residency.empty() || !m_textures_enabled) {
+    m_residency_pending.store(false);
+    return;
+  }
+
+  // demand: projected size of visible meshes, textures of invisible ones are not needed
+  for (ResidencyItem& item : m_residency) {
+    item.demand = 0.0f;
+  }
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    const MeshHelper& mesh = m_meshes[mi];
+    if (mesh.residency_index < 0) {
+      continue;
+    }
+    GLfloat diameter = 2.0f * mesh.radius * mesh.pixels_per_unit;
+    ResidencyItem& item = m_residency[mesh.residency_index];
+    item.demand = std::max(item.demand, diameter);
+  }
+
+  // target levels: power of two covering demand, not larger than texture itself
+  for (ResidencyItem& item : m_residency) {
+    uint32_t full_size = std::max(item.texture->getWidth(), item.texture->getHeight());
+    uint32_t target = native::Texture::placeholderSize;
+    while (target < item.demand && target < full_size) {
+      target <<= 1;
+    }
+    target = std::min(target, std::max(full_size, native::Texture::placeholderSize));
+    if (target < item.requested && target * 2 >= item.requested) {
+      target = item.requested;  // hysteresis, do not reload on small zoom changes
+    }
+    item.target = target;
+  }
+
+  // budget: most demanded textures are served first, the rest fall back to placeholders or get evicted
+  std::stable_sort(m_residency_order.begin(), m_residency_order.end(),
+      [this](size_t lhs, size_t rhs) { return m_residency[lhs].demand > m_residency[rhs].demand; });
+  size_t budget = GpuResources::get().getBudget(GpuCategory::TEXTURES);
+  if (budget == 0) {
+    budget = SIZE_MAX;
+  }
+  size_t used_bytes = 0;
+  for (size_t ri : m_residency_order) {
+    ResidencyItem& item = m_residency[ri];
+    size_t bytes = item.texture->estimateBytes(item.target);
+    if (used_bytes + bytes > budget) {
+      item.target = native::Texture::placeholderSize;
+      bytes = item.texture->estimateBytes(item.target);
+      if (used_bytes + bytes > budget) {
+        item.target = 0;
+        bytes = 0;
+      }
+    }
+    used_bytes += bytes;
+  }
+
+  // apply: demotions first to free memory, then promotions limited per frame
+  for (ResidencyItem& item : m_residency) {
+    if (item.failed || item.target >= item.requested) {
+      continue;
+    }
+    if (ContextGroup::get().getUsers(item.texture) > 1 || item.texture->isStaging()) {
+      continue;  // other views still draw it at the current level, or it is being uploaded
+    }
+    if (item.target == 0) {
+      item.texture->evict();
+    } else if (item.target <= native::Texture::placeholderSize) {
+      item.failed = !item.texture->loadPlaceholder();
+    } else {
+      item.failed = !item.texture->load(item.target);
+    }
+    item.requested = item.target;
+  }
+  size_t promoted_bytes = 0;
+  bool pending = false;
+  for (size_t ri : m_residency_order) {
+    ResidencyItem& item = m_residency[ri];
+    if (item.failed || item.target <= item.requested) {
+      continue;
+    }
+    if (item.texture->isStaging()) {
+      continue;  // published, when upload completes
+    }
+    if (item.texture->isResident() && item.texture->getLevelSize() >= item.target) {
+      item.requested = item.target;  // already promoted by another view
+      continue;
+    }
+    size_t bytes = item.texture->estimateBytes(item.target);
+    if (promoted_bytes > 0 && promoted_bytes + bytes > promotionBytesPerFrame) {
+      pending = true;
+      continue;
+    }
+    if (item.target <= native::Texture::placeholderSize) {
+      item.failed = !item.texture->loadPlaceholder();
+    } else if (m_uploader != nullptr && item.texture->canDecodeConcurrently()) {
+      if (!item.texture->reserveStage()) {
+        pending = true;  // other view is uploading it
+        continue;
+      }
+      __stageTexture__(item.texture, item.target);
+    } else {
+      item.failed = !item.texture->load(item.target);  // assets are read by this thread only
+    }
+    if (item.failed) {
+      WRN("Texture %s could not be made resident, it is not drawn anymore", item.texture->getName());
+    }
+    item.requested = item.target;
+    promoted_bytes += bytes;
+  }
+  m_residency_pending.store(pending);
+}
+
+void AsyncContext::__stageTexture__(native::Texture* texture, uint32_t max_size) {
+  m_uploader->submit(
+      [texture, max_size]() { return texture->stage(max_size); },
+      [this, texture](bool result) {
+        if (result) {
+          texture->publish();
+          return;
+        }
+        texture->cancelStage();
+        WRN("Texture %s could not be uploaded, it is not drawn anymore", texture->getName());
+        for (ResidencyItem& item : m_residency) {
+          if (item.texture == texture) {
+            item.failed = true;
+          }
+        }
+      });
+}
+
+void AsyncContext::__buildBoundingVolumes__() {
+  std::vector<utils::Vector3Df> mins(m_instances.size()), maxs(m_instances.size());
+  for (size_t ii = 0; ii < m_instances.size(); ++ii) {
+    mins[ii] = m_instances[ii].box_min;
+    maxs[ii] = m_instances[ii].box_max;
+  }
+  m_mesh_bvh.build(mins.data(), maxs.data(), m_instances.size());
+  DBG("Bounding volumes: %zu nodes over %zu instances", m_mesh_bvh.getTotalNodes(), m_instances.size());
+}
+
+void AsyncContext::__buildPickingHierarchies__() {
+  std::vector<MeshHelper*> missing;
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    if (m_meshes[mi].hierarchy == nullptr) {
+      missing.push_back(&m_meshes[mi]);
+    }
+  }
+  if (missing.empty()) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  unsigned int total_threads = parallelFor(missing.size(), [&missing](GLsizeiptr i) {
+    MeshHelper& mesh = *missing[i];
+    // full level of detail, as it is stored for drawing: rearranged meshes have no indices
+    mesh.hierarchy = new utils::TriangleHierarchy();
+    mesh.hierarchy->build(mesh.vertices, 4, mesh.short_indices, mesh.num_polygons);
+  });
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  INF("Picking hierarchies: %zu meshes, %lli ms on %u threads", missing.size(), static_cast<long long>(elapsed.count()), total_threads);
+}
+
+void AsyncContext::__buildWireframes__() {
+  std::vector<MeshHelper*> missing;
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    missing.push_back(&m_meshes[mi]);
+    for (int li = 0; li < m_meshes[mi].total_lods; ++li) {
+      missing.push_back(&m_meshes[mi].lods[li]);
+    }
+  }
+  missing.erase(std::remove_if(missing.begin(), missing.end(), [](const MeshHelper* mesh) {
+    return mesh->num_polygons == 0 || mesh->edge_indices != nullptr || mesh->edge_geometry != nullptr;
+  }), missing.end());
+  if (missing.empty()) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  GLsizeiptr total_edges = 0, total_polygons = 0;
+  std::vector<GLuint> edges;  // each mesh is processed by all threads in turn
+  for (MeshHelper* mesh : missing) {
+    bool rearranged = mesh->num_vertices > rearrangeLimit;
+    mesh->num_edges = utils::wireframe::buildEdges(mesh->vertices, 4,
+        rearranged ? mesh->num_polygons * 3 : mesh->num_vertices,
+        rearranged ? nullptr : mesh->short_indices, mesh->num_polygons, wireframeFeatureAngle, &edges);
+    total_edges += mesh->num_edges;
+    total_polygons += mesh->num_polygons;
+    if (!rearranged) {
+      mesh->edge_indices = new GLushort[edges.size()];
+      utils::copy(edges.data(), &mesh->edge_indices[0], edges.size());
+      continue;
+    }
+    // no short indices could address polygon vertices of rearranged mesh, so line ends are gathered
+    MeshHelper* lines = new MeshHelper();
+    lines->num_vertices = edges.size();
+    lines->vertices = new GLfloat[lines->num_vertices * 4];
+    lines->normals = new GLfloat[lines->num_vertices * 3];
+    if (mesh->colors != nullptr) {
+      lines->colors = new GLfloat[lines->num_vertices * 4];
+    }
+    if (mesh->texture_coords != nullptr) {
+      lines->texture_coords = new GLfloat[lines->num_vertices * 2];
+    }
+    for (GLsizeiptr i = 0; i < lines->num_vertices; ++i) {
+      GLuint vi = edges[i];
+      std::copy(&mesh->vertices[vi * 4], &mesh->vertices[vi * 4 + 4], &lines->vertices[i * 4]);
+      std::copy(&mesh->normals[vi * 3], &mesh->normals[vi * 3 + 3], &lines->normals[i * 3]);
+      if (lines->colors != nullptr) {
+        std::copy(&mesh->colors[vi * 4], &mesh->colors[vi * 4 + 4], &lines->colors[i * 4]);
+      }
+      if (lines->texture_coords != nullptr) {
+        std::copy(&mesh->texture_coords[vi * 2], &mesh->texture_coords[vi * 2 + 2], &lines->texture_coords[i * 2]);
+      }
+    }
+    mesh->edge_geometry = lines;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  INF("Wireframes: %zu meshes, %zu line indices instead of %zu per triangle, %lli ms",
+      missing.size(), total_edges * 2, total_polygons * 6, static_cast<long long>(elapsed.count()));
+}
+
+void AsyncContext::__buildPointCloud__(bool with_scene_points) {
+  auto start = std::chrono::steady_clock::now();
+  delete m_point_cloud;
+  m_point_cloud = new utils::PointOctree();
+  std::vector<GLfloat> placed;  // vertices of shared mesh moved to one of its placements
+  for (const InstanceHelper& instance : m_instances) {
+    const MeshHelper& mesh = m_meshes[instance.mesh];
+    if (instance.identity) {
+      m_point_cloud->addPoints(mesh.vertices, 4, mesh.colors, mesh.num_vertices);
+      continue;
+    }
+    placed.assign(&mesh.vertices[0], &mesh.vertices[mesh.num_vertices * 4]);
+    transformGeometry(instance.transform, &placed[0], nullptr, mesh.num_vertices);
+    m_point_cloud->addPoints(&placed[0], 4, mesh.colors, mesh.num_vertices);
+  }
+  std::vector<std::vector<utils::Matrix4f>> placements;
+  if (with_scene_points) {
+    collectPlacements(__sourceScene__(), &placements);
+  }
+  for (unsigned int mi = 0; with_scene_points && mi < __sourceScene__()->mNumMeshes; ++mi) {
+    aiMesh* pMesh = __sourceScene__()->mMeshes[mi];
+    if (isTriangleMesh(pMesh)) {
+      continue;  // taken from mesh helpers above
+    }
+    GLfloat* vertices = new GLfloat[pMesh->mNumVertices * 4];
+    GLfloat* colors = nullptr;
+    if (pMesh->HasVertexColors(0)) {
+      colors = new GLfloat[pMesh->mNumVertices * 4];
+      utils::assimp::getRawColors(pMesh->mColors[0], pMesh->mNumVertices, &colors[0]);
+    }
+    if (placements[mi].empty()) {
+      placements[mi].push_back(utils::Matrix4f::identity());
+    }
+    for (const utils::Matrix4f& transform : placements[mi]) {
+      utils::assimp::getRawVerticesNegativeXYZ(pMesh->mVertices, pMesh->mNumVertices, &vertices[0]);
+      if (!isIdentity(transform)) {
+        transformGeometry(transform, &vertices[0], nullptr, pMesh->mNumVertices);
+      }
+      m_point_cloud->addPoints(vertices, 4, colors, pMesh->mNumVertices);
+    }
+    delete [] vertices;  vertices = nullptr;
+    delete [] colors;  colors = nullptr;
+  }
+
+  if (!m_point_cloud->build(m_cache_directory.empty() ? nullptr : m_cache_directory.c_str())) {
+    delete m_point_cloud;  m_point_cloud = nullptr;
+    return;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  INF("Point cloud: %zu points, %zu nodes, %lli ms", m_point_cloud->getTotalPoints(), m_point_cloud->getTotalNodes(),
+      static_cast<long long>(elapsed.count()));
+}
+
+void AsyncContext::__drawPointCloud__() {
+  GLfloat planes[6][4];
+  (m_projection * m_modelview).frustumPlanes(planes);
+  GLfloat pixels_per_unit = m_projection.m[5] * m_height * 0.5f;  // at unit distance from eye
+  GLfloat z_near = m_projection.m[14] / (m_projection.m[10] - 1.0f);
+  m_point_cloud->select(planes, m_modelview, pixels_per_unit, z_near, pointBudget, &m_point_nodes, &m_missing_point_nodes);
+
+  // nodes are streamed a few per frame and drawn from the next one, so view refines while idle
+  size_t loaded_bytes = 0;
+  for (uint32_t node : m_missing_point_nodes) {
+    if (loaded_bytes >= pointLoadBytesPerFrame) {
+      break;
+    }
+    loaded_bytes += m_point_cloud->load(node);
+  }
+  m_point_cloud->evict(pointMemoryBudget);
+  m_point_cloud_pending.store(!m_missing_point_nodes.empty());
+
+  glPointSize(m_point_diameter);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+  for (uint32_t node : m_point_nodes) {
+    const utils::PointOctree::Point* points = m_point_cloud->getPoints(node);
+    glVertexPointer(3, GL_FLOAT, sizeof(utils::PointOctree::Point), points[0].position);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(utils::PointOctree::Point), points[0].color);
+    glDrawArrays(GL_POINTS, 0, m_point_cloud->getNodePoints(node));
+    ++m_frame_stats.draw_calls;
+    m_frame_stats.drawn_points += m_point_cloud->getNodePoints(node);
+  }
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void AsyncContext::__projectMeshes__() {
+  // planes of projection * modelview are in model space, so boxes are tested untransformed
+  GLfloat planes[6][4];
+  (m_projection * m_modelview).frustumPlanes(planes);
+  for (GLsizeiptr mi = 0; mi < m_total_meshes; ++mi) {
+    m_meshes[mi].visible = false;
+    m_meshes[mi].pixels_per_unit = 0.0f;
+  }
+  for (InstanceHelper& instance : m_instances) {
+    instance.visible = false;
+    instance.pixels_per_unit = 0.0f;
+  }
+  m_frame_stats.culled_nodes = m_mesh_bvh.cull(planes, &m_visible_instances);
+
+  GLfloat scale = m_modelview.maxScale();
+  GLfloat pixels_per_unit = m_projection.m[5] * m_height * 0.5f;  // at unit distance from eye
+  GLfloat z_near = m_projection.m[14] / (m_projection.m[10] - 1.0f);
+  GLsizeiptr total_visible = 0;
+  for (uint32_t ii : m_visible_instances) {
+    InstanceHelper& instance = m_instances[ii];
+    if (!utils::sphereInFrustum(planes, instance.center, instance.radius)) {
+      continue;  // leaves and partially visible nodes are not exact
+    }
+    instance.visible = true;
+    ++total_visible;
+    utils::Vector3Df center = m_modelview.transformPoint(instance.center);
+    GLfloat depth = std::max(-center[2] - instance.radius * scale, z_near);
+    instance.pixels_per_unit = scale * instance.scale * pixels_per_unit / depth;
+    // shared mesh is drawn, and its texture is demanded, for the closest instance
+    MeshHelper& mesh = m_meshes[instance.mesh];
+    mesh.visible = true;
+    mesh.pixels_per_unit = std::max(mesh.pixels_per_unit, instance.pixels_per_unit);
+  }
+  m_frame_stats.culled_meshes = m_instances.size() - total_visible;
+}
+
+void AsyncContext::__selectLevelsOfDetail__() {
+  for (InstanceHelper& instance : m_instances) {
+    const MeshHelper& mesh = m_meshes[instance.mesh];
+    if (!instance.visible) {
+      instance.lod = mesh.total_lods;  // culled, coarsest level is kept ready
+      continue;
+    }
+    // coarsest level, which error is not noticeable at the nearest point of bounding sphere
+    instance.lod = 0;
+    while (instance.lod < mesh.total_lods && mesh.lods[instance.lod].lod_error * instance.pixels_per_unit <= lodPixelError) {
+      ++instance.lod;
+    }
+  }
+}
+
+inline void AsyncContext::__beginMeshes__() {
   glEnable(GL_LIGHTING);
   glEnable(GL_COLOR_MATERIAL);
-
-  glVertexPointer(4, GL_FLOAT, 0, &m_meshes[id].vertices[0]);
   glEnableClientState(GL_VERTEX_ARRAY);
-  glNormalPointer(GL_FLOAT, 0, &m_meshes[id].normals[0]);
   glEnableClientState(GL_NORMAL_ARRAY);
 
-  if (m_meshes[id].num_vertices > rearrangeLimit) {
-    glDrawArrays(m_draw_mode, 0, m_meshes[id].num_polygons * 3);
-  } else {
-    glDrawElements(m_draw_mode, m_meshes[id].num_polygons * 3, GL_UNSIGNED_SHORT, &m_meshes[id].short_indices[0]);
+  m_render_state.material_index = -2;  // force material and color setup for the first mesh
+  m_render_state.texture_id = 0;
+  m_render_state.color_array = false;
+  m_render_state.textured = false;
+}
+
+/// @brief Applies material, color and texture of mesh and points client arrays to given ones.
+inline void AsyncContext::__applyMeshState__(const MeshHelper& mesh, const MeshHelper& arrays) {
+  const MaterialHelper* material = mesh.material_index >= 0 ? &m_materials[mesh.material_index] : nullptr;
+
+  bool material_changed = mesh.material_index != m_render_state.material_index;
+  if (material_changed) {
+    m_render_state.material_index = mesh.material_index;
+    if (material != nullptr) {
+      utils::Illumination::setMaterial(material->material);
+    } else {
+      utils::Illumination::setDefaultMaterial();
+    }
   }
 
-  glDisableClientState(GL_VERTEX_ARRAY);
-  glDisableClientState(GL_NORMAL_ARRAY);
+  if (mesh.has_colors != m_render_state.color_array) {
+    m_render_state.color_array = mesh.has_colors;
+    if (mesh.has_colors) {
+      glEnableClientState(GL_COLOR_ARRAY);
+    } else {
+      glDisableClientState(GL_COLOR_ARRAY);
+      material_changed = true;  // current color is undefined after drawing with color array
+    }
+  }
+  if (mesh.has_colors) {
+    glColorPointer(4, GL_FLOAT, 0, &arrays.colors[0]);
+  } else if (material_changed) {
+    if (material != nullptr) {
+      glColor4f(material->color[0], material->color[1], material->color[2], material->color[3]);
+    } else {
+      glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+  }
 
-  if (m_meshes[id].has_colors) {
-    glDisableClientState(GL_COLOR_ARRAY);
+  bool textured = m_textures_enabled && mesh.texture != nullptr && mesh.texture->getID() != 0;
+  if (textured != m_render_state.textured) {
+    m_render_state.textured = textured;
+    if (textured) {
+      glEnable(GL_TEXTURE_2D);
+      glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    } else {
+      glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+      glDisable(GL_TEXTURE_2D);
+    }
+  }
+  if (textured) {
+    if (mesh.texture->getID() != m_render_state.texture_id) {
+      m_render_state.texture_id = mesh.texture->getID();
+      mesh.texture->apply();
+    }
+    glTexCoordPointer(2, GL_FLOAT, 0, &arrays.texture_coords[0]);
+  }
+
+  glVertexPointer(4, GL_FLOAT, 0, &arrays.vertices[0]);
+  glNormalPointer(GL_FLOAT, 0, &arrays.normals[0]);
+}
+
+void AsyncContext::__drawMesh__(int id) {
+  if (m_meshes == nullptr) {
+    return;
   }
+  const MeshHelper& mesh = m_meshes[id];
+  // no instanced draws in fixed-function pipeline, shared arrays are drawn once per placement
+  for (GLsizeiptr ii = mesh.first_instance; ii < mesh.first_instance + mesh.total_instances; ++ii) {
+    const InstanceHelper& instance = m_instances[ii];
+    if (!instance.visible) {
+      continue;
+    }
+    const MeshHelper& geometry = instance.lod > 0 ? mesh.lods[instance.lod - 1] : mesh;
+    bool wireframe = m_draw_type == DrawType::WIREFRAME && (geometry.edge_indices != nullptr || geometry.edge_geometry != nullptr);
+    __applyMeshState__(mesh, wireframe && geometry.edge_geometry != nullptr ? *geometry.edge_geometry : geometry);
+    if (!instance.identity) {
+      glPushMatrix();
+      glMultMatrixf(&instance.transform.m[0]);
+    }
+
+    ++m_frame_stats.drawn_meshes;
+    ++m_frame_stats.draw_calls;
+    if (wireframe) {
+      if (geometry.edge_geometry != nullptr) {
+        glDrawArrays(GL_LINES, 0, geometry.num_edges * 2);
+      } else {
+        glDrawElements(GL_LINES, geometry.num_edges * 2, GL_UNSIGNED_SHORT, &geometry.edge_indices[0]);
+      }
+      m_frame_stats.drawn_edges += geometry.num_edges;
+    } else if (geometry.num_vertices > rearrangeLimit) {
+      glDrawArrays(m_draw_mode, 0, geometry.num_polygons * 3);
+      m_frame_stats.drawn_polygons += geometry.num_polygons;
+    } else {
+      glDrawElements(m_draw_mode, geometry.num_polygons * 3, GL_UNSIGNED_SHORT, &geometry.short_indices[0]);
+      m_frame_stats.drawn_polygons += geometry.num_polygons;
+    }
 
-  if (m_textures_enabled && m_has_textures) {
+    if (!instance.identity) {
+      glPopMatrix();
+    }
+  }
+}
+
+void AsyncContext::__drawBatch__(GLsizeiptr id) {
+  const BatchHelper& batch = m_batches[id];
+  if (m_draw_type == DrawType::WIREFRAME) {  // edges are kept per mesh
+    for (const BatchHelper::Submesh& submesh : batch.submeshes) {
+      if (m_meshes[submesh.mesh].visible) {
+        __drawMesh__(submesh.mesh);
+      }
+    }
+    return;
+  }
+
+  // visible meshes adjacent in index buffer are drawn by one call
+  bool applied = false;
+  GLsizeiptr first_index = 0, total_indices = 0;
+  for (const BatchHelper::Submesh& submesh : batch.submeshes) {
+    const MeshHelper& mesh = m_meshes[submesh.mesh];
+    if (!mesh.visible) {
+      continue;
+    }
+    if (!applied) {
+      __applyMeshState__(mesh, batch.geometry);  // the same for all meshes in batch
+      applied = true;
+    }
+    if (total_indices > 0 && first_index + total_indices != submesh.first_index) {
+      glDrawElements(m_draw_mode, total_indices, GL_UNSIGNED_SHORT, &batch.geometry.short_indices[first_index]);
+      ++m_frame_stats.draw_calls;
+      total_indices = 0;
+    }
+    if (total_indices == 0) {
+      first_index = submesh.first_index;
+    }
+    total_indices += submesh.total_indices;
+    ++m_frame_stats.drawn_meshes;
+    m_frame_stats.drawn_polygons += mesh.num_polygons;
+  }
+  if (total_indices > 0) {
+    glDrawElements(m_draw_mode, total_indices, GL_UNSIGNED_SHORT, &batch.geometry.short_indices[first_index]);
+    ++m_frame_stats.draw_calls;
+  }
+}
+
+inline void AsyncContext::__endMeshes__() {
+  if (m_render_state.color_array) {
+    glDisableClientState(GL_COLOR_ARRAY);
+  }
+  if (m_render_state.textured) {
     glBindTexture(GL_TEXTURE_2D, 0);
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
     glDisable(GL_TEXTURE_2D);
   }
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisableClientState(GL_NORMAL_ARRAY);
 
+  if (m_render_state.material_index >= 0) {
+    utils::Illumination::setDefaultMaterial();  // background and axis are drawn with default one
+  }
   glDisable(GL_LIGHTING);
   glDisable(GL_COLOR_MATERIAL);
 }
@@ -939,6 +2529,19 @@ inline void AsyncContext::__zoom__() {
   glScalef(m_scale_x, m_scale_y, m_scale_z);
 }
 
+/// @brief Forgets queued input and inertia, which are stale once window is gone.
+void AsyncContext::__dropPendingGestures__() {
+  gesture::Sample sample;
+  while (m_gestures.pop(&sample)) {}
+  {
+    std::unique_lock<std::mutex> lock(m_gesture_backlog_mutex);
+    m_gesture_backlog = gesture::Accumulator();
+    m_gesture_backlog_pending.store(false);
+  }
+  m_tracker.stop();
+  m_coast_pending.store(false);
+}
+
 inline void AsyncContext::__drop__() {
   __dropTranslation__();
   __dropRotation__();
@@ -946,12 +2549,14 @@ inline void AsyncContext::__drop__() {
 }
 
 inline void AsyncContext::__dropTranslation__() {
+  m_tracker.stop();
   m_translation_x = 0.0f;
   m_translation_y = 0.0f;
   m_translation_z = z_shift;
 }
 
 inline void AsyncContext::__dropRotation__() {
+  m_tracker.stop();
   m_rotation_angle_x = 0.0f;
   m_rotation_angle_y = 180.0f;
   m_rotation_angle_z = 180.0f;
@@ -967,9 +2572,17 @@ inline void AsyncContext::__dropZoom__() {
   m_scale_z = 1.0f;
 }
 
-inline void AsyncContext::__fireStringEvent__(const char* message) {
-  if (m_jenv != nullptr) {
-    jstring message_Java = m_jenv->NewStringUTF(message);  // String instance is managed by Java
-    m_jenv->CallVoidMethod(m_master_object, m_fireStringEvent_id, message_Java);
-  }
+inline void AsyncContext::__fireErrorEvent__(AsyncContextError error) {
+  m_events.error(static_cast<int>(error));
+  m_events.flush();  // errors are not postponed
+}
+
+inline void AsyncContext::__fireFrameStatistics__() {
+  // coalesced, so that Java receives the latest frame at channel rate
+  m_events.stats(static_cast<int>(FrameStatistic::DRAW_CALLS), m_frame_stats.draw_calls);
+  m_events.stats(static_cast<int>(FrameStatistic::DRAWN_MESHES), m_frame_stats.drawn_meshes);
+  m_events.stats(static_cast<int>(FrameStatistic::DRAWN_POLYGONS), m_frame_stats.drawn_polygons);
+  m_events.stats(static_cast<int>(FrameStatistic::DRAWN_EDGES), m_frame_stats.drawn_edges);
+  m_events.stats(static_cast<int>(FrameStatistic::DRAWN_POINTS), m_frame_stats.drawn_points);
+  m_events.stats(static_cast<int>(FrameStatistic::CULLED_MESHES), m_frame_stats.culled_meshes);
 }
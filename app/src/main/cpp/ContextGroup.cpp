@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "ContextGroup.h"
+#include "EGLConfigChooser.h"
+#include "GpuResources.h"
+#include "logger.h"
+
+
+ContextGroup& ContextGroup::get() {
+  static ContextGroup instance;
+  return instance;
+}
+
+ContextGroup::ContextGroup()
+  : m_display(EGL_NO_DISPLAY)
+  , m_config(nullptr)
+  , m_generation(0) {
+}
+
+// ----------------------------------------------------------------------------
+EGLDisplay ContextGroup::getDisplay() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_display != EGL_NO_DISPLAY) {
+    return m_display;
+  }
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display == EGL_NO_DISPLAY) {
+    ERR("eglGetDisplay() returned error %d", eglGetError());
+    return EGL_NO_DISPLAY;
+  }
+  if (!eglInitialize(display, 0, 0)) {
+    ERR("eglInitialize() returned error %d", eglGetError());
+    return EGL_NO_DISPLAY;
+  }
+  m_display = display;
+  return m_display;
+}
+
+EGLConfig ContextGroup::getConfig() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_config != nullptr || m_display == EGL_NO_DISPLAY) {
+    return m_config;
+  }
+  EGLConfigChooser eglConfigChooser(5, 6, 5, 0, 16, 0);
+  m_config = eglConfigChooser.chooseConfig(m_display, EGL_WINDOW_BIT | EGL_PBUFFER_BIT);
+  if (m_config == nullptr) {
+    m_config = eglConfigChooser.chooseConfig(m_display);
+  }
+  DBG("Number of EGL display configs: %i", eglConfigChooser.getNumberConfigs());
+  return m_config;
+}
+
+EGLContext ContextGroup::createContext(EGLConfig config) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_display == EGL_NO_DISPLAY) {
+    ERR("Context group: display has not been initialized");
+    return EGL_NO_CONTEXT;
+  }
+  EGLContext share = m_contexts.empty() ? EGL_NO_CONTEXT : m_contexts.back();
+  EGLContext context = eglCreateContext(m_display, config, share, 0);
+  if (context == EGL_NO_CONTEXT) {
+    // incompatible config would break sharing, so no private context either
+    ERR("eglCreateContext() returned error %d", eglGetError());
+    return EGL_NO_CONTEXT;
+  }
+  if (m_contexts.empty()) {
+    m_generation = GpuResources::get().newGeneration();  // objects of previous group are gone
+  }
+  m_contexts.push_back(context);
+  GpuResources::get().attach(context, m_generation);
+  DBG("Context group: %zu contexts", m_contexts.size());
+  return context;
+}
+
+void ContextGroup::destroyContext(EGLContext context) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = std::find(m_contexts.begin(), m_contexts.end(), context);
+  if (it == m_contexts.end()) {
+    return;
+  }
+  eglDestroyContext(m_display, context);
+  m_contexts.erase(it);
+  GpuResources::get().detach(context);
+  DBG("Context group: %zu contexts", m_contexts.size());
+  if (m_contexts.empty()) {
+    // the only display is terminated after the last view, not to break others
+    eglTerminate(m_display);
+    m_display = EGL_NO_DISPLAY;
+    m_config = nullptr;
+    GpuResources::get().contextLost(m_generation);
+  }
+}
+
+size_t ContextGroup::getTotalContexts() const {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_contexts.size();
+}
+
+/* Any thread */
+// ----------------------------------------------------------------------------
+void ContextGroup::retain(const void* resource) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ++m_users[resource];
+}
+
+void ContextGroup::release(const void* resource) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_users.find(resource);
+  if (it != m_users.end() && --it->second <= 0) {
+    m_users.erase(it);
+  }
+}
+
+int ContextGroup::getUsers(const void* resource) const {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_users.find(resource);
+  return it != m_users.end() ? it->second : 0;
+}
@@ -52,8 +52,12 @@ EGLConfigChooser::~EGLConfigChooser() {
 }
 
 EGLConfig EGLConfigChooser::chooseConfig(EGLDisplay display) {
+  return chooseConfig(display, EGL_WINDOW_BIT);
+}
+
+EGLConfig EGLConfigChooser::chooseConfig(EGLDisplay display, EGLint surface_type) {
   const EGLint attributes[] = {
-        EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+        EGL_SURFACE_TYPE, surface_type,
         EGL_TRANSPARENT_TYPE, EGL_NONE,
         EGL_NONE
     };
@@ -65,9 +69,11 @@ EGLConfig EGLConfigChooser::chooseConfig(EGLDisplay display) {
 
   if (m_num_configs <= 0) {
     WRN("No available configurations for such device and minimum attributes");
+    delete [] arg;
     return nullptr;
   }
 
+  delete [] m_configs;
   m_configs = new EGLConfig[m_num_configs];
   eglChooseConfig(display, attributes, m_configs, m_num_configs, arg);
   delete [] arg;
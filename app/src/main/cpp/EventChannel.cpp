@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "EventChannel.h"
+#include "logger.h"
+
+
+EventChannel::EventChannel(int max_rate)
+  : m_interval(max_rate > 0 ? 1000 / max_rate : 0)
+  , m_last_delivery()
+  , m_head(0), m_size(0)
+  , m_jenv(nullptr)
+  , m_object(nullptr)
+  , m_method(nullptr)
+  , m_codes(nullptr)
+  , m_values(nullptr)
+  , m_thread_id() {
+}
+
+EventChannel::~EventChannel() {
+  if (m_jenv != nullptr) {
+    WRN("Event channel has not been unbound, %i events are lost", m_size);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void EventChannel::bind(JNIEnv* jenv, jobject object, jmethodID method) {
+  jintArray codes = jenv->NewIntArray(capacity * 2);
+  jfloatArray values = jenv->NewFloatArray(capacity);
+  m_codes = (jintArray) jenv->NewGlobalRef(codes);
+  m_values = (jfloatArray) jenv->NewGlobalRef(values);
+  jenv->DeleteLocalRef(codes);
+  jenv->DeleteLocalRef(values);
+
+  m_jenv = jenv;
+  m_object = object;
+  m_method = method;
+  m_thread_id = std::this_thread::get_id();
+  m_last_delivery = std::chrono::steady_clock::time_point();
+}
+
+void EventChannel::unbind() {
+  if (m_jenv == nullptr || std::this_thread::get_id() != m_thread_id) {
+    return;
+  }
+  __deliver__(true);
+  m_jenv->DeleteGlobalRef(m_codes);
+  m_jenv->DeleteGlobalRef(m_values);
+  m_codes = nullptr;
+  m_values = nullptr;
+  m_jenv = nullptr;
+  m_object = nullptr;
+  m_method = nullptr;
+}
+
+// ----------------------------------------------------------------------------
+void EventChannel::progress(float percentage) {
+  __post__(NativeEventType::PROGRESS, 0, percentage);
+}
+
+void EventChannel::stage(int stage, int step) {
+  __post__(NativeEventType::STAGE, stage, step);
+}
+
+void EventChannel::stats(int key, float value) {
+  __post__(NativeEventType::STATS, key, value);
+}
+
+void EventChannel::error(int code) {
+  __post__(NativeEventType::ERROR, code, 0.0f);
+}
+
+void EventChannel::flush() {
+  __deliver__(true);
+}
+
+// ----------------------------------------------------------------------------
+void EventChannel::__post__(NativeEventType type, int code, float value) {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool coalesced = false;
+    for (int i = 0; i < m_size; ++i) {
+      Entry& entry = m_ring[(m_head + i) % capacity];
+      if (entry.type == type && entry.code == code) {
+        entry.value = value;
+        coalesced = true;
+        break;
+      }
+    }
+    if (!coalesced) {
+      if (m_size == capacity) {
+        WRN("Event channel is full, oldest event is dropped");
+        m_head = (m_head + 1) % capacity;
+        --m_size;
+      }
+      m_ring[(m_head + m_size) % capacity] = {type, code, value};
+      ++m_size;
+    }
+  }
+  __deliver__(false);
+}
+
+void EventChannel::__deliver__(bool force) {
+  if (m_jenv == nullptr || std::this_thread::get_id() != m_thread_id) {
+    return;  // only bound thread may call into Java
+  }
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - m_last_delivery < std::chrono::milliseconds(m_interval)) {
+    return;
+  }
+
+  jint codes[capacity * 2];
+  jfloat values[capacity];
+  jint count = 0;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (; count < m_size; ++count) {
+      const Entry& entry = m_ring[(m_head + count) % capacity];
+      codes[count * 2] = static_cast<jint>(entry.type);
+      codes[count * 2 + 1] = entry.code;
+      values[count] = entry.value;
+    }
+    m_head = 0;
+    m_size = 0;
+  }
+  if (count == 0) {
+    return;
+  }
+  m_jenv->SetIntArrayRegion(m_codes, 0, count * 2, codes);
+  m_jenv->SetFloatArrayRegion(m_values, 0, count, values);
+  m_jenv->CallVoidMethod(m_object, m_method, count, m_codes, m_values);
+  m_last_delivery = now;
+}
@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "GpuResources.h"
+#include "logger.h"
+
+
+GpuResources& GpuResources::get() {
+  static GpuResources instance;
+  return instance;
+}
+
+GpuResources::GpuResources() {
+  for (int i = 0; i < totalCategories; ++i) {
+    m_bytes[i].store(0);
+    m_pending_bytes[i].store(0);
+    m_budgets[i].store(0);  // unlimited
+  }
+  m_last_generation.store(0);
+}
+
+/* Rendering thread */
+// ----------------------------------------------------------------------------
+void GpuResources::allocated(GpuCategory category, size_t bytes) {
+  m_bytes[static_cast<int>(category)] += bytes;
+}
+
+void GpuResources::collect() {
+  uint32_t generation = getGeneration();
+  if (generation == 0) {
+    return;  // no context to delete objects in
+  }
+  std::vector<Release> releases;
+  {
+    std::unique_lock<std::mutex> lock(m_release_mutex);
+    auto it = std::partition(m_releases.begin(), m_releases.end(),
+        [generation](const Release& release) { return release.generation != generation; });
+    releases.assign(it, m_releases.end());
+    m_releases.erase(it, m_releases.end());  // objects of other contexts stay queued
+  }
+  for (const Release& release : releases) {
+    switch (release.category) {
+      case GpuCategory::TEXTURES:
+        glDeleteTextures(1, &release.id);
+        break;
+      case GpuCategory::BUFFERS:
+        glDeleteBuffers(1, &release.id);
+        break;
+    }
+    __subtract__(m_pending_bytes[static_cast<int>(release.category)], release.bytes);
+  }
+}
+
+/* Context owners */
+// ----------------------------------------------------------------------------
+uint32_t GpuResources::newGeneration() {
+  return ++m_last_generation;
+}
+
+void GpuResources::attach(EGLContext context, uint32_t generation) {
+  std::unique_lock<std::mutex> lock(m_context_mutex);
+  m_contexts[context] = generation;
+}
+
+void GpuResources::detach(EGLContext context) {
+  std::unique_lock<std::mutex> lock(m_context_mutex);
+  m_contexts.erase(context);
+}
+
+void GpuResources::contextLost(uint32_t generation) {
+  std::unique_lock<std::mutex> lock(m_release_mutex);
+  for (auto it = m_releases.begin(); it != m_releases.end(); ) {
+    if (it->generation == generation) {
+      __subtract__(m_pending_bytes[static_cast<int>(it->category)], it->bytes);  // just accounted
+      it = m_releases.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  DBG("GPU resources: generation %u lost", generation);
+}
+
+/* Any thread */
+// ----------------------------------------------------------------------------
+void GpuResources::release(GpuCategory category, GLuint id, size_t bytes, uint32_t generation) {
+  int index = static_cast<int>(category);
+  __subtract__(m_bytes[index], bytes);
+  if (!__isAlive__(generation)) {
+    return;  // context is gone with its objects
+  }
+  m_pending_bytes[index] += bytes;
+  Release release = {category, id, bytes, generation};
+  std::unique_lock<std::mutex> lock(m_release_mutex);
+  m_releases.push_back(release);
+}
+
+void GpuResources::setBudget(GpuCategory category, size_t bytes) {
+  m_budgets[static_cast<int>(category)].store(bytes);
+}
+
+size_t GpuResources::getBudget(GpuCategory category) const {
+  return m_budgets[static_cast<int>(category)].load();
+}
+
+size_t GpuResources::getBytes(GpuCategory category) const {
+  return m_bytes[static_cast<int>(category)].load();
+}
+
+size_t GpuResources::getPendingBytes(GpuCategory category) const {
+  return m_pending_bytes[static_cast<int>(category)].load();
+}
+
+size_t GpuResources::getTotalBytes() const {
+  size_t total = 0;
+  for (int i = 0; i < totalCategories; ++i) {
+    total += m_bytes[i].load();
+  }
+  return total;
+}
+
+bool GpuResources::fits(GpuCategory category, size_t bytes) const {
+  size_t budget = getBudget(category);
+  return budget == 0 || getBytes(category) + bytes <= budget;
+}
+
+uint32_t GpuResources::getGeneration() const {
+  EGLContext context = eglGetCurrentContext();
+  std::unique_lock<std::mutex> lock(m_context_mutex);
+  auto it = m_contexts.find(context);
+  return it != m_contexts.end() ? it->second : 0;
+}
+
+void GpuResources::logStats() const {
+  INF("GPU memory: textures %zu of %zu bytes (%zu pending release), buffers %zu of %zu bytes (%zu pending release)",
+      getBytes(GpuCategory::TEXTURES), getBudget(GpuCategory::TEXTURES), getPendingBytes(GpuCategory::TEXTURES),
+      getBytes(GpuCategory::BUFFERS), getBudget(GpuCategory::BUFFERS), getPendingBytes(GpuCategory::BUFFERS));
+}
+
+// ----------------------------------------------------------------------------
+void GpuResources::__subtract__(std::atomic<size_t>& value, size_t bytes) {
+  size_t current = value.load();
+  while (!value.compare_exchange_weak(current, current - std::min(bytes, current))) {
+    // current is reloaded by failed exchange
+  }
+}
+
+bool GpuResources::__isAlive__(uint32_t generation) const {
+  std::unique_lock<std::mutex> lock(m_context_mutex);
+  for (auto& context : m_contexts) {
+    if (context.second == generation) {
+      return true;
+    }
+  }
+  return false;
+}
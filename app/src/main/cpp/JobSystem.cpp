@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "JobSystem.h"
+#include "logger.h"
+
+
+static thread_local int workerIndex = -1;  // queue owned by current thread, -1 - not a worker
+
+JobSystem& JobSystem::get() {
+  static JobSystem instance;
+  return instance;
+}
+
+JobSystem::JobSystem()
+  : m_queued(0)
+  , m_stopping(false) {
+  unsigned int total_workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+  total_workers = std::max(1u, total_workers);
+  for (unsigned int wi = 0; wi <= total_workers; ++wi) {
+    m_queues.emplace_back(new Queue());
+  }
+  for (unsigned int wi = 0; wi < total_workers; ++wi) {
+    m_threads.emplace_back(&JobSystem::__loop__, this, wi);
+  }
+  INF("Job system: %u worker threads", total_workers);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    m_stopping.store(true);
+  }
+  m_wake_up.notify_all();
+  for (std::thread& thread : m_threads) {
+    thread.join();
+  }
+}
+
+// ----------------------------------------------------------------------------
+void JobSystem::submit(std::function<void()> job, JobPriority priority, Group* group) {
+  if (group != nullptr) {
+    group->m_pending.fetch_add(1, std::memory_order_relaxed);
+    int current = group->m_priority.load(std::memory_order_relaxed);
+    while (current < static_cast<int>(priority) &&
+           !group->m_priority.compare_exchange_weak(current, static_cast<int>(priority), std::memory_order_relaxed)) {
+      // current is reloaded by failed exchange
+    }
+  }
+  Queue& queue = *m_queues[workerIndex >= 0 ? workerIndex : m_queues.size() - 1];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs[static_cast<int>(priority)].push_back(Job{std::move(job), group});
+  }
+  m_queued.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(m_sleep_mutex);  // worker could not miss wake up between check and wait
+  }
+  m_wake_up.notify_one();
+}
+
+void JobSystem::wait(Group* group) {
+  unsigned int own = workerIndex >= 0 ? workerIndex : m_queues.size() - 1;
+  int lowest_priority = group->m_priority.load(std::memory_order_relaxed);  // less urgent jobs could be long
+  Job job;
+  while (!group->done()) {
+    if (__take__(own, &job, lowest_priority)) {
+      __run__(&job);
+      continue;
+    }
+    // the last jobs of group are running elsewhere
+    std::unique_lock<std::mutex> lock(m_done_mutex);
+    m_group_done.wait(lock, [group]() { return group->done(); });
+  }
+}
+
+// ----------------------------------------------------------------------------
+void JobSystem::__loop__(unsigned int worker) {
+  workerIndex = worker;
+  Job job;
+  while (!m_stopping.load()) {
+    if (__take__(worker, &job)) {
+      __run__(&job);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+    m_wake_up.wait(lock, [this]() { return m_queued.load() > 0 || m_stopping.load(); });
+  }
+}
+
+/// @brief Higher priority goes first: own newest job, then the oldest one of others.
+bool JobSystem::__take__(unsigned int own, Job* job, int lowest_priority) {
+  if (m_queued.load() == 0) {
+    return false;
+  }
+  size_t total_queues = m_queues.size();
+  for (int pi = 0; pi <= lowest_priority; ++pi) {
+    {
+      Queue& queue = *m_queues[own];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.jobs[pi].empty()) {
+        *job = std::move(queue.jobs[pi].back());
+        queue.jobs[pi].pop_back();
+        m_queued.fetch_sub(1);
+        return true;
+      }
+    }
+    for (size_t offset = 1; offset < total_queues; ++offset) {
+      Queue& victim = *m_queues[(own + offset) % total_queues];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.jobs[pi].empty()) {
+        *job = std::move(victim.jobs[pi].front());
+        victim.jobs[pi].pop_front();
+        m_queued.fetch_sub(1);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void JobSystem::__run__(Job* job) {
+  job->function();
+  job->function = nullptr;  // release captures before group is reported done
+  if (job->group != nullptr && job->group->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    {
+      std::lock_guard<std::mutex> lock(m_done_mutex);  // waiter could not miss it between check and wait
+    }
+    m_group_done.notify_all();  // group itself could be gone already
+  }
+}
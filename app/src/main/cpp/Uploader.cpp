@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ContextGroup.h"
+#include "logger.h"
+#include "Uploader.h"
+
+
+Uploader::Uploader(EGLDisplay display, EGLConfig config)
+  : m_display(display)
+  , m_config(config)
+  , m_context(EGL_NO_CONTEXT)
+  , m_pbuffer(EGL_NO_SURFACE)
+  , m_state(State::STARTING)
+  , m_running(false) {
+  DBG("Uploader ctor");
+}
+
+Uploader::~Uploader() {
+  DBG("Uploader ~dtor");
+  stop();
+  cancel();  // jobs left after stop
+  if (m_pbuffer != EGL_NO_SURFACE) {
+    eglDestroySurface(m_display, m_pbuffer);
+    m_pbuffer = EGL_NO_SURFACE;
+  }
+  if (m_context != EGL_NO_CONTEXT) {
+    ContextGroup::get().destroyContext(m_context);
+    m_context = EGL_NO_CONTEXT;
+  }
+}
+
+bool Uploader::start() {
+  if ((m_context = ContextGroup::get().createContext(m_config)) == EGL_NO_CONTEXT) {
+    return false;
+  }
+  const EGLint attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+  if ((m_pbuffer = eglCreatePbufferSurface(m_display, m_config, attributes)) == EGL_NO_SURFACE) {
+    WRN("eglCreatePbufferSurface() returned error %d, no upload thread", eglGetError());
+    return false;
+  }
+  launch();
+  std::unique_lock<std::mutex> lock(m_state_mutex);
+  m_state_condition.wait(lock, [this]() { return m_state != State::STARTING; });
+  return m_state == State::READY;
+}
+
+/* Rendering thread */
+// ----------------------------------------------------------------------------
+void Uploader::submit(std::function<bool()> job, std::function<void(bool)> done) {
+  {
+    std::unique_lock<std::mutex> lock(m_jobs_mutex);
+    m_jobs.push_back(Job{std::move(job), std::move(done)});
+  }
+  interrupt();
+}
+
+size_t Uploader::collect() {
+  std::vector<Completion> completed;
+  {
+    std::unique_lock<std::mutex> lock(m_jobs_mutex);
+    completed.swap(m_completed);
+  }
+  for (Completion& completion : completed) {
+    completion.done(completion.result);
+  }
+  return completed.size();
+}
+
+void Uploader::cancel() {
+  {
+    std::unique_lock<std::mutex> lock(m_jobs_mutex);
+    for (Job& job : m_jobs) {
+      m_completed.push_back(Completion{std::move(job.done), false});
+    }
+    m_jobs.clear();
+    m_idle_condition.wait(lock, [this]() { return !m_running; });
+  }
+  collect();
+}
+
+/* Upload thread */
+// ----------------------------------------------------------------------------
+bool Uploader::checkForWakeUp() {
+  std::unique_lock<std::mutex> lock(m_jobs_mutex);
+  return !m_jobs.empty();
+}
+
+void Uploader::eventHandler() {
+  Job job;
+  {
+    std::unique_lock<std::mutex> lock(m_jobs_mutex);
+    if (m_jobs.empty()) {
+      return;
+    }
+    job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    m_running = true;
+  }
+  bool result = job.upload();
+  glFinish();  // the only way to know upload has completed in GLES 1.x
+  {
+    std::unique_lock<std::mutex> lock(m_jobs_mutex);
+    m_completed.push_back(Completion{std::move(job.done), result});
+    m_running = false;
+  }
+  m_idle_condition.notify_all();
+  upload_completed_event.notifyListeners(result);
+}
+
+void Uploader::onStart() {
+  ActiveObject::onStart();
+  bool current = eglMakeCurrent(m_display, m_pbuffer, m_pbuffer, m_context);
+  if (!current) {
+    ERR("eglMakeCurrent() on upload thread returned error %d", eglGetError());
+    m_continue_running.store(false);
+  }
+  std::unique_lock<std::mutex> lock(m_state_mutex);
+  m_state = current ? State::READY : State::FAILED;
+  m_state_condition.notify_all();
+}
+
+void Uploader::onStop() {
+  eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  ActiveObject::onStop();
+}
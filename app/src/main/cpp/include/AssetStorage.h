@@ -50,6 +50,7 @@ public:
   void close();
   bool read(void* buffer);
   bool read(void* buffer, size_t size);
+  const void* buffer();
   inline off_t length() const {
     return m_length;
   }
@@ -32,8 +32,11 @@
 #include <jni.h>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -42,14 +45,31 @@
 
 #include "ActiveObject.h"
 #include "AsyncContextError.h"
+#include "bvh.h"
 #include "DrawType.h"
+#include "EventChannel.h"
 #include "EventListener.h"
 #include "gesture.h"
+#include "material.h"
+#include "matrix.h"
+#include "octree.h"
+#include "raycast.h"
 #include "Scene.h"
 #include "Texture.h"
+#include "Uploader.h"
 #include "vector3D.h"
 
 
+/// @brief Keys of STATS events sent for rendered frames, values are shared with NativeEvent.java.
+enum class FrameStatistic : int {
+  DRAW_CALLS = 0,
+  DRAWN_MESHES = 1,
+  DRAWN_POLYGONS = 2,
+  DRAWN_EDGES = 3,
+  DRAWN_POINTS = 4,
+  CULLED_MESHES = 5
+};
+
 class AsyncContext : public ActiveObject {
   friend class AsyncContextBundle;
 public:
@@ -59,22 +79,30 @@ public:
   virtual ~AsyncContext();
 
   void setEnvironment(JNIEnv* jenv, const jobject& global_object, jmethodID method_id);
+  /// @brief Directory for temporary files, such as point cloud cache.
+  void setCacheDirectory(const char* path);
 
   // Callbacks
   void callback_setWindow(ANativeWindow* window);
+  void callback_surfaceLost(bool dummy);
+  void callback_uploadCompleted(bool result);
   void callback_setVertexLimit(uint32_t limit);
   void callback_setDrawType(DrawType type);
   void callback_setBgColor(const char* bgColor);
   void callback_setAxisVisibility(bool isVisible);
-  void callback_gestureTranslation(gesture::Translation::Ptr gesture);
-  void callback_gestureRotation(gesture::Rotation::Ptr gesture);
-  void callback_gestureZoom(gesture::Zoom::Ptr gesture);
+  void callback_gestureTranslation(gesture::Translation gesture);
+  void callback_gestureRotation(gesture::Rotation gesture);
+  void callback_gestureZoom(gesture::Zoom gesture);
+  void callback_gestureTouch(gesture::Touch touch);
   void callback_dropGestures(bool dummy);
   void callback_dropTranslation(bool dummy);
   void callback_dropRotation(bool dummy);
   void callback_dropZoom(bool dummy);
   void callback_clearSurface(bool dummy);
   void callback_texturesEnabled(bool enabled);
+  /// @brief De-indexes meshes at upload, so that they are lit and colored per triangle.
+  /// @details Loaded scene is uploaded again.
+  void callback_setFlatShading(bool enabled);
   void callback_sceneUploaded(native::Scene* scene);
 
   Event<bool> context_destroyed_event;
@@ -83,9 +111,9 @@ public:
   inline GLfloat getTranslationY() { return m_translation_y; }
   inline GLfloat getTranslationZ() { return m_translation_z; }
 
-  inline bool getRotationXaxis() { return m_rotation_gesture->x_axis; }
-  inline bool getRotationYaxis() { return m_rotation_gesture->y_axis; }
-  inline bool getRotationZaxis() { return m_rotation_gesture->z_axis; }
+  inline bool getRotationXaxis() { return m_last_rotation.x_axis; }
+  inline bool getRotationYaxis() { return m_last_rotation.y_axis; }
+  inline bool getRotationZaxis() { return m_last_rotation.z_axis; }
 //  inline float getRotationXaxisCoord1() { return m_x_axis[0]; }
 //  inline float getRotationXaxisCoord2() { return m_x_axis[1]; }
 //  inline float getRotationXaxisCoord3() { return m_x_axis[2]; }
@@ -105,24 +133,62 @@ public:
 
   inline AsyncContextError getError() { return m_error_code; }
 
+  /// @brief Triangle under point of surface, in scene coordinates.
+  struct PickResult {
+    int mesh;
+    int instance;  // placement of mesh in node graph
+    int triangle;  // in drawing order of mesh
+    GLfloat u, v;  // barycentrics of second and third vertices of triangle
+    utils::Vector3Df position;
+  };
+
+  /// @brief Casts ray through pixel (x, y) of surface with transform of the last frame.
+  /// Could be called from any thread, hierarchies of triangles are built after upload.
+  /// @return false, if nothing is hit or scene is being uploaded.
+  bool pick(GLfloat x, GLfloat y, PickResult* result);
+
 private:
   constexpr static const uint32_t supremumVertices = 65536 * 4;
   constexpr static const uint32_t rearrangeLimit = 65536;
   constexpr static const GLfloat z_shift = -3.0f;
+  constexpr static const EGLint viewportMargin = 4;  // viewport is extended beyond bottom-left corner of surface
+  constexpr static const int surfaceLossTimeout = 2000;  // ms, caller releases window afterwards anyway
+  constexpr static const size_t textureBudget = 48 * 1024 * 1024;  // default GPU bytes for all textures
+  constexpr static const size_t promotionBytesPerFrame = 4 * 1024 * 1024;
+  constexpr static const bool uploadThread = true;  // promote textures on shared context, not between frames
+  constexpr static const bool atlasTextures = true;  // pack small textures at import
+  constexpr static const bool optimizeMeshes = true;  // reorder indexed meshes for vertex cache at import
+  constexpr static const bool optimizeOverdraw = true;
+  constexpr static const uint32_t atlasTileLimit = 256;
+  constexpr static const uint32_t atlasSize = 1024;
+  constexpr static const bool simplifyMeshes = true;  // build levels of detail at import
+  constexpr static const int lodLevels = 3;  // coarser levels below full mesh
+  constexpr static const GLsizeiptr lodMinPolygons = 512;
+  constexpr static const GLfloat lodCoarsestRatio = 0.125f;  // of triangles kept by the coarsest level
+  constexpr static const GLfloat lodMinRatio = 1.0f / 64;  // scenes requiring more reduction are rejected
+  constexpr static const GLfloat lodPixelError = 1.0f;  // allowed screen-space error of selected level
+  constexpr static const bool batchMeshes = true;  // merge small meshes sharing draw state at import
+  constexpr static const GLsizeiptr batchMaxVertices = 2048;  // larger meshes are drawn alone
+  constexpr static const GLfloat wireframeFeatureAngle = 0.0f;  // degrees, flatter edges are not drawn; 0 - all edges
+  constexpr static const bool downsampleScenes = true;  // merge vertices on voxel grid, if levels of detail are not enough
+  constexpr static const uint32_t pointBudget = 500000;  // points drawn per frame in point cloud mode
+  constexpr static const size_t pointMemoryBudget = 32 * 1024 * 1024;  // resident octree nodes
+  constexpr static const size_t pointLoadBytesPerFrame = 4 * 1024 * 1024;
 
   // Environment
   JNIEnv* m_jenv;
   jobject m_master_object;
-  jmethodID m_fireStringEvent_id;
+  EventChannel m_events;  // delivered by rendering thread
 
   // OpenGL context
   ANativeWindow* m_window;
   EGLDisplay m_display;
   EGLSurface m_surface;
+  EGLSurface m_pbuffer;  // 1x1, context is current on it without window
   EGLContext m_context;
+  Uploader* m_uploader;  // owns second context of view
   EGLint m_width, m_height;
-  EGLConfig m_config;
-  EGLint m_num_configs;
+  EGLConfig m_config;  // shared by context group
   EGLint m_format;
 
 private:
@@ -139,17 +205,24 @@ private:
   // Surface tracking
   std::mutex m_surface_recovery_mutex;
   std::atomic_bool m_surface_recovery_received;
+  std::atomic_bool m_surface_lost_received;
+  std::atomic_bool m_importing;  // window is not drawn meanwhile, so its loss is not waited for
+  std::condition_variable m_surface_lost_condition;
   std::atomic_bool m_context_initialized;
 
 public:
   EventListener<ANativeWindow*> surface_recovery_eventlistener;
+  EventListener<bool> surface_lost_eventlistener;
+  EventListener<bool> upload_completed_eventlistener;
 
 private:
 
   // Data storage
   bool m_textures_enabled;
+  bool m_flat_shading;
   bool m_has_textures;
   std::unordered_map<GLuint, native::Texture*> m_textures;
+  std::vector<native::AtlasTexture*> m_atlases;
 
   // External data
   AsyncContextError m_error_code;
@@ -157,6 +230,7 @@ private:
   char* m_bgColor;
   bool m_axis_visible;
   native::Scene* m_scene;
+  aiScene* m_downsampled_scene;  // own copy of scene, when it is too large for vertex limit
 
   struct MeshHelper {
     bool has_colors;
@@ -168,31 +242,139 @@ private:
     GLuint* indices;
     GLushort* short_indices;
     GLfloat* texture_coords;
-    GLuint tex_index;
+    int material_index;
+    native::Texture* texture;  // resolved from material, if mesh has texture coords
+    int residency_index;
+    uint64_t sort_key;
+    utils::Vector3Df center;  // bounding sphere in mesh space
+    GLfloat radius;
+    utils::Vector3Df box_min, box_max;  // axis-aligned box in mesh space
+    bool visible;  // any instance passed frustum culling this frame
+    GLfloat pixels_per_unit;  // largest among instances this frame, 0 - culled
+    GLfloat lod_error;  // geometric error against full mesh in model units
+    int total_lods;
+    MeshHelper* lods;  // coarser levels of detail, only geometry is stored there
+    GLsizeiptr first_instance;  // range in instances, mesh is kept once for all of them
+    GLsizeiptr total_instances;
+    utils::TriangleHierarchy* hierarchy;  // for picking, built after upload
+    GLsizeiptr num_edges;  // unique edges for wireframe mode, built on demand
+    GLushort* edge_indices;  // pairs of vertices of indexed mesh
+    MeshHelper* edge_geometry;  // line ends of rearranged mesh, only geometry is stored there
+    int batch_index;  // static batch holding a copy of this mesh, -1 - drawn alone
 
     MeshHelper();
     virtual ~MeshHelper();
   };
 
+  /// @brief Placement of mesh by a node of scene graph. Meshes placed once have
+  /// their transform baked into vertices, so only shared ones carry a matrix.
+  struct InstanceHelper {
+    GLsizeiptr mesh;
+    utils::Matrix4f transform;  // mesh space to scene space
+    bool identity;  // drawn without touching modelview matrix
+    GLfloat scale;  // largest scale of transform, for radii and errors
+    utils::Vector3Df center;  // bounding sphere in scene space
+    GLfloat radius;
+    utils::Vector3Df box_min, box_max;  // axis-aligned box in scene space
+    bool visible;  // passed frustum culling this frame
+    GLfloat pixels_per_unit;  // projected size of mesh unit at the nearest point this frame, 0 - culled
+    int lod;  // level drawn this frame, 0 - full mesh
+  };
+
+  struct MaterialHelper {
+    utils::Material material;
+    GLfloat color[4];  // diffuse color, used by meshes without own colors
+    native::Texture* texture;
+
+    MaterialHelper();
+  };
+
+  /// @brief State currently applied to OpenGL, so only deltas are emitted.
+  struct RenderState {
+    int material_index;
+    GLuint texture_id;
+    bool color_array;
+    bool textured;
+  };
+
+  /// @brief Small meshes sharing draw state, merged into common buffers to save draw calls.
+  /// Meshes keep their own buffers for culling, picking and wireframe.
+  struct BatchHelper {
+    struct Submesh {
+      GLsizeiptr mesh;
+      GLsizeiptr first_index;
+      GLsizeiptr total_indices;
+    };
+    MeshHelper geometry;  // merged arrays and short indices
+    std::vector<Submesh> submeshes;  // consecutive ranges, in order of render queue
+  };
+
   GLsizeiptr m_total_meshes;
   MeshHelper* m_meshes;
+  std::vector<InstanceHelper> m_instances;  // grouped by mesh
+  GLsizeiptr m_total_materials;
+  MaterialHelper* m_materials;
+  GLsizeiptr m_total_batches;
+  BatchHelper* m_batches;
+  std::vector<GLsizeiptr> m_render_queue;  // mesh indices sorted by state key
+  RenderState m_render_state;
+
+  /// @brief Texture residency record, updated each frame from visible meshes.
+  struct ResidencyItem {
+    native::Texture* texture;
+    GLfloat demand;  // largest projected diameter in pixels among visible meshes
+    uint32_t target;  // level size wanted for this frame, 0 - evicted
+    uint32_t requested;  // level size last loaded, 0 - evicted
+    bool failed;
+  };
+
+  std::vector<ResidencyItem> m_residency;
+  std::vector<size_t> m_residency_order;  // by descending demand
+  std::atomic_bool m_residency_pending;  // promotions are postponed to next frames
+  utils::Matrix4f m_projection;
+  utils::Matrix4f m_modelview;  // mirrors fixed-function matrices for culling
+  utils::BoundingVolumeHierarchy m_mesh_bvh;  // over instance boxes in scene space
+  std::vector<uint32_t> m_visible_instances;
+
+  /// @brief Counters of the last rendered frame.
+  struct FrameStatistics {
+    GLsizeiptr drawn_meshes;
+    GLsizeiptr draw_calls;
+    GLsizeiptr culled_meshes;
+    GLsizeiptr culled_nodes;  // hierarchy nodes rejected as a whole
+    GLsizeiptr drawn_polygons;
+    GLsizeiptr drawn_edges;  // wireframe mode
+    GLsizeiptr drawn_points;  // point cloud mode
+  };
+
+  FrameStatistics m_frame_stats;
+
+  utils::PointOctree* m_point_cloud;  // built for point meshes or point cloud mode
+  std::string m_cache_directory;
+  std::vector<uint32_t> m_point_nodes;
+  std::vector<uint32_t> m_missing_point_nodes;
+  std::atomic_bool m_point_cloud_pending;  // nodes are still being streamed
+
+  std::mutex m_pick_mutex;
+  utils::Matrix4f m_pick_transform;  // projection * modelview of the last frame
+  EGLint m_pick_width, m_pick_height;
 
 private:
-  // Gesture event listeners
-  std::mutex m_translation_gesture_mutex;
-  std::mutex m_rotation_gesture_mutex;
-  std::mutex m_zoom_gesture_mutex;
-  std::atomic_bool m_translation_gesture_received;
-  std::atomic_bool m_rotation_gesture_received;
-  std::atomic_bool m_zoom_gesture_received;
-  gesture::Translation::Ptr m_translation_gesture;
-  gesture::Rotation::Ptr m_rotation_gesture;
-  gesture::Zoom::Ptr m_zoom_gesture;
+  // Gesture event listeners: samples are pushed by JNI thread and drained by render thread
+  gesture::Queue m_gestures;
+  std::mutex m_gesture_backlog_mutex;
+  gesture::Accumulator m_gesture_backlog;  // samples which found queue full, drained by both threads
+  std::atomic_bool m_gesture_backlog_pending;
+  gesture::Rotation m_last_rotation;  // JNI thread only, axes reported back
+  gesture::Tracker m_tracker;  // render thread only, recognizes raw touches
+  std::chrono::steady_clock::time_point m_coast_time;  // of the latest coasting step
+  std::atomic_bool m_coast_pending;  // view keeps moving by inertia, frames are animated without input
 
 public:
-  EventListener<gesture::Translation::Ptr> translation_gesture_eventlistener;
-  EventListener<gesture::Rotation::Ptr> rotation_gesture_eventlistener;
-  EventListener<gesture::Zoom::Ptr> zoom_gesture_eventlistener;
+  EventListener<gesture::Translation> translation_gesture_eventlistener;
+  EventListener<gesture::Rotation> rotation_gesture_eventlistener;
+  EventListener<gesture::Zoom> zoom_gesture_eventlistener;
+  EventListener<gesture::Touch> touch_gesture_eventlistener;
 
 private:
   // External events
@@ -202,6 +384,7 @@ private:
   std::mutex m_drop_zoom_gesture_mutex;
   std::mutex m_clear_surface_mutex;
   std::mutex m_textures_enabled_mutex;
+  std::mutex m_flat_shading_mutex;
   std::mutex m_vertex_limit_mutex;
   std::mutex m_draw_type_mutex;
   std::mutex m_bg_color_mutex;
@@ -214,6 +397,7 @@ private:
   std::atomic_bool m_drop_zoom_gesture_received;
   std::atomic_bool m_clear_surface_received;
   std::atomic_bool m_textures_enabled_received;
+  std::atomic_bool m_flat_shading_received;
   std::atomic_bool m_vertex_limit_received;
   std::atomic_bool m_draw_type_received;
   std::atomic_bool m_bg_color_received;
@@ -227,6 +411,7 @@ public:
   EventListener<bool> drop_zoom_gesture_eventlistener;
   EventListener<bool> clear_surface_eventlistener;
   EventListener<bool> textures_enabled_eventlistener;
+  EventListener<bool> flat_shading_eventlistener;
 
   EventListener<int> vertex_limit_set_eventlistener;
   EventListener<DrawType> draw_type_set_eventlistener;
@@ -243,21 +428,28 @@ private:
 
   bool checkForWakeUp() override;
   void eventHandler() override;
+  void onStop() override;
 
+  void process_surfaceLost();
   void process_setWindow();
   void process_setVertexLimit();
   void process_setDrawType();
   void process_setBgColor();
   void process_setAxisVisibility();
-  void process_gestureTranslation();
-  void process_gestureRotation();
-  void process_gestureZoom();
+  void process_gestures();
+  void __pushGesture__(const gesture::Sample& sample);
+  bool __drainGestureBacklog__();
+  void __dropPendingGestures__();
+  void process_gestureTranslation(const gesture::Translation& gesture);
+  void process_gestureRotation(const gesture::Rotation& gesture);
+  void process_gestureZoom(const gesture::Zoom& gesture);
   inline void process_dropGestures();
   inline void process_dropTranslation();
   inline void process_dropRotation();
   inline void process_dropZoom();
   inline void process_clearSurface();
   inline void process_texturesEnabled();
+  void process_setFlatShading();
   void process_sceneUploaded();
 
   // Draw procedure
@@ -266,6 +458,8 @@ private:
 
   // Configuration methods
   bool __initDisplay__();
+  bool __initContext__();
+  void __releaseSurface__();
   void __windowConfig__();
   void __initGLOptions__();
   void __setProjectionMatrix__();
@@ -274,7 +468,33 @@ private:
   void __destroy__();
   bool __checkScene__();
   void __orientScene__();
+  void __downsampleScene__(unsigned int target_vertices, unsigned int* total_vertices, unsigned int* total_polygons);
+  /// @brief Scene being uploaded: shared one or its downsampled copy.
+  inline const aiScene* __sourceScene__() const { return m_downsampled_scene != nullptr ? m_downsampled_scene : m_scene->scene; }
+  void __simplifyMeshes__(GLfloat coarsest_ratio);
+  void __placeInstances__();
+  void __optimizeMeshes__();
+  static void __deindexMesh__(MeshHelper* mesh, bool flat);
+  void __buildTextureAtlases__();
+  inline static GLsizeiptr __totalCoords__(const MeshHelper& mesh);
+  void __buildRenderQueue__();
+  void __buildBatches__();
+  void __buildBoundingVolumes__();
+  void __buildPickingHierarchies__();
+  void __buildWireframes__();
+  void __buildPointCloud__(bool with_scene_points);
+  void __drawPointCloud__();
+  void __initTextureResidency__();
+  void __releaseTextureResidency__();
+  void __updateTextureResidency__();
+  void __stageTexture__(native::Texture* texture, uint32_t max_size);
+  void __projectMeshes__();
+  void __selectLevelsOfDetail__();
+  inline void __beginMeshes__();
+  inline void __applyMeshState__(const MeshHelper& mesh, const MeshHelper& arrays);
   void __drawMesh__(int id);
+  void __drawBatch__(GLsizeiptr id);
+  inline void __endMeshes__();
   inline void __drawGradientBackground__();
   inline void __drawAxis__();
 
@@ -288,7 +508,8 @@ private:
   inline void __dropZoom__();
 
   // Fire outcoming events
-  inline void __fireStringEvent__(const char* message);
+  inline void __fireErrorEvent__(AsyncContextError error);
+  inline void __fireFrameStatistics__();
 
   // Deleted methods
   AsyncContext(const AsyncContext& obj) = delete;
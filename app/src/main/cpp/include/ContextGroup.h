@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_CONTEXTGROUP_H_
+#define SURFACE3D_CONTEXTGROUP_H_
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <EGL/egl.h>
+
+
+/// @brief EGL contexts of all views sharing one set of GL objects.
+/// @details Every context is created sharing with a live one, so textures uploaded
+/// by one view could be drawn by others. Display is initialized for the first context
+/// and terminated after the last one, when group's objects are gone: GpuResources
+/// forgets their generation then. Resources used by several views are refcounted,
+/// so that no view demotes or evicts those in use by others.
+class ContextGroup {
+public:
+  static ContextGroup& get();
+
+  /// @brief Display of the group, initialized on first call.
+  EGLDisplay getDisplay();
+  /// @brief Config of all contexts of the group, chosen on first call.
+  /// @details Prefers configs, which also support pbuffers to keep context
+  /// current without window.
+  EGLConfig getConfig();
+  /// @brief Creates context sharing objects with other contexts of the group.
+  EGLContext createContext(EGLConfig config);
+  /// @brief Destroys context, which must not be current on any thread.
+  void destroyContext(EGLContext context);
+  size_t getTotalContexts() const;
+
+  // Any thread
+  void retain(const void* resource);
+  void release(const void* resource);
+  /// @brief Number of views, which have retained resource.
+  int getUsers(const void* resource) const;
+
+private:
+  ContextGroup();
+
+  mutable std::mutex m_mutex;
+  EGLDisplay m_display;
+  EGLConfig m_config;
+  uint32_t m_generation;  // of GPU resources shared by contexts
+  std::vector<EGLContext> m_contexts;
+  std::unordered_map<const void*, int> m_users;
+
+  ContextGroup(const ContextGroup& obj) = delete;
+  ContextGroup(ContextGroup&& rval_obj) = delete;
+  ContextGroup& operator = (const ContextGroup& rhs) = delete;
+  ContextGroup& operator = (ContextGroup&& rval_rhs) = delete;
+};
+
+#endif /* SURFACE3D_CONTEXTGROUP_H_ */
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_DELEGATE__H__
+#define SURFACE3D_DELEGATE__H__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+
+/**
+ * Non-allocating callable taking E: small trivially copyable functors, such as
+ * member function bound to object or lambda with a couple of captured pointers,
+ * are stored inline and called through a single function pointer.
+ */
+template <typename E>
+class Delegate {
+public:
+  constexpr static const size_t capacity = 4 * sizeof(void*);
+
+  Delegate() : m_invoke(nullptr) {}
+
+  template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Delegate>::value>::type>
+  Delegate(F functor) {
+    static_assert(sizeof(F) <= capacity, "Functor does not fit into delegate");
+    static_assert(std::is_trivially_copyable<F>::value, "Functor must be trivially copyable");
+    new (m_storage) F(functor);
+    m_invoke = [](const void* storage, E e) { (*static_cast<const F*>(storage))(e); };
+  }
+
+  inline void operator()(E e) const { m_invoke(m_storage, e); }
+  inline explicit operator bool() const { return m_invoke != nullptr; }
+
+private:
+  typedef void (*Invoke)(const void* storage, E e);
+
+  Invoke m_invoke;
+  alignas(std::max_align_t) unsigned char m_storage[capacity];
+};
+
+#endif  // SURFACE3D_DELEGATE__H__
@@ -41,6 +41,8 @@ public:
   virtual ~EGLConfigChooser();
 
   EGLConfig chooseConfig(EGLDisplay display);
+  /// @brief Chooses among configs supporting all surfaces of given type bits.
+  EGLConfig chooseConfig(EGLDisplay display, EGLint surface_type);
   EGLint getNumberConfigs() const;
 
 private:
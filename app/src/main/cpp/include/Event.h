@@ -31,85 +31,105 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
-#include <iostream>
 #include <memory>
 #include <mutex>
-#include <thread>
 #include <utility>
-#include <list>
+#include <vector>
 
+#include "Delegate.h"
 #include "EventListener.h"
 #include "ListenerBinder.h"
 #include "logger.h"
 
 
+/**
+ * Listeners are kept as immutable snapshot, swapped atomically on every change.
+ * Notification iterates the snapshot it has taken without locks, so listeners could be
+ * added or removed from any thread meanwhile, and the removed ones are kept alive
+ * until notifications in progress complete.
+ */
 template <typename E>
 class Event {
+  friend class ListenerBinder<E>;
+
 public:
-	Event() : m_event_listener_id(0) {}
-	virtual ~Event() {}
-
-	typename ListenerBinder<E>::Ptr createListener(std::function<void (E)> listener){
-	  typename ListenerBinder<E>::Ptr retval = std::make_shared<ListenerBinder<E>>(this, listener, m_event_listener_id);
-	  m_listeners.emplace_back(retval);
-	  ++m_event_listener_id;
-	  return retval;
-	}
-
-	template <typename P, typename Func>
-	typename ListenerBinder<E>::Ptr createListener(Func f, P p) {
-	  std::function<void(E)> func = std::bind(f, p, std::placeholders::_1);
-	  return createListener(func);
-	}
-
-	void notifyListeners(E e) {
-	  for(auto & listener : m_listeners) {
-	    listener.m_binder_ptr->callListenerSafe(e);
-	  }
-	}
-
-	bool removeListener(int id) {
-	  auto it = m_listeners.begin();
-	  while (it != m_listeners.end()) {
-	    if (it->getId() == id) {
-	      m_listeners.erase(it);
-	      return true;
-	    }
-	    ++it;
-	  }
-	  return false;
-	}
-
-	void clearListeners() {
-    auto it = m_listeners.begin();
-    while (it != m_listeners.end()) {
-      m_listeners.erase(it);
+  Event()
+    : m_listeners(std::make_shared<Snapshot>())
+    , m_anchor(std::make_shared<EventAnchor<E>>(this))
+    , m_event_listener_id(0) {
+  }
+
+  virtual ~Event() {
+    std::lock_guard<std::mutex> lock(m_anchor->mutex);  // waits for unbinding in progress
+    m_anchor->event = nullptr;
+  }
+
+  typename ListenerBinder<E>::Ptr createListener(std::function<void (E)> listener) {
+    std::lock_guard<std::mutex> lock(m_anchor->mutex);
+    return __add__(std::make_shared<ListenerBinder<E>>(m_anchor, std::move(listener), m_event_listener_id++));
+  }
+
+  template <typename P, typename Func>
+  typename ListenerBinder<E>::Ptr createListener(Func f, P p) {
+    Delegate<E> delegate([f, p](E e) { (p->*f)(e); });
+    std::lock_guard<std::mutex> lock(m_anchor->mutex);
+    return __add__(std::make_shared<ListenerBinder<E>>(m_anchor, delegate, m_event_listener_id++));
+  }
+
+  void notifyListeners(E e) {
+    std::shared_ptr<const Snapshot> listeners = std::atomic_load(&m_listeners);
+    for (const auto& binder : *listeners) {
+      binder->callListenerSafe(e);
     }
-    ++it;
-	}
+  }
 
-	bool hasListeners() const {
-	  return !m_listeners.empty();
-	}
+  bool removeListener(int id) {
+    std::lock_guard<std::mutex> lock(m_anchor->mutex);
+    return __remove__(id);
+  }
 
-	int getListenersCount() const {
-	  return m_listeners.size();
-	}
+  void clearListeners() {
+    std::lock_guard<std::mutex> lock(m_anchor->mutex);
+    std::atomic_store(&m_listeners, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>()));
+  }
 
-protected:
-  struct EventGlue {
-    typename ListenerBinder<E>::Ptr m_binder_ptr;
+  bool hasListeners() const {
+    return !std::atomic_load(&m_listeners)->empty();
+  }
 
-    EventGlue(typename ListenerBinder<E>::Ptr binder) : m_binder_ptr(binder) {}
+  int getListenersCount() const {
+    return std::atomic_load(&m_listeners)->size();
+  }
 
-    ~EventGlue() {
-      m_binder_ptr->m_event = nullptr;
+protected:
+  typedef std::vector<typename ListenerBinder<E>::Ptr> Snapshot;
+
+  std::shared_ptr<const Snapshot> m_listeners;
+  std::shared_ptr<EventAnchor<E>> m_anchor;  // its mutex serializes writers, readers never wait
+  int m_event_listener_id;
+
+  /// @brief Publishes copy of snapshot with binder appended, write lock is held by caller.
+  typename ListenerBinder<E>::Ptr __add__(typename ListenerBinder<E>::Ptr binder) {
+    auto listeners = std::make_shared<Snapshot>(*m_listeners);
+    listeners->push_back(binder);
+    std::atomic_store(&m_listeners, std::shared_ptr<const Snapshot>(std::move(listeners)));
+    return binder;
+  }
+
+  /// @brief Publishes copy of snapshot without binder, write lock is held by caller.
+  bool __remove__(int id) {
+    const Snapshot& current = *m_listeners;
+    auto it = std::find_if(current.begin(), current.end(),
+        [id](const typename ListenerBinder<E>::Ptr& binder) { return binder->getId() == id; });
+    if (it == current.end()) {
+      return false;
     }
-
-    inline const int& getId() const { return m_binder_ptr->getId(); }
-  };
-
-  std::list<EventGlue> m_listeners;
-	int m_event_listener_id;
+    auto listeners = std::make_shared<Snapshot>(current);
+    listeners->erase(listeners->begin() + (it - current.begin()));
+    std::atomic_store(&m_listeners, std::shared_ptr<const Snapshot>(std::move(listeners)));
+    return true;
+  }
 };
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_EVENTCHANNEL_H_
+#define SURFACE3D_EVENTCHANNEL_H_
+
+#include <jni.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+
+/// @brief Kinds of events delivered to Java, values are shared with NativeEvent.java.
+enum class NativeEventType : int {
+  PROGRESS = 0,  // code - unused, value - percents
+  STAGE = 1,     // code - stage, value - step within stage
+  STATS = 2,     // code - statistic key, value - its value
+  ERROR = 3      // code - error code, value - unused
+};
+
+/// @brief Typed native to Java event channel.
+/// @details Events are written into a ring, where events of the same type and code
+/// replace each other, so that only the latest value is delivered. Pending events are
+/// delivered in one JNI call at most maxRate times per second, and only on the thread
+/// bound to channel, other threads just write. Java receiver has signature
+/// void (int count, int[] codes, float[] values), where codes hold pairs of type and code.
+class EventChannel {
+public:
+  constexpr static const int capacity = 32;
+  constexpr static const int defaultRate = 10;  // batches per second
+
+  EventChannel(int max_rate = defaultRate);
+  virtual ~EventChannel();
+
+  /// @brief Binds channel to Java receiver, calling thread delivers events afterwards.
+  /// @details Arrays passed to receiver are allocated once here.
+  void bind(JNIEnv* jenv, jobject object, jmethodID method);
+  /// @brief Delivers pending events and releases arrays, must be called by bound thread.
+  void unbind();
+
+  // Any thread
+  void progress(float percentage);
+  void stage(int stage, int step = 0);
+  void stats(int key, float value);
+  void error(int code);
+
+  /// @brief Delivers pending events regardless of rate, if called by bound thread.
+  void flush();
+
+private:
+  struct Entry {
+    NativeEventType type;
+    int code;
+    float value;
+  };
+
+  int m_interval;  // ms between batches
+  std::chrono::steady_clock::time_point m_last_delivery;
+
+  std::mutex m_mutex;
+  Entry m_ring[capacity];
+  int m_head;  // oldest pending event
+  int m_size;
+
+  // Receiver
+  JNIEnv* m_jenv;
+  jobject m_object;
+  jmethodID m_method;
+  jintArray m_codes;
+  jfloatArray m_values;
+  std::thread::id m_thread_id;
+
+  void __post__(NativeEventType type, int code, float value);
+  void __deliver__(bool force);
+
+  EventChannel(const EventChannel& obj) = delete;
+  EventChannel(EventChannel&& rval_obj) = delete;
+  EventChannel& operator = (const EventChannel& rhs) = delete;
+  EventChannel& operator = (EventChannel&& rval_rhs) = delete;
+};
+
+#endif /* SURFACE3D_EVENTCHANNEL_H_ */
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_GPURESOURCES_H_
+#define SURFACE3D_GPURESOURCES_H_
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <EGL/egl.h>
+#include <GLES/gl.h>
+
+
+enum class GpuCategory : int {
+  TEXTURES = 0, BUFFERS = 1
+};
+
+/// @brief Accounting and destruction of OpenGL objects for all owners.
+/// @details Objects could be released from any thread: they are queued and deleted
+/// on rendering thread at frame boundary, when context is current. Every set of
+/// contexts sharing objects has its own generation: objects are deleted only by
+/// contexts of the generation they have been created in, and objects of lost
+/// generation are forgotten without GL calls.
+class GpuResources {
+public:
+  constexpr static const int totalCategories = 2;
+
+  static GpuResources& get();
+
+  // Rendering thread
+  void allocated(GpuCategory category, size_t bytes);
+  /// @brief Deletes queued objects of generation of current context.
+  void collect();
+
+  // Context owners
+  /// @brief Unique generation for new set of sharing contexts.
+  uint32_t newGeneration();
+  void attach(EGLContext context, uint32_t generation);
+  void detach(EGLContext context);
+  /// @brief Objects of generation are forgotten, no context of it is alive anymore.
+  void contextLost(uint32_t generation);
+
+  // Any thread
+  void release(GpuCategory category, GLuint id, size_t bytes, uint32_t generation);
+  void setBudget(GpuCategory category, size_t bytes);
+  size_t getBudget(GpuCategory category) const;
+  size_t getBytes(GpuCategory category) const;
+  size_t getPendingBytes(GpuCategory category) const;
+  size_t getTotalBytes() const;
+  bool fits(GpuCategory category, size_t bytes) const;
+  /// @brief Generation of context current on calling thread, 0 if there is none.
+  uint32_t getGeneration() const;
+  void logStats() const;
+
+private:
+  GpuResources();
+
+  struct Release {
+    GpuCategory category;
+    GLuint id;
+    size_t bytes;
+    uint32_t generation;
+  };
+
+  static void __subtract__(std::atomic<size_t>& value, size_t bytes);
+  bool __isAlive__(uint32_t generation) const;
+
+  std::mutex m_release_mutex;
+  std::vector<Release> m_releases;
+  mutable std::mutex m_context_mutex;
+  std::unordered_map<EGLContext, uint32_t> m_contexts;
+  std::atomic<size_t> m_bytes[totalCategories];
+  std::atomic<size_t> m_pending_bytes[totalCategories];
+  std::atomic<size_t> m_budgets[totalCategories];
+  std::atomic<uint32_t> m_last_generation;
+
+  GpuResources(const GpuResources& obj) = delete;
+  GpuResources(GpuResources&& rval_obj) = delete;
+  GpuResources& operator = (const GpuResources& rhs) = delete;
+  GpuResources& operator = (GpuResources&& rval_rhs) = delete;
+};
+
+#endif /* SURFACE3D_GPURESOURCES_H_ */
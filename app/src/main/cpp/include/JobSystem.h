@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_JOBSYSTEM_H_
+#define SURFACE3D_JOBSYSTEM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+enum class JobPriority : int {
+  HIGH = 0, NORMAL = 1, LOW = 2
+};
+
+/// @brief Process-wide pool of worker threads, one per core besides the calling one.
+/// @details Each worker owns a deque per priority: it takes its own latest jobs first
+/// and steals the oldest ones from others, when it runs out. Jobs submitted outside
+/// of workers go to a shared deque. Waiting threads run queued jobs of the same or higher
+/// priority meanwhile, so jobs could submit and wait for nested ones, and sleep, when
+/// the last jobs of group run elsewhere. Threads owning GL contexts stay apart.
+class JobSystem {
+public:
+  constexpr static const int totalPriorities = 3;
+
+  /// @brief Unfinished jobs submitted together, to wait for.
+  class Group {
+    friend class JobSystem;
+  public:
+    Group() : m_pending(0), m_priority(static_cast<int>(JobPriority::HIGH)) {}
+    inline bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+  private:
+    std::atomic<int> m_pending;
+    std::atomic<int> m_priority;  // the lowest one of submitted jobs
+  };
+
+  static JobSystem& get();
+
+  void submit(std::function<void()> job, JobPriority priority = JobPriority::NORMAL, Group* group = nullptr);
+  /// @brief Runs queued jobs not less urgent than those of group, until all of them have completed.
+  void wait(Group* group);
+  /// @brief Threads running jobs, the calling one included.
+  inline unsigned int concurrency() const { return m_threads.size() + 1; }
+
+  /// @brief Runs function(i) for each index in [0, total), calling thread takes part.
+  /// @return number of threads used.
+  template <typename Function>
+  unsigned int parallelFor(size_t total, Function function, JobPriority priority = JobPriority::NORMAL) {
+    unsigned int total_threads = std::max(1u, static_cast<unsigned int>(std::min<size_t>(concurrency(), total)));
+    std::atomic<size_t> next(0);
+    auto loop = [total, &function, &next]() {
+      for (size_t i = next++; i < total; i = next++) {
+        function(i);
+      }
+    };
+    Group group;
+    for (unsigned int ti = 1; ti < total_threads; ++ti) {
+      submit(loop, priority, &group);
+    }
+    loop();
+    wait(&group);
+    return total_threads;
+  }
+
+  /// @brief Runs function(chunk, begin, end) over contiguous chunks of [0, total).
+  template <typename Function>
+  void parallelChunks(size_t total, unsigned int total_chunks, Function function, JobPriority priority = JobPriority::NORMAL) {
+    total_chunks = std::max(1u, total_chunks);
+    size_t chunk = (total + total_chunks - 1) / total_chunks;
+    parallelFor(total_chunks, [total, chunk, &function](size_t ci) {
+      size_t begin = std::min(total, ci * chunk);
+      function(static_cast<unsigned int>(ci), begin, std::min(total, begin + chunk));
+    }, priority);
+  }
+
+private:
+  JobSystem();
+  ~JobSystem();
+
+  struct Job {
+    std::function<void()> function;
+    Group* group;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs[totalPriorities];
+  };
+
+  void __loop__(unsigned int worker);
+  bool __take__(unsigned int own, Job* job, int lowest_priority = totalPriorities - 1);
+  void __run__(Job* job);
+
+  std::vector<std::thread> m_threads;
+  std::vector<std::unique_ptr<Queue>> m_queues;  // one per worker, the last one is shared
+  std::atomic<int> m_queued;
+  std::atomic_bool m_stopping;
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_wake_up;
+  std::mutex m_done_mutex;
+  std::condition_variable m_group_done;  // some group has completed
+};
+
+#endif /* SURFACE3D_JOBSYSTEM_H_ */
@@ -29,32 +29,60 @@
 #ifndef SURFACE3D_LISTENERBINDER__H__
 #define SURFACE3D_LISTENERBINDER__H__
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "Delegate.h"
 #include "EventListener.h"
 
 
 template <typename E>
 class Event;
 
+/// @brief Lock of event outliving it: binders hold it weakly, so that unbinding
+/// either completes under the lock before event is destroyed, or finds it gone.
+template <typename E>
+struct EventAnchor {
+  std::mutex mutex;  // serializes writers of event
+  Event<E>* event;  // reset by destructor of event under the lock
+
+  explicit EventAnchor(Event<E>* event) : event(event) {}
+};
+
 template<typename E>
 class ListenerBinder {
   friend class Event<E>;
 
 public:
   typedef std::shared_ptr<ListenerBinder<E>> Ptr;
-  EventListener<E>* m_event_listener;
+  std::atomic<EventListener<E>*> m_event_listener;  // events are not delivered until listener is assigned
 
-  void callListenerSafe(E e) {
-    if (m_event_listener != nullptr) {
-      m_f(e);
+  void callListenerSafe(E e) const {
+    std::lock_guard<std::recursive_mutex> lock(m_call_mutex);  // unbinding waits for it
+    if (m_event_listener.load(std::memory_order_acquire) != nullptr) {
+      m_delegate(e);
     }
   }
 
+  /// @brief Removes binder from event and returns after calls already in progress,
+  /// owner of listener could be destroyed afterwards.
   bool unbindFromEvent() {
-    if (m_event == nullptr) {
-      return false;
+    bool result = false;
+    std::shared_ptr<EventAnchor<E>> anchor = m_anchor.lock();
+    if (anchor) {
+      std::lock_guard<std::mutex> lock(anchor->mutex);
+      if (anchor->event != nullptr) {  // otherwise event is being destroyed
+        result = anchor->event->__remove__(m_id);
+      }
+      m_event_listener.store(nullptr, std::memory_order_release);
+    } else {
+      m_event_listener.store(nullptr, std::memory_order_release);  // event is gone
     }
-    bool result = m_event->removeListener(m_id);
-    m_event = nullptr;
+    // grace period: snapshots taken before removal could still be delivering,
+    // anchor is not locked meanwhile, as listener could write to the event
+    std::lock_guard<std::recursive_mutex> lock(m_call_mutex);
     return result;
   }
 
@@ -63,16 +91,26 @@ public:
   }
 
 private:
-  Event<E>* m_event;
-  std::function<void (E)> m_f;
+  std::weak_ptr<EventAnchor<E>> m_anchor;
+  std::function<void (E)> m_function;  // arbitrary listener, delegate refers to it
+  Delegate<E> m_delegate;
   int m_id;
+  mutable std::recursive_mutex m_call_mutex;  // held across delegate call, listener could unbind itself
 
 public:
-  ListenerBinder(Event<E>* event_ptr, std::function<void (E)> f_in, int listener_id)
-    : m_event(event_ptr)
-    , m_f(f_in)
-    , m_id(listener_id)
-    , m_event_listener(nullptr) {
+  ListenerBinder(const std::shared_ptr<EventAnchor<E>>& anchor, Delegate<E> delegate, int listener_id)
+    : m_event_listener(nullptr)
+    , m_anchor(anchor)
+    , m_delegate(delegate)
+    , m_id(listener_id) {
+  }
+
+  ListenerBinder(const std::shared_ptr<EventAnchor<E>>& anchor, std::function<void (E)> f_in, int listener_id)
+    : m_event_listener(nullptr)
+    , m_anchor(anchor)
+    , m_function(std::move(f_in))
+    , m_delegate([this](E e) { m_function(e); })
+    , m_id(listener_id) {
   }
 
 };
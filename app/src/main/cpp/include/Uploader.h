@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_UPLOADER_H_
+#define SURFACE3D_UPLOADER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <EGL/egl.h>
+#include <GLES/gl.h>
+#include "ActiveObject.h"
+
+
+/// @brief Thread, which uploads GL objects from pbuffer context shared with rendering one.
+/// @details Jobs run in order of submission. GLES 1.x has no fences, so each job is
+/// followed by glFinish(): objects it has created are complete in every context of the group,
+/// when its completion is handed to rendering thread. Rendering thread never waits for
+/// uploads, it collects completed jobs at frame boundary instead.
+class Uploader : public ActiveObject {
+public:
+  Uploader(EGLDisplay display, EGLConfig config);
+  virtual ~Uploader();
+
+  /// @brief Creates shared context and launches thread, which makes it current.
+  /// @return false, if context could not be made current, uploads stay on rendering thread then.
+  bool start();
+
+  // Rendering thread
+  /// @brief Runs job on upload thread, then done(result) is run by collect().
+  void submit(std::function<bool()> job, std::function<void(bool)> done);
+  /// @brief Runs completion callbacks of finished jobs.
+  /// @return number of completed jobs.
+  size_t collect();
+  /// @brief Completes queued jobs as failed, waits for the running one and collects all.
+  void cancel();
+
+  /// @brief Fired on upload thread, when some job has completed.
+  Event<bool> upload_completed_event;
+
+protected:
+  bool checkForWakeUp() override;
+  void eventHandler() override;
+  void onStart() override;
+  void onStop() override;
+
+private:
+  enum class State : int {
+    STARTING = 0, READY = 1, FAILED = 2
+  };
+
+  struct Job {
+    std::function<bool()> upload;
+    std::function<void(bool)> done;
+  };
+
+  struct Completion {
+    std::function<void(bool)> done;
+    bool result;
+  };
+
+  EGLDisplay m_display;
+  EGLConfig m_config;
+  EGLContext m_context;
+  EGLSurface m_pbuffer;
+
+  std::mutex m_state_mutex;
+  std::condition_variable m_state_condition;
+  State m_state;
+
+  std::mutex m_jobs_mutex;
+  std::condition_variable m_idle_condition;
+  std::deque<Job> m_jobs;
+  std::vector<Completion> m_completed;
+  bool m_running;  // job is being uploaded
+};
+
+#endif /* SURFACE3D_UPLOADER_H_ */
@@ -151,6 +151,14 @@ JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeRotate
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeZoom
   (JNIEnv *, jobject, jlong, jfloat, jfloat, jfloat);
 
+/*
+ * Class:     com_orcchg_surface3d_AsyncContext
+ * Method:    nativeTouch
+ * Signature: (J[FI)V
+ */
+JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeTouch
+  (JNIEnv *, jobject, jlong, jfloatArray, jint);
+
 /*
  * Class:     com_orcchg_surface3d_AsyncContext
  * Method:    nativeGetTranslationX
@@ -271,6 +279,14 @@ JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetVertexLim
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetDrawType
   (JNIEnv *, jobject, jlong, jint);
 
+/*
+ * Class:     com_orcchg_surface3d_AsyncContext
+ * Method:    nativeSetFlatShading
+ * Signature: (JZ)V
+ */
+JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetFlatShading
+  (JNIEnv *, jobject, jlong, jboolean);
+
 /*
  * Class:     com_orcchg_surface3d_AsyncContext
  * Method:    nativeSetBackgroundColor
@@ -287,6 +303,38 @@ JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetBackgroun
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeShowAxis
   (JNIEnv *, jobject, jlong, jboolean);
 
+/*
+ * Class:     com_orcchg_surface3d_AsyncContext
+ * Method:    nativeGetGpuMemory
+ * Signature: (JI)J
+ */
+JNIEXPORT jlong JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeGetGpuMemory
+  (JNIEnv *, jobject, jlong, jint);
+
+/*
+ * Class:     com_orcchg_surface3d_AsyncContext
+ * Method:    nativeGetGpuMemoryBudget
+ * Signature: (JI)J
+ */
+JNIEXPORT jlong JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeGetGpuMemoryBudget
+  (JNIEnv *, jobject, jlong, jint);
+
+/*
+ * Class:     com_orcchg_surface3d_AsyncContext
+ * Method:    nativeSetGpuMemoryBudget
+ * Signature: (JIJ)V
+ */
+JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetGpuMemoryBudget
+  (JNIEnv *, jobject, jlong, jint, jlong);
+
+/*
+ * Class:     com_orcchg_surface3d_AsyncContext
+ * Method:    nativePick
+ * Signature: (JFF[I[F)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_orcchg_surface3d_AsyncContext_nativePick
+  (JNIEnv *, jobject, jlong, jfloat, jfloat, jintArray, jfloatArray);
+
 /*
  * Class:     com_orcchg_surface3d_AsyncContext
  * Method:    uploadScene
@@ -328,15 +376,18 @@ struct AsyncContextStruct {
   EventListener<bool> acontext_has_stopped_eventlistener;
 
   Event<ANativeWindow*> surface_recovery_event;
-  Event<gesture::Translation::Ptr> gesture_translation_event;
-  Event<gesture::Rotation::Ptr> gesture_rotation_event;
-  Event<gesture::Zoom::Ptr> gesture_zoom_event;
+  Event<bool> surface_lost_event;
+  Event<gesture::Translation> gesture_translation_event;
+  Event<gesture::Rotation> gesture_rotation_event;
+  Event<gesture::Zoom> gesture_zoom_event;
+  Event<gesture::Touch> gesture_touch_event;
   Event<bool> drop_gestures_event;
   Event<bool> drop_translation_gesture_event;
   Event<bool> drop_rotation_gesture_event;
   Event<bool> drop_zoom_gesture_event;
   Event<bool> clear_surface_event;
   Event<bool> textures_enabled_event;
+  Event<bool> flat_shading_event;
   Event<int> vertex_limit_set_event;
   Event<DrawType> draw_type_set_event;
   Event<const char*> bg_color_set_event;
@@ -347,7 +398,7 @@ struct AsyncContextStruct {
   JNIEnv* jenv;
   jobject master_object;
   jclass master_class;
-  jmethodID fireStringEvent_id;
+  jmethodID fireEvents_id;
 
   AsyncContextStruct();
   virtual ~AsyncContextStruct();
@@ -32,6 +32,7 @@
 #include <assimp/material.h>
 #include <assimp/scene.h>
 #include <GLES/gl.h>
+#include "material.h"
 
 namespace utils {
 namespace assimp {
@@ -45,8 +46,11 @@ void getRawTriangles(const aiFace* const faces, unsigned int total, GLuint* buff
 void getRawTriangles(const aiFace* const faces, unsigned int total, GLushort* buffer);
 void getRawColors(const aiColor4D* const colors, unsigned int total, float* buffer);
 void getRawTextures(const aiVector3D* const textures, unsigned int total, float* buffer);
+/// @brief Node transform as column-major matrix acting on vertices of getRawVerticesNegativeXYZ().
+void getRawTransformNegativeXYZ(const aiMatrix4x4& transform, float* buffer);
 
 aiTextureType findTexture(const aiMaterial* material, aiString* tex_name);
+void getMaterial(const aiMaterial* material, Material* out);
 
 }  // namespace assimp
 }  // namespace utils
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_BVH_H_
+#define SURFACE3D_BVH_H_
+
+#include <vector>
+#include <GLES/gl.h>
+
+#include "matrix.h"
+#include "vector3D.h"
+
+
+namespace utils {
+
+/**
+ * Bounding volume hierarchy of axis-aligned boxes, built top-down by splitting
+ * items at median of the longest axis. Used to reject whole groups of meshes
+ * by a single frustum test.
+ */
+class BoundingVolumeHierarchy {
+public:
+  constexpr static const uint32_t maxLeafItems = 4;
+
+  BoundingVolumeHierarchy();
+
+  /// @brief Builds hierarchy over boxes of items, previous one is discarded.
+  void build(const Vector3Df* mins, const Vector3Df* maxs, uint32_t total);
+  void clear();
+
+  /// @brief Collects items, which boxes are not entirely outside of frustum.
+  /// Subtrees entirely inside are accepted without further tests.
+  /// @param planes - frustum planes in the same space as boxes.
+  /// @return number of nodes rejected by a frustum test.
+  uint32_t cull(const GLfloat planes[6][4], std::vector<uint32_t>* visible) const;
+
+  inline size_t getTotalNodes() const { return m_nodes.size(); }
+  inline bool empty() const { return m_nodes.empty(); }
+  const Vector3Df& getMin() const;
+  const Vector3Df& getMax() const;
+
+private:
+  struct Node {
+    Vector3Df min, max;
+    uint32_t first;  // leaf: first item, inner: index of right child, left child follows the node
+    uint32_t count;  // leaf: number of items, inner: 0
+  };
+
+  std::vector<Node> m_nodes;
+  std::vector<uint32_t> m_items;
+
+  void buildNode(const Vector3Df* mins, const Vector3Df* maxs, uint32_t first, uint32_t count);
+  void collect(uint32_t node, std::vector<uint32_t>* visible) const;
+};
+
+}
+
+#endif /* SURFACE3D_BVH_H_ */
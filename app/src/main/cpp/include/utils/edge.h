@@ -29,6 +29,7 @@
 #ifndef SURFACE3D_EDGE_H_
 #define SURFACE3D_EDGE_H_
 
+#include <cstdint>
 #include <map>
 
 
@@ -72,6 +73,11 @@ public:
     return (v[0] == i || v[1] == i);
   }
 
+  /// @brief Sorted vertices packed into single value, suitable for hashing.
+  inline uint64_t key() const {
+    return (static_cast<uint64_t>(v[0]) << 32) | v[1];
+  }
+
   unsigned int v[2];
 };
 
@@ -29,41 +29,206 @@
 #ifndef SURFACE3D_GESTURE_H_
 #define SURFACE3D_GESTURE_H_
 
-#include <memory>
+#include <type_traits>
+#include <vector>
 #include <GLES/gl.h>
 
+#include "ring.h"
+
 
 namespace gesture {
 
-struct Translation {
-  typedef std::shared_ptr<Translation> Ptr;
+/* Gestures are plain values, copied from JNI thread to render thread without allocations */
 
+struct Translation {
   GLfloat x, y, z;
 
+  Translation() = default;
   Translation(float x, float y, float z)
     : x(x), y(y), z(z) {}
 };
 
 struct Rotation {
-  typedef std::shared_ptr<Rotation> Ptr;
-
   bool x_axis, y_axis, z_axis;
   GLfloat angle_x, angle_y, angle_z;
 
+  Rotation() = default;
   Rotation(bool x_axis, bool y_axis, bool z_axis, float x_angle, float y_angle, float z_angle)
     : x_axis(x_axis), y_axis(y_axis), z_axis(z_axis)
     , angle_x(x_angle), angle_y(y_angle), angle_z(z_angle) {}
 };
 
 struct Zoom {
-  typedef std::shared_ptr<Zoom> Ptr;
-
   GLfloat scale_x, scale_y, scale_z;
 
+  Zoom() = default;
   Zoom(float scale_x, float scale_y, float scale_z)
     : scale_x(scale_x), scale_y(scale_y), scale_z(scale_z) {}
 };
 
+/// @brief Raw touch sample, recognized into gestures on render thread.
+struct Touch {
+  enum class Action : unsigned char { DOWN, MOVE, UP, POINTER_DOWN, POINTER_UP, CANCEL };
+  constexpr static const int packedSize = 7;  // floats per sample in JNI batch: dt, action, pointers, x0, y0, x1, y1
+
+  GLfloat dt;  // milliseconds since previous sample
+  Action action;
+  unsigned char pointers;
+  GLfloat x0, y0;  // first pointer, in pixels
+  GLfloat x1, y1;  // second pointer, if any
+
+  Touch() = default;
+  explicit Touch(const float* packed)
+    : dt(packed[0]), action(static_cast<Action>(static_cast<int>(packed[1])))
+    , pointers(static_cast<unsigned char>(packed[2]))
+    , x0(packed[3]), y0(packed[4]), x1(packed[5]), y1(packed[6]) {}
+};
+
+/// @brief Any of gestures, as stored in queue.
+struct Sample {
+  enum class Type : unsigned char { TRANSLATION, ROTATION, ZOOM, TOUCH };
+
+  Type type;
+  union {
+    Translation translation;
+    Rotation rotation;
+    Zoom zoom;
+    Touch touch;
+  };
+
+  Sample() = default;
+  Sample(const Translation& translation) : type(Type::TRANSLATION), translation(translation) {}
+  Sample(const Rotation& rotation) : type(Type::ROTATION), rotation(rotation) {}
+  Sample(const Zoom& zoom) : type(Type::ZOOM), zoom(zoom) {}
+  Sample(const Touch& touch) : type(Type::TOUCH), touch(touch) {}
+};
+
+static_assert(std::is_trivially_copyable<Sample>::value, "Gesture samples are copied as raw memory");
+
+/// @brief Samples from JNI thread to render thread, enough for several frames of touch input.
+typedef utils::SpscRing<Sample, 256> Queue;
+
+/**
+ * Merges run of samples into at most one gesture of each kind: translation and zoom
+ * carry absolute values, so the latest one wins, rotation carries deltas, which are summed.
+ * Touches are kept in order, only consecutive moves are merged into the latest one keeping
+ * the time elapsed: presses and releases must all reach the tracker.
+ */
+struct Accumulator {
+  bool translated, rotated, zoomed;
+  Translation translation;
+  Rotation rotation;
+  Zoom zoom;
+  std::vector<Touch> touches;  // allocated only when queue overflows with touches
+
+  Accumulator() : translated(false), rotated(false), zoomed(false) {}
+
+  inline bool empty() const { return !translated && !rotated && !zoomed && touches.empty(); }
+
+  void add(const Sample& sample) {
+    switch (sample.type) {
+      case Sample::Type::TRANSLATION:
+        translation = sample.translation;
+        translated = true;
+        break;
+      case Sample::Type::ROTATION:
+        if (!rotated) {
+          rotation = Rotation(false, false, false, 0.0f, 0.0f, 0.0f);
+          rotated = true;
+        }
+        // angles of disabled axes are not applied, so they are not summed either
+        if (sample.rotation.x_axis) { rotation.x_axis = true;  rotation.angle_x += sample.rotation.angle_x; }
+        if (sample.rotation.y_axis) { rotation.y_axis = true;  rotation.angle_y += sample.rotation.angle_y; }
+        if (sample.rotation.z_axis) { rotation.z_axis = true;  rotation.angle_z += sample.rotation.angle_z; }
+        break;
+      case Sample::Type::ZOOM:
+        zoom = sample.zoom;
+        zoomed = true;
+        break;
+      case Sample::Type::TOUCH:
+        if (!touches.empty() && touches.back().action == Touch::Action::MOVE &&
+            sample.touch.action == Touch::Action::MOVE && touches.back().pointers == sample.touch.pointers) {
+          GLfloat dt = touches.back().dt + sample.touch.dt;
+          touches.back() = sample.touch;
+          touches.back().dt = dt;
+        } else {
+          touches.push_back(sample.touch);
+        }
+        break;
+    }
+  }
+
+  /// @brief Moves merged gestures into queue, as long as there is room.
+  /// @return true, if nothing is left.
+  bool flush(Queue* queue) {
+    if (translated && queue->push(Sample(translation))) translated = false;
+    if (rotated && queue->push(Sample(rotation))) rotated = false;
+    if (zoomed && queue->push(Sample(zoom))) zoomed = false;
+    size_t pushed = 0;
+    while (pushed < touches.size() && queue->push(Sample(touches[pushed]))) {
+      ++pushed;
+    }
+    touches.erase(touches.begin(), touches.begin() + pushed);
+    return empty();
+  }
+};
+
+/// @brief Change of view produced by touches, to be added to current transform.
+struct Motion {
+  GLfloat angle_x, angle_y;  // degrees
+  GLfloat translation_x, translation_y;
+  GLfloat zoom;  // factor
+
+  Motion() : angle_x(0.0f), angle_y(0.0f), translation_x(0.0f), translation_y(0.0f), zoom(1.0f) {}
+
+  inline bool empty() const {
+    return angle_x == 0.0f && angle_y == 0.0f && translation_x == 0.0f && translation_y == 0.0f && zoom == 1.0f;
+  }
+};
+
+/**
+ * Recognizes gestures in raw touches: single pointer rotates, second tap shortly after
+ * the previous one drags, two pointers zoom. Velocity of pointer is smoothed over recent
+ * samples, so released rotation or drag keeps coasting with exponential decay.
+ */
+class Tracker {
+public:
+  constexpr static const GLfloat rotationPerScreen = 180.0f;  // degrees for a drag across whole viewport
+  constexpr static const GLfloat translationPerPixel = 0.005f;
+  constexpr static const GLfloat dragTapInterval = 250.0f;  // ms between release and touch to start dragging
+  constexpr static const GLfloat minPinchSpacing = 10.0f;  // pixels
+  constexpr static const GLfloat velocitySmoothing = 40.0f;  // ms, time constant of velocity filter
+  constexpr static const GLfloat releaseTimeout = 50.0f;  // ms, pointer resting longer before release does not coast
+  constexpr static const GLfloat inertiaDecay = 325.0f;  // ms, time constant of coasting
+  constexpr static const GLfloat minCoastSpeed = 0.05f;  // pixels per ms
+
+  Tracker();
+
+  /// @brief Feeds sample in order of arrival, motion is accumulated.
+  void touch(const Touch& sample, GLfloat width, GLfloat height, Motion* motion);
+  /// @brief Advances coasting by elapsed time, motion is accumulated.
+  /// @return false, if pointer has come to rest.
+  bool coast(GLfloat elapsed, GLfloat width, GLfloat height, Motion* motion);
+  inline bool coasting() const { return m_coasting; }
+  /// @brief Forgets pointer and stops coasting, as view is reset.
+  void stop();
+
+private:
+  enum class Mode { NONE, ROTATE, DRAG, ZOOM };
+
+  static void move(Mode mode, GLfloat dx, GLfloat dy, GLfloat width, GLfloat height, Motion* motion);
+
+  Mode m_mode;
+  GLfloat m_clock;  // ms, sum of sample intervals
+  GLfloat m_last_move;  // clock of the latest movement
+  GLfloat m_last_release;
+  GLfloat m_x, m_y;  // previous pointer position
+  GLfloat m_spacing;  // previous distance between pointers
+  GLfloat m_velocity_x, m_velocity_y;  // pixels per ms, smoothed
+  bool m_coasting;
+  Mode m_coast_mode;
+};
+
 }  // namespace gesture
 
 #endif /* SURFACE3D_GESTURE_H_ */
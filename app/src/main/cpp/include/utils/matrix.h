@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_MATRIX_H_
+#define SURFACE3D_MATRIX_H_
+
+#include <algorithm>
+#include <cmath>
+#include <GLES/gl.h>
+
+#include "vector3D.h"
+
+
+namespace utils {
+
+/**
+ * 4x4 matrix stored column-major as OpenGL does, mirrors transformations
+ * of fixed-function pipeline on CPU side.
+ */
+struct Matrix4f {
+  GLfloat m[16];
+
+  inline static Matrix4f identity() {
+    Matrix4f result;
+    for (int i = 0; i < 16; ++i) {
+      result.m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
+    return result;
+  }
+
+  /// @brief Same as glFrustumf().
+  inline static Matrix4f frustum(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar) {
+    Matrix4f result = identity();
+    result.m[0] = 2.0f * zNear / (right - left);
+    result.m[5] = 2.0f * zNear / (top - bottom);
+    result.m[8] = (right + left) / (right - left);
+    result.m[9] = (top + bottom) / (top - bottom);
+    result.m[10] = -(zFar + zNear) / (zFar - zNear);
+    result.m[11] = -1.0f;
+    result.m[14] = -2.0f * zFar * zNear / (zFar - zNear);
+    result.m[15] = 0.0f;
+    return result;
+  }
+
+  /// @brief Same as glTranslatef().
+  inline static Matrix4f translation(GLfloat x, GLfloat y, GLfloat z) {
+    Matrix4f result = identity();
+    result.m[12] = x;
+    result.m[13] = y;
+    result.m[14] = z;
+    return result;
+  }
+
+  /// @brief Same as glRotatef(), angle is in degrees.
+  inline static Matrix4f rotation(GLfloat angle, GLfloat x, GLfloat y, GLfloat z) {
+    Matrix4f result = identity();
+    GLfloat length = std::sqrt(x * x + y * y + z * z);
+    if (length == 0.0f) {
+      return result;
+    }
+    x /= length;  y /= length;  z /= length;
+    GLfloat radians = angle * static_cast<GLfloat>(M_PI) / 180.0f;
+    GLfloat c = std::cos(radians), s = std::sin(radians), t = 1.0f - c;
+    result.m[0] = t * x * x + c;      result.m[4] = t * x * y - s * z;  result.m[8] = t * x * z + s * y;
+    result.m[1] = t * x * y + s * z;  result.m[5] = t * y * y + c;      result.m[9] = t * y * z - s * x;
+    result.m[2] = t * x * z - s * y;  result.m[6] = t * y * z + s * x;  result.m[10] = t * z * z + c;
+    return result;
+  }
+
+  /// @brief Same as glScalef().
+  inline static Matrix4f scale(GLfloat x, GLfloat y, GLfloat z) {
+    Matrix4f result = identity();
+    result.m[0] = x;
+    result.m[5] = y;
+    result.m[10] = z;
+    return result;
+  }
+
+  inline Matrix4f operator *(const Matrix4f& rhs) const {
+    Matrix4f result;
+    for (int col = 0; col < 4; ++col) {
+      for (int row = 0; row < 4; ++row) {
+        GLfloat sum = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+          sum += m[k * 4 + row] * rhs.m[col * 4 + k];
+        }
+        result.m[col * 4 + row] = sum;
+      }
+    }
+    return result;
+  }
+
+  inline Vector3Df transformPoint(const Vector3Df& p) const {
+    return Vector3Df(
+        m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12],
+        m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13],
+        m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]);
+  }
+
+  /// @brief Gauss-Jordan elimination with partial pivoting.
+  /// @return false, if matrix is singular.
+  inline bool inverse(Matrix4f* result) const {
+    GLfloat a[4][8];
+    for (int row = 0; row < 4; ++row) {
+      for (int col = 0; col < 4; ++col) {
+        a[row][col] = m[col * 4 + row];
+        a[row][col + 4] = row == col ? 1.0f : 0.0f;
+      }
+    }
+    for (int col = 0; col < 4; ++col) {
+      int pivot = col;
+      for (int row = col + 1; row < 4; ++row) {
+        if (std::fabs(a[row][col]) > std::fabs(a[pivot][col])) {
+          pivot = row;
+        }
+      }
+      if (std::fabs(a[pivot][col]) < 1e-12f) {
+        return false;
+      }
+      for (int k = 0; k < 8; ++k) {
+        std::swap(a[col][k], a[pivot][k]);
+      }
+      GLfloat factor = 1.0f / a[col][col];
+      for (int k = 0; k < 8; ++k) {
+        a[col][k] *= factor;
+      }
+      for (int row = 0; row < 4; ++row) {
+        if (row != col && a[row][col] != 0.0f) {
+          GLfloat scale = a[row][col];
+          for (int k = 0; k < 8; ++k) {
+            a[row][k] -= scale * a[col][k];
+          }
+        }
+      }
+    }
+    for (int row = 0; row < 4; ++row) {
+      for (int col = 0; col < 4; ++col) {
+        result->m[col * 4 + row] = a[row][col + 4];
+      }
+    }
+    return true;
+  }
+
+  /// @brief Transforms point in homogeneous coordinates and divides by w.
+  inline Vector3Df transformProjective(const Vector3Df& p) const {
+    GLfloat w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+    Vector3Df result = transformPoint(p);
+    return Vector3Df(result[0] / w, result[1] / w, result[2] / w);
+  }
+
+  /// @brief Largest scale factor along any axis, to transform bounding radii.
+  inline GLfloat maxScale() const {
+    GLfloat sx = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+    GLfloat sy = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+    GLfloat sz = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+    return std::sqrt(std::fmax(sx, std::fmax(sy, sz)));
+  }
+
+  /// @brief Extracts normalized planes (a, b, c, d) of view frustum from
+  /// projection * modelview matrix, planes look inside of the frustum.
+  inline void frustumPlanes(GLfloat planes[6][4]) const {
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        planes[i * 2 + 0][j] = m[j * 4 + 3] + m[j * 4 + i];
+        planes[i * 2 + 1][j] = m[j * 4 + 3] - m[j * 4 + i];
+      }
+    }
+    for (int i = 0; i < 6; ++i) {
+      GLfloat length = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+      for (int j = 0; j < 4; ++j) {
+        planes[i][j] /= length;
+      }
+    }
+  }
+};
+
+inline bool sphereInFrustum(const GLfloat planes[6][4], const Vector3Df& center, GLfloat radius) {
+  for (int i = 0; i < 6; ++i) {
+    if (planes[i][0] * center[0] + planes[i][1] * center[1] + planes[i][2] * center[2] + planes[i][3] < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+enum class Containment : int { OUTSIDE = 0, INTERSECTS = 1, INSIDE = 2 };
+
+/// @brief Tests axis-aligned box against frustum planes, given in the same space.
+inline Containment boxInFrustum(const GLfloat planes[6][4], const Vector3Df& min, const Vector3Df& max) {
+  Containment result = Containment::INSIDE;
+  for (int i = 0; i < 6; ++i) {
+    // corners farthest along and against plane normal
+    GLfloat positive = planes[i][3], negative = planes[i][3];
+    for (int k = 0; k < 3; ++k) {
+      positive += planes[i][k] * (planes[i][k] >= 0.0f ? max[k] : min[k]);
+      negative += planes[i][k] * (planes[i][k] >= 0.0f ? min[k] : max[k]);
+    }
+    if (positive < 0.0f) {
+      return Containment::OUTSIDE;
+    }
+    if (negative < 0.0f) {
+      result = Containment::INTERSECTS;
+    }
+  }
+  return result;
+}
+
+}
+
+#endif /* SURFACE3D_MATRIX_H_ */
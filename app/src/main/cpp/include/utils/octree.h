@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_OCTREE_H_
+#define SURFACE3D_OCTREE_H_
+
+#include <cstdio>
+#include <vector>
+#include <GLES/gl.h>
+
+#include "matrix.h"
+
+
+namespace utils {
+
+/**
+ * Point cloud octree with nested subsampling: each node keeps at most one point
+ * per cell of its grid, the rest of points go down to children, so any cut of
+ * the tree is a uniformly thinned cloud. Points of nodes are written to cache
+ * file at build and read back on demand, only selected nodes stay in memory.
+ */
+class PointOctree {
+public:
+  constexpr static const uint32_t gridResolution = 128;  // cells along node edge
+  constexpr static const uint32_t maxLeafPoints = 8192;
+  constexpr static const int maxDepth = 12;
+
+  struct Point {
+    GLfloat position[3];
+    GLubyte color[4];
+  };
+
+  PointOctree();
+  virtual ~PointOctree();
+
+  /// @param colors - RGBA in [0, 1], could be null.
+  void addPoints(const GLfloat* vertices, uint32_t stride, const GLfloat* colors, uint32_t total);
+  /// @param cache_directory - where unique file to stream points of nodes from is created,
+  /// null keeps all of them in memory.
+  bool build(const char* cache_directory);
+
+  /// @brief Picks visible nodes by descending projected size, until point budget is spent.
+  /// Children are refined only when parent is in memory and its points are spread wider than a pixel.
+  /// @param planes - frustum planes in model space.
+  /// @param pixels_per_unit - size of unit at unit distance from eye.
+  void select(const GLfloat planes[6][4], const Matrix4f& modelview, GLfloat pixels_per_unit, GLfloat z_near,
+              uint32_t point_budget, std::vector<uint32_t>* selected, std::vector<uint32_t>* missing);
+  /// @return bytes read, 0 on failure (node is never requested again).
+  size_t load(uint32_t node);
+  /// @brief Drops least recently selected nodes, until resident bytes fit.
+  void evict(size_t max_bytes);
+
+  inline const Point* getPoints(uint32_t node) const { return m_nodes[node].points; }
+  inline uint32_t getNodePoints(uint32_t node) const { return m_nodes[node].total_points; }
+  inline size_t getTotalNodes() const { return m_nodes.size(); }
+  inline size_t getTotalPoints() const { return m_total_points; }
+  inline size_t getResidentBytes() const { return m_resident_bytes; }
+
+private:
+  struct Node {
+    GLfloat min[3];
+    GLfloat size;
+    int32_t children[8];
+    uint32_t total_points;
+    long offset;  // in cache file
+    Point* points;  // null, if not in memory
+    uint64_t last_used;  // frame of the last selection
+    bool failed;
+  };
+
+  std::vector<Node> m_nodes;
+  std::vector<Point> m_build_points;
+  std::FILE* m_cache;
+  char* m_cache_path;
+  size_t m_total_points;
+  size_t m_resident_bytes;
+  uint64_t m_frame;
+
+  uint32_t buildNode(uint32_t first, uint32_t count, const GLfloat* min, GLfloat size, int depth);
+  void storeNode(uint32_t node, const Point* points, uint32_t count);
+};
+
+}
+
+#endif /* SURFACE3D_OCTREE_H_ */
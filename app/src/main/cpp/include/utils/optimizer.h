@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_OPTIMIZER_H_
+#define SURFACE3D_OPTIMIZER_H_
+
+#include <vector>
+#include <GLES/gl.h>
+
+namespace utils {
+namespace optimizer {
+
+constexpr static const uint32_t cacheSize = 16;  // post-transform FIFO entries, typical for GLES 1.x hardware
+
+/// @brief Reorders triangles for post-transform vertex cache hits (Tipsify).
+/// @details Linear in number of indices. Triangle offsets where locality has been
+/// broken are stored to clusters, if not null, for further overdraw ordering.
+void optimizeVertexCache(GLuint* indices, uint32_t total_indices, uint32_t total_vertices,
+                         uint32_t cache_size = cacheSize, std::vector<uint32_t>* clusters = nullptr);
+
+/// @brief Sorts clusters of triangles so that outward facing ones are drawn first.
+/// @details Order inside clusters is kept, so vertex cache efficiency is mostly preserved.
+void optimizeOverdraw(GLuint* indices, uint32_t total_indices, const GLfloat* vertices, uint32_t stride,
+                      const std::vector<uint32_t>& clusters);
+
+/// @brief Renumbers vertices in order of their first use by indices.
+/// @param remap - old index to new one, total_vertices elements; unused vertices go last.
+void optimizeVertexFetch(GLuint* indices, uint32_t total_indices, uint32_t total_vertices, GLuint* remap);
+
+/// @brief Moves attributes according to remap produced by optimizeVertexFetch().
+void remapBuffer(GLfloat* buffer, uint32_t components, const GLuint* remap, uint32_t total_vertices);
+
+/// @brief Average cache miss ratio: transformed vertices per triangle.
+GLfloat computeACMR(const GLuint* indices, uint32_t total_indices, uint32_t total_vertices, uint32_t cache_size = cacheSize);
+/// @brief Average transform to vertex ratio: transformed vertices per referenced vertex, 1.0 is optimal.
+GLfloat computeATVR(const GLuint* indices, uint32_t total_indices, uint32_t total_vertices, uint32_t cache_size = cacheSize);
+
+}  // namespace optimizer
+}  // namespace utils
+
+#endif /* SURFACE3D_OPTIMIZER_H_ */
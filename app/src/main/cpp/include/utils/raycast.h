@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_RAYCAST_H_
+#define SURFACE3D_RAYCAST_H_
+
+#include <vector>
+#include <GLES/gl.h>
+
+#include "vector3D.h"
+
+
+namespace utils {
+
+/**
+ * Bounding volume hierarchy over triangles of a single mesh, built with binned
+ * surface area heuristic. Answers the nearest intersection with a ray.
+ * Vertices and indices are referenced, not copied, so they must outlive the hierarchy.
+ */
+class TriangleHierarchy {
+public:
+  constexpr static const int totalBins = 16;
+  constexpr static const uint32_t maxLeafTriangles = 4;
+  constexpr static const int maxDepth = 60;
+
+  struct Hit {
+    uint32_t triangle;
+    GLfloat distance;  // in units of ray direction
+    GLfloat u, v;  // barycentrics of second and third vertices
+  };
+
+  TriangleHierarchy();
+
+  /// @param indices - null for sequential triangles of not indexed mesh.
+  void build(const GLfloat* vertices, uint32_t stride, const GLushort* indices, uint32_t total_triangles);
+
+  /// @brief Finds the nearest triangle hit closer than hit->distance, either side of triangle counts.
+  /// @return true, if hit has been updated.
+  bool intersect(const Vector3Df& origin, const Vector3Df& direction, Hit* hit) const;
+
+  inline size_t getTotalNodes() const { return m_nodes.size(); }
+
+  /// @brief Slab test, inverse direction components could be infinite.
+  /// @return entry distance or negative value on miss.
+  static GLfloat intersectBox(const GLfloat* min, const GLfloat* max, const GLfloat* origin, const GLfloat* inverse_direction, GLfloat max_distance);
+
+private:
+  struct Node {
+    GLfloat min[3], max[3];
+    uint32_t first;  // leaf: first triangle in m_triangles, inner: index of right child, left child follows the node
+    uint32_t count;  // leaf: number of triangles, inner: 0
+  };
+
+  const GLfloat* m_vertices;
+  uint32_t m_stride;
+  const GLushort* m_indices;
+  std::vector<Node> m_nodes;
+  std::vector<uint32_t> m_triangles;
+
+  void buildNode(const std::vector<GLfloat>& bounds, uint32_t first, uint32_t count, int depth);
+  inline const GLfloat* vertex(uint32_t triangle, int corner) const;
+};
+
+}
+
+#endif /* SURFACE3D_RAYCAST_H_ */
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_RING_H_
+#define SURFACE3D_RING_H_
+
+#include <atomic>
+#include <cstddef>
+
+
+namespace utils {
+
+/**
+ * Bounded wait-free queue for exactly one producer thread and one consumer thread.
+ * Items are copied into preallocated slots, so neither side allocates nor locks.
+ * Capacity must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  SpscRing() : m_head(0), m_tail(0) {}
+
+  /// @brief Called by producer only.
+  /// @return false, if ring is full and item has not been stored.
+  bool push(const T& item) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    m_items[tail & (Capacity - 1)] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Called by consumer only.
+  /// @return false, if ring is empty.
+  bool pop(T* item) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *item = m_items[head & (Capacity - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Could be called from any thread, result is a snapshot.
+  bool empty() const {
+    return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+  }
+
+private:
+  // counters grow unbounded and are masked on access, each one sits on its own cache line
+  std::atomic<size_t> m_head;  // next item to pop
+  char m_head_padding[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_tail;  // next slot to push
+  char m_tail_padding[64 - sizeof(std::atomic<size_t>)];
+  T m_items[Capacity];
+};
+
+}  // namespace utils
+
+#endif /* SURFACE3D_RING_H_ */
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_SIMPLIFIER_H_
+#define SURFACE3D_SIMPLIFIER_H_
+
+#include <vector>
+#include <GLES/gl.h>
+
+namespace utils {
+namespace simplifier {
+
+/// @brief Reduces triangles by quadric edge collapses, until target number of indices is reached.
+/// @details Vertices with equal positions are welded for topology, so seams and unshared
+/// vertices do not block simplification. Collapses always move vertex to the other end of
+/// edge, and each corner picks vertex with the closest normal and texture coords there, so
+/// attributes are never interpolated. Difference of attributes is added to collapse cost.
+/// @param vertices - positions with given stride; normals and texture_coords could be null.
+/// @param result - indices of simplified mesh, referencing the same vertices.
+/// @return geometric error of result in units of positions.
+GLfloat simplify(const GLfloat* vertices, uint32_t stride, const GLfloat* normals, const GLfloat* texture_coords,
+                 uint32_t total_vertices, const GLuint* indices, uint32_t total_indices,
+                 uint32_t target_indices, std::vector<GLuint>* result);
+
+}  // namespace simplifier
+}  // namespace utils
+
+#endif /* SURFACE3D_SIMPLIFIER_H_ */
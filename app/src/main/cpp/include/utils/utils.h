@@ -62,10 +62,34 @@ void setValues(uint32_t size, float* buffer, float value = 1.0f);
 void setValues(uint32_t size, GLuint* buffer, GLuint value = 0);
 void setValues(uint32_t size, GLushort* buffer, GLushort value = 0);
 void setColorBuffer(uint32_t size, GLfloat* buffer, const GLfloat* color);
-
-void rearrange2(GLuint total_polygons, GLuint* indices, GLfloat* buffer, uint32_t size);
-void rearrange3(GLuint total_polygons, GLuint* indices, GLfloat* buffer, uint32_t size);
-void rearrange4(GLuint total_polygons, GLuint* indices, GLfloat* buffer, uint32_t size);
+void boundingBox(const GLfloat* vertices, uint32_t total, uint32_t stride, Vector3Df* min, Vector3Df* max);
+void boundingSphere(const GLfloat* vertices, uint32_t total, uint32_t stride, Vector3Df* center, GLfloat* radius);
+
+/// @brief Normal of each triangle of de-indexed vertices, written to all three of its vertices.
+void faceNormals(const GLfloat* vertices, uint32_t stride, uint32_t total_polygons, GLfloat* normals);
+
+/// @brief Copies elements of N components, addressed by indices in source with given stride,
+/// into consecutive elements of dest. Works out of place, dest holds total * N values.
+/// Sources are prefetched ahead of use, so with indices ordered for vertex cache
+/// every source element is mostly fetched from memory once.
+template <typename T, int N>
+void gather(const T* src, uint32_t stride, const GLuint* indices, uint32_t total, T* dest) {
+  constexpr uint32_t distance = 8;  // elements to look ahead
+  uint32_t i = 0;
+  for (; i + distance < total; ++i) {
+    __builtin_prefetch(&src[indices[i + distance] * stride]);
+    const T* element = &src[indices[i] * stride];
+    for (int k = 0; k < N; ++k) {
+      dest[i * N + k] = element[k];
+    }
+  }
+  for (; i < total; ++i) {
+    const T* element = &src[indices[i] * stride];
+    for (int k = 0; k < N; ++k) {
+      dest[i * N + k] = element[k];
+    }
+  }
+}
 
 template <typename T>
 void push(const T* buffer, uint32_t buffer_size, std::vector<T>* output) {
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SURFACE3D_WIREFRAME_H_
+#define SURFACE3D_WIREFRAME_H_
+
+#include <vector>
+#include <GLES/gl.h>
+
+namespace utils {
+namespace wireframe {
+
+/// @brief Collects unique edges of triangles as pairs of vertex indices for GL_LINES.
+/// @details Vertices with equal positions are welded, so seams and unshared vertices
+/// do not produce duplicate edges. Edges and vertices are hashed into lock-free tables
+/// by several threads for large meshes. Output is sorted by the first vertex.
+/// @param vertices - positions with given stride.
+/// @param indices - triangles, or null, if vertices go as triangle soup.
+/// @param feature_angle - in degrees, edges between faces closer to coplanar are skipped;
+/// border and non-manifold edges are always kept, 0 - keep all edges.
+/// @return number of edges.
+uint32_t buildEdges(const GLfloat* vertices, uint32_t stride, uint32_t total_vertices,
+                    const GLushort* indices, uint32_t total_triangles,
+                    GLfloat feature_angle, std::vector<GLuint>* edges);
+
+}  // namespace wireframe
+}  // namespace utils
+
+#endif /* SURFACE3D_WIREFRAME_H_ */
@@ -26,9 +26,11 @@
  * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <memory>
 
 #include <jni.h>
+#include "GpuResources.h"
 #include "jni_asyncContext.h"
 #include "logger.h"
 
@@ -95,7 +97,7 @@ JNIEXPORT jlong JNICALL Java_com_orcchg_surface3d_AsyncContext_initContext
   ptr->jenv = jenv;
   ptr->master_object = jenv->NewGlobalRef(object);
   ptr->master_class = (jclass) jenv->NewGlobalRef(clazz);
-  ptr->fireStringEvent_id = jenv->GetMethodID(clazz, "fireStringEventFromAsyncContext", "(Ljava/lang/String;)V");
+  ptr->fireEvents_id = jenv->GetMethodID(clazz, "fireEventsFromAsyncContext", "(I[I[F)V");
   jenv->DeleteLocalRef(object);
   jenv->DeleteLocalRef(clazz);
 
@@ -104,21 +106,24 @@ JNIEXPORT jlong JNICALL Java_com_orcchg_surface3d_AsyncContext_initContext
       [ptr](bool v) {
         JNIEnv* acontext_jenv = nullptr;
         jvm->AttachCurrentThread(&acontext_jenv, nullptr);
-        ptr->acontext->setEnvironment(acontext_jenv, ptr->master_object, ptr->fireStringEvent_id);
+        ptr->acontext->setEnvironment(acontext_jenv, ptr->master_object, ptr->fireEvents_id);
       });
   ptr->acontext_has_stopped_eventlistener = ptr->acontext->object_has_stopped_event.createListener([](bool v) {jvm->DetachCurrentThread();});
 
   /* Event subscription */
   ptr->acontext->surface_recovery_eventlistener = ptr->surface_recovery_event.createListener(&AsyncContext::callback_setWindow, ptr->acontext);
+  ptr->acontext->surface_lost_eventlistener = ptr->surface_lost_event.createListener(&AsyncContext::callback_surfaceLost, ptr->acontext);
   ptr->acontext->translation_gesture_eventlistener = ptr->gesture_translation_event.createListener(&AsyncContext::callback_gestureTranslation, ptr->acontext);
   ptr->acontext->rotation_gesture_eventlistener = ptr->gesture_rotation_event.createListener(&AsyncContext::callback_gestureRotation, ptr->acontext);
   ptr->acontext->zoom_gesture_eventlistener = ptr->gesture_zoom_event.createListener(&AsyncContext::callback_gestureZoom, ptr->acontext);
+  ptr->acontext->touch_gesture_eventlistener = ptr->gesture_touch_event.createListener(&AsyncContext::callback_gestureTouch, ptr->acontext);
   ptr->acontext->drop_gestures_eventlistener = ptr->drop_gestures_event.createListener(&AsyncContext::callback_dropGestures, ptr->acontext);
   ptr->acontext->drop_translation_gesture_eventlistener = ptr->drop_translation_gesture_event.createListener(&AsyncContext::callback_dropTranslation, ptr->acontext);
   ptr->acontext->drop_rotation_gesture_eventlistener = ptr->drop_rotation_gesture_event.createListener(&AsyncContext::callback_dropRotation, ptr->acontext);
   ptr->acontext->drop_zoom_gesture_eventlistener = ptr->drop_zoom_gesture_event.createListener(&AsyncContext::callback_dropZoom, ptr->acontext);
   ptr->acontext->clear_surface_eventlistener = ptr->clear_surface_event.createListener(&AsyncContext::callback_clearSurface, ptr->acontext);
   ptr->acontext->textures_enabled_eventlistener = ptr->textures_enabled_event.createListener(&AsyncContext::callback_texturesEnabled, ptr->acontext);
+  ptr->acontext->flat_shading_eventlistener = ptr->flat_shading_event.createListener(&AsyncContext::callback_setFlatShading, ptr->acontext);
   ptr->acontext->vertex_limit_set_eventlistener = ptr->vertex_limit_set_event.createListener(&AsyncContext::callback_setVertexLimit, ptr->acontext);
   ptr->acontext->draw_type_set_eventlistener = ptr->draw_type_set_event.createListener(&AsyncContext::callback_setDrawType, ptr->acontext);
   ptr->acontext->bg_color_set_eventlistener = ptr->bg_color_set_event.createListener(&AsyncContext::callback_setBgColor, ptr->acontext);
@@ -135,6 +140,7 @@ JNIEXPORT jlong JNICALL Java_com_orcchg_surface3d_AsyncContext_initAssets
   ptr->asset_storage = new AssetStorage(jenv, assetManager);
   const char* internal_file_storage = jenv->GetStringUTFChars(internalFileStorage_Java, 0);
   ptr->asset_storage->setInternalFileStorage(internal_file_storage);
+  ptr->acontext->setCacheDirectory(internal_file_storage);
   jenv->ReleaseStringUTFChars(internalFileStorage_Java, internal_file_storage);
   jlong assets = (jlong)(intptr_t) ptr->asset_storage;
   return assets;
@@ -162,13 +168,21 @@ JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetSurface
   (JNIEnv *jenv, jobject, jlong descriptor, jobject surface) {
   AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
   if (surface != nullptr) {
+    ANativeWindow* previous = ptr->windowAlreadyReleased ? nullptr : ptr->window;
     ptr->window = ANativeWindow_fromSurface(jenv, surface);
+    ptr->windowAlreadyReleased = false;
     DBG("Got window %p", ptr->window);
     if (ptr->surface_recovery_event.hasListeners()) {
       ptr->surface_recovery_event.notifyListeners(ptr->window);
     }
+    if (previous != nullptr) {
+      ANativeWindow_release(previous);  // surface changed, window surface is recreated, context is kept
+    }
   } else {
     if (ptr != nullptr && !ptr->windowAlreadyReleased && ptr->window != nullptr) {
+      if (ptr->surface_lost_event.hasListeners()) {
+        ptr->surface_lost_event.notifyListeners(true);  // returns, when window is not drawn anymore
+      }
       DBG("Releasing window");
       ANativeWindow_release(ptr->window);
       ptr->windowAlreadyReleased = true;
@@ -209,19 +223,36 @@ JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeDropZoom
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeTranslate
   (JNIEnv *, jobject, jlong descriptor, jfloat x, jfloat y, jfloat z) {
   AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
-  ptr->gesture_translation_event.notifyListeners(std::make_shared<gesture::Translation>(x, y, z));
+  ptr->gesture_translation_event.notifyListeners(gesture::Translation(x, y, z));
 }
 
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeRotate
   (JNIEnv *, jobject, jlong descriptor, jboolean x, jboolean y, jboolean z, jfloat x_angle, jfloat y_angle, jfloat z_angle) {
   AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
-  ptr->gesture_rotation_event.notifyListeners(std::make_shared<gesture::Rotation>(x, y, z, x_angle, y_angle, z_angle));
+  ptr->gesture_rotation_event.notifyListeners(gesture::Rotation(x, y, z, x_angle, y_angle, z_angle));
 }
 
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeZoom
   (JNIEnv *, jobject, jlong descriptor, jfloat scale_x, jfloat scale_y, jfloat scale_z) {
   AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
-  ptr->gesture_zoom_event.notifyListeners(std::make_shared<gesture::Zoom>(scale_x, scale_y, scale_z));
+  ptr->gesture_zoom_event.notifyListeners(gesture::Zoom(scale_x, scale_y, scale_z));
+}
+
+JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeTouch
+  (JNIEnv* jenv, jobject, jlong descriptor, jfloatArray samples, jint count) {
+  AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
+  // whole batch in one call, copied in chunks to stack and queued for recognition on render thread
+  constexpr static const jint chunk = 16;
+  jfloat packed[chunk * gesture::Touch::packedSize];
+  // never read past the array, whatever count the caller passed
+  count = std::min(count, jenv->GetArrayLength(samples) / static_cast<jint>(gesture::Touch::packedSize));
+  for (jint first = 0; first < count; first += chunk) {
+    jint total = std::min(chunk, count - first);
+    jenv->GetFloatArrayRegion(samples, first * gesture::Touch::packedSize, total * gesture::Touch::packedSize, packed);
+    for (jint i = 0; i < total; ++i) {
+      ptr->gesture_touch_event.notifyListeners(gesture::Touch(&packed[i * gesture::Touch::packedSize]));
+    }
+  }
 }
 
 JNIEXPORT jfloat JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeGetTranslationX
@@ -314,6 +345,12 @@ JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetDrawType
   ptr->draw_type_set_event.notifyListeners(static_cast<DrawType>(type));
 }
 
+JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetFlatShading
+  (JNIEnv *, jobject, jlong descriptor, jboolean enabled) {
+  AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
+  ptr->flat_shading_event.notifyListeners(enabled != JNI_FALSE);
+}
+
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetBackgroundColor
   (JNIEnv *jenv, jobject, jlong descriptor, jstring bgColor_Java) {
   AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
@@ -330,6 +367,47 @@ JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeShowAxis
   ptr->axis_visibility_set_event.notifyListeners(isVisible);
 }
 
+JNIEXPORT jlong JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeGetGpuMemory
+  (JNIEnv *, jobject, jlong descriptor, jint category) {
+  if (category < 0 || category >= GpuResources::totalCategories) {
+    return 0;
+  }
+  return static_cast<jlong>(GpuResources::get().getBytes(static_cast<GpuCategory>(category)));
+}
+
+JNIEXPORT jlong JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeGetGpuMemoryBudget
+  (JNIEnv *, jobject, jlong descriptor, jint category) {
+  if (category < 0 || category >= GpuResources::totalCategories) {
+    return 0;
+  }
+  return static_cast<jlong>(GpuResources::get().getBudget(static_cast<GpuCategory>(category)));
+}
+
+JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_nativeSetGpuMemoryBudget
+  (JNIEnv *, jobject, jlong descriptor, jint category, jlong bytes) {
+  if (category < 0 || category >= GpuResources::totalCategories || bytes < 0) {
+    WRN("Wrong GPU memory budget: category %i, bytes %lli", category, (long long) bytes);
+    return;
+  }
+  GpuResources::get().setBudget(static_cast<GpuCategory>(category), static_cast<size_t>(bytes));
+}
+
+JNIEXPORT jboolean JNICALL Java_com_orcchg_surface3d_AsyncContext_nativePick
+  (JNIEnv* jenv, jobject, jlong descriptor, jfloat x, jfloat y, jintArray indices, jfloatArray values) {
+  AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
+  AsyncContext::PickResult result;
+  if (jenv->GetArrayLength(indices) < 3 || jenv->GetArrayLength(values) < 5 ||
+      !ptr->acontext->pick(x, y, &result)) {
+    return JNI_FALSE;
+  }
+  // mesh, instance, triangle; u, v, x, y, z
+  jint index_values[3] = {result.mesh, result.instance, result.triangle};
+  jfloat float_values[5] = {result.u, result.v, result.position[0], result.position[1], result.position[2]};
+  jenv->SetIntArrayRegion(indices, 0, 3, index_values);
+  jenv->SetFloatArrayRegion(values, 0, 5, float_values);
+  return JNI_TRUE;
+}
+
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_AsyncContext_uploadScene
   (JNIEnv *, jobject, jlong descriptor, jlong scene_descriptor) {
   AsyncContextStruct* ptr = (AsyncContextStruct*) descriptor;
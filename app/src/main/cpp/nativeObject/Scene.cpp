@@ -30,8 +30,11 @@
 #include <algorithm>
 #include <string>
 
+#include <assimp/parallel.h>
+
 #include "AssetStorage.h"
 #include "assimp_utils.h"
+#include "JobSystem.h"
 #include "logger.h"
 #include "macro.h"
 #include "Scene.h"
@@ -41,7 +44,14 @@ jmethodID native::SceneProgressHandler::method = 0;
 
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_Scene_nativeInit
   (JNIEnv *jenv, jclass clazz) {
-  native::SceneProgressHandler::method = jenv->GetMethodID(clazz, "publishProgress", "(F)V");
+  native::SceneProgressHandler::method = jenv->GetMethodID(clazz, "publishEvents", "(I[I[F)V");
+}
+
+JNIEXPORT void JNICALL Java_com_orcchg_surface3d_Scene_nativeSetImportProfile
+  (JNIEnv *, jobject, jlong descriptor, jint profile) {
+  native::Scene* ptr = (native::Scene*) descriptor;
+  ptr->setImportProfile(profile == static_cast<jint>(native::ImportProfile::QUALITY) ?
+      native::ImportProfile::QUALITY : native::ImportProfile::FAST);
 }
 
 JNIEXPORT jint JNICALL Java_com_orcchg_surface3d_Scene_nativeGetVertices
@@ -129,16 +139,14 @@ JNIEXPORT jboolean JNICALL Java_com_orcchg_surface3d_Scene_openAsset
   delete [] asset_buffer;  asset_buffer = nullptr;
 
   native::Scene* ptr = (native::Scene*) descriptor;
-  native::SceneProgressHandler* handler = new native::SceneProgressHandler(jenv, object);
+  EventChannel events;
+  events.bind(jenv, object, native::SceneProgressHandler::method);
+  native::SceneProgressHandler* handler = new native::SceneProgressHandler(&events);
   ptr->importer->SetProgressHandler(handler);
-  unsigned int flags =
-      aiProcess_Triangulate |
-      aiProcess_SortByPType |
-      aiProcess_ScaleToUnitBox |
-      aiProcess_GenSmoothNormals |
-      aiProcess_ValidateDataStructure;
-  ptr->scene = ptr->importer->ReadFile(filenameAux, flags);
+  ptr->scene = ptr->importer->ReadFile(filenameAux, ptr->importFlags());
+  ptr->importer->SetProgressHandler(nullptr);
   delete handler;  handler = nullptr;
+  events.unbind();  // delivers final progress
   std::remove(filenameAux);
 
   INF("Assimp log: %s", ptr->importer->GetErrorString());
@@ -168,16 +176,14 @@ JNIEXPORT jboolean JNICALL Java_com_orcchg_surface3d_Scene_openFile
 
   const char* filename = jenv->GetStringUTFChars(filename_Java, 0);
   native::Scene* ptr = (native::Scene*) descriptor;
-  native::SceneProgressHandler* handler = new native::SceneProgressHandler(jenv, object);
+  EventChannel events;
+  events.bind(jenv, object, native::SceneProgressHandler::method);
+  native::SceneProgressHandler* handler = new native::SceneProgressHandler(&events);
   ptr->importer->SetProgressHandler(handler);
-  unsigned int flags =
-      aiProcess_Triangulate |
-      aiProcess_SortByPType |
-      aiProcess_ScaleToUnitBox |
-      aiProcess_GenSmoothNormals |
-      aiProcess_ValidateDataStructure;
-  ptr->scene = ptr->importer->ReadFile(filename, flags);
+  ptr->scene = ptr->importer->ReadFile(filename, ptr->importFlags());
+  ptr->importer->SetProgressHandler(nullptr);
   delete handler;  handler = nullptr;
+  events.unbind();  // delivers final progress
 
   INF("Assimp log: %s", ptr->importer->GetErrorString());
   if (ptr->scene == nullptr) {
@@ -331,6 +337,19 @@ JNIEXPORT jboolean JNICALL Java_com_orcchg_surface3d_Scene_fetchResources__JJ_3L
         case native::ImageCode::png:
           texture = new native::PNGTexture(assets, resource_filename);
           break;
+        case native::ImageCode::tga:
+          texture = new native::TGATexture(assets, resource_filename);
+          break;
+        case native::ImageCode::dds:
+          texture = new native::DDSTexture(assets, resource_filename);
+          break;
+        case native::ImageCode::ktx:
+        case native::ImageCode::ktx2:
+          texture = new native::KTXTexture(assets, resource_filename);
+          break;
+        case native::ImageCode::pkm:
+          texture = new native::PKMTexture(assets, resource_filename);
+          break;
         case native::ImageCode::none:
         default:
           break;
@@ -339,7 +358,7 @@ JNIEXPORT jboolean JNICALL Java_com_orcchg_surface3d_Scene_fetchResources__JJ_3L
         WRN("Texture image format [%i] not supported!", codes[imt]);
         continue;
       }
-      ptr->textures.emplace_back(texture);
+      ptr->addTexture(texture);
       DBG("Loaded texture [%s]: %p", resource_filename, texture);
 
     } else {  // material - write to internal storage
@@ -441,6 +460,19 @@ JNIEXPORT jboolean JNICALL Java_com_orcchg_surface3d_Scene_fetchResources__J_3Lj
         case native::ImageCode::png:
           texture = new native::PNGTexture(resource_filename);
           break;
+        case native::ImageCode::tga:
+          texture = new native::TGATexture(resource_filename);
+          break;
+        case native::ImageCode::dds:
+          texture = new native::DDSTexture(resource_filename);
+          break;
+        case native::ImageCode::ktx:
+        case native::ImageCode::ktx2:
+          texture = new native::KTXTexture(resource_filename);
+          break;
+        case native::ImageCode::pkm:
+          texture = new native::PKMTexture(resource_filename);
+          break;
         case native::ImageCode::none:
         default:
           break;
@@ -449,7 +481,7 @@ JNIEXPORT jboolean JNICALL Java_com_orcchg_surface3d_Scene_fetchResources__J_3Lj
         WRN("Texture image format [%i] not supported!", codes[imt]);
         continue;
       }
-      ptr->textures.emplace_back(texture);
+      ptr->addTexture(texture);
       DBG("Loaded texture [%s]: %p", resource_filename, texture);
 
     } else {  // material
@@ -492,33 +524,52 @@ JNIEXPORT jobjectArray JNICALL Java_com_orcchg_surface3d_Scene_getSeparateTextur
 
 namespace native {
 
-SceneProgressHandler::SceneProgressHandler(JNIEnv* env, jobject object)
+SceneProgressHandler::SceneProgressHandler(EventChannel* events)
   : ProgressHandler()
-  , jenv(env)
-  , object(object) {
+  , events(events) {
 }
 
 SceneProgressHandler::~SceneProgressHandler() {
-  jenv = nullptr;
-  object = nullptr;
+  events = nullptr;
 }
 
 bool SceneProgressHandler::Update(float percentage) {
 //  DBG("Progress: %lf", percentage);
-  jenv->CallVoidMethod(object, SceneProgressHandler::method, percentage * 100);
+  events->progress(percentage * 100);  // delivered at channel rate, not per tick
   return true;
 }
 
+void SceneProgressHandler::UpdateFileRead(int currentStep, int numberOfSteps) {
+  events->stage(static_cast<int>(ImportStage::READ), currentStep);
+  ProgressHandler::UpdateFileRead(currentStep, numberOfSteps);
+}
+
+void SceneProgressHandler::UpdatePostProcess(int currentStep, int numberOfSteps) {
+  events->stage(static_cast<int>(ImportStage::POST_PROCESS), currentStep);
+  ProgressHandler::UpdatePostProcess(currentStep, numberOfSteps);
+}
+
 // ----------------------------------------------
+/// @brief Runs parallel parts of Assimp post processing steps on the shared job system.
+static void runAssimpTasks(unsigned int tasks, void (*task)(void* data, unsigned int index), void* data) {
+  JobSystem::get().parallelFor(tasks, [task, data](size_t index) {
+    task(data, static_cast<unsigned int>(index));
+  });
+}
+
 Scene::Scene()
   : importer(new Assimp::Importer())
   , scene(nullptr)
+  , import_profile(ImportProfile::QUALITY)
   , materials_total(0)
   , material_file_paths(nullptr)
   , resources_total(0)
   , resource_file_paths(nullptr)
   , hasReferencedResources(false) {
   DBG("Scene::ctor");
+  // unit box scale goes to root node, renderer applies it with node transforms
+  importer->SetPropertyInteger(AI_CONFIG_PP_SUB_ROOT_TRANSFORM, 1);
+  aiSetParallelRunner(runAssimpTasks, JobSystem::get().concurrency());
 }
 
 Scene::~Scene() {
@@ -547,6 +598,24 @@ Scene::~Scene() {
   scene = nullptr;
 }
 
+unsigned int Scene::importFlags() const {
+  unsigned int flags =
+      aiProcess_Triangulate |
+      aiProcess_SortByPType |
+      aiProcess_FindInstances |
+      aiProcess_ScaleToUnitBox |
+      aiProcess_ValidateDataStructure;
+  switch (import_profile) {
+    case ImportProfile::QUALITY:
+      flags |= aiProcess_GenSmoothNormals;
+      break;
+    case ImportProfile::FAST:
+      flags |= aiProcess_GenIndexedNormals;
+      break;
+  }
+  return flags;
+}
+
 unsigned int Scene::totalVertices() const {
   unsigned int total_meshes = scene->mNumMeshes;
   if (total_meshes <= 0) { WRN("No meshes in scene!"); return 0; }
@@ -605,22 +674,15 @@ std::vector<std::string> Scene::separateTexturesPaths() const {
 }
 
 int Scene::findTextureIndexByName(const std::string& texture_name) const {
-  std::string fixed_string = texture_name;
-  std::replace(fixed_string.begin(), fixed_string.end(), '\\', '/');
-  std::string lower_string = fixed_string;
-  std::transform(lower_string.begin(), lower_string.end(), lower_string.begin(), ::tolower);
-
-  char* dup_lower = strdup(lower_string.c_str());
-  char* base_lower = strdup(basename(dup_lower));
-
-  int index = 0;
-  for (auto& texture : textures) {
-    if (strcmp(base_lower, texture->getName()) == 0) {
-      return index;
-    }
-    ++index;
+  auto it = texture_indices.find(Texture::nameFromPath(texture_name));
+  return it != texture_indices.end() ? it->second : -1;
+}
+
+void Scene::addTexture(Texture* texture) {
+  if (texture->getName() != nullptr) {
+    texture_indices.emplace(texture->getName(), textures.size());  // first one wins on duplicates
   }
-  return -1;
+  textures.emplace_back(texture);
 }
 
 }  // namespace native
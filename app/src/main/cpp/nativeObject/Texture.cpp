@@ -26,13 +26,38 @@
  * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 
+#include "ContextGroup.h"
+#include "GpuResources.h"
 #include "logger.h"
 #include "Texture.h"
 
 
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_ATC_RGB_AMD
+#define GL_ATC_RGB_AMD 0x8C92
+#endif
+#ifndef GL_ATC_RGBA_EXPLICIT_ALPHA_AMD
+#define GL_ATC_RGBA_EXPLICIT_ALPHA_AMD 0x8C93
+#endif
+#ifndef GL_ATC_RGBA_INTERPOLATED_ALPHA_AMD
+#define GL_ATC_RGBA_INTERPOLATED_ALPHA_AMD 0x87EE
+#endif
+
+
 namespace native {
 
 static void copyBuffers(const aiTexel* in, uint8_t* out, unsigned int size) {
@@ -55,9 +80,30 @@ Texture::Texture(AssetStorage* assets, const char* filename)
   , m_format(0)
   , m_width(0)
   , m_height(0)
-  , m_error_code(0) {
+  , m_level_size(0)
+  , m_gpu_bytes(0)
+  , m_generation(0)
+  , m_error_code(0)
+  , m_staging(false)
+  , m_placeholder(nullptr)
+  , m_placeholder_width(0)
+  , m_placeholder_height(0)
+  , m_placeholder_format(0)
+  , m_decoded(nullptr)
+  , m_decoded_width(0)
+  , m_decoded_height(0)
+  , m_decoded_max_size(0)
+  , m_staged_id(0)
+  , m_staged_generation(0)
+  , m_staged_level_size(0)
+  , m_staged_bytes(0)
+  , m_stage_reserved(false)
+  , m_source(nullptr)
+  , m_source_size(0)
+  , m_source_copy(nullptr) {
   DBG("Texture::ctor(assets)");
   strcpy(m_filename, filename);
+  m_name = nameFromPath(m_filename);
 }
 
 Texture::Texture(const char* filepath)
@@ -70,9 +116,30 @@ Texture::Texture(const char* filepath)
   , m_format(0)
   , m_width(0)
   , m_height(0)
-  , m_error_code(0) {
+  , m_level_size(0)
+  , m_gpu_bytes(0)
+  , m_generation(0)
+  , m_error_code(0)
+  , m_staging(false)
+  , m_placeholder(nullptr)
+  , m_placeholder_width(0)
+  , m_placeholder_height(0)
+  , m_placeholder_format(0)
+  , m_decoded(nullptr)
+  , m_decoded_width(0)
+  , m_decoded_height(0)
+  , m_decoded_max_size(0)
+  , m_staged_id(0)
+  , m_staged_generation(0)
+  , m_staged_level_size(0)
+  , m_staged_bytes(0)
+  , m_stage_reserved(false)
+  , m_source(nullptr)
+  , m_source_size(0)
+  , m_source_copy(nullptr) {
   DBG("Texture::ctor(file system)");
   strcpy(m_filename, filepath);
+  m_name = nameFromPath(m_filename);
 }
 
 Texture::Texture(const aiTexel* data, unsigned int size)
@@ -85,14 +152,38 @@ Texture::Texture(const aiTexel* data, unsigned int size)
   , m_format(0)
   , m_width(0)
   , m_height(0)
-  , m_error_code(0) {
+  , m_level_size(0)
+  , m_gpu_bytes(0)
+  , m_generation(0)
+  , m_error_code(0)
+  , m_staging(false)
+  , m_placeholder(nullptr)
+  , m_placeholder_width(0)
+  , m_placeholder_height(0)
+  , m_placeholder_format(0)
+  , m_decoded(nullptr)
+  , m_decoded_width(0)
+  , m_decoded_height(0)
+  , m_decoded_max_size(0)
+  , m_staged_id(0)
+  , m_staged_generation(0)
+  , m_staged_level_size(0)
+  , m_staged_bytes(0)
+  , m_stage_reserved(false)
+  , m_source(nullptr)
+  , m_source_size(0)
+  , m_source_copy(nullptr) {
   DBG("Texture::ctor(memory)");
 }
 
 Texture::~Texture() {
   DBG("Texture::~dtor");
+  unmapSource();
   m_assets = nullptr;
   delete [] m_filename;  m_filename = nullptr;
+  delete [] m_placeholder;  m_placeholder = nullptr;
+  delete [] m_decoded;  m_decoded = nullptr;
+  cancelStage();
   unload();
 }
 
@@ -102,59 +193,372 @@ int32_t Texture::getWidth() const { return m_width; }
 int32_t Texture::getHeight() const { return m_height; }
 const char* Texture::getFilename() const { return m_filename; }
 int Texture::getErrorCode() const { return m_error_code; }
+uint32_t Texture::getLevelSize() const { return m_level_size; }
+size_t Texture::getGpuBytes() const { return m_gpu_bytes; }
+
+bool Texture::isResident() const {
+  return m_id != 0 && m_generation == GpuResources::get().getGeneration();
+}
 
 const char* Texture::getName() const {
-  if (m_filename != nullptr) {
-    std::string lower = m_filename;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-    return basename(lower.c_str());
+  return m_filename != nullptr ? m_name.c_str() : nullptr;
+}
+
+std::string Texture::nameFromPath(const std::string& path) {
+  std::string name = path;
+  std::replace(name.begin(), name.end(), '\\', '/');
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+  size_t separator = name.rfind('/');
+  if (separator != std::string::npos) {
+    name.erase(0, separator + 1);
   }
-  return nullptr;
+  return name;
 }
 
 bool Texture::load() {
-  const uint8_t* image_buffer = loadImage();
+  return load(0);
+}
+
+bool Texture::load(uint32_t max_size) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if ((m_decoded == nullptr || m_decoded_max_size != max_size) && !decode(max_size)) {
+    return false;
+  }
+  bool result = upload(m_decoded, m_decoded_width, m_decoded_height, m_format);
+  delete [] m_decoded;  m_decoded = nullptr;
+  return result;
+}
+
+bool Texture::decode(uint32_t max_size) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if (m_decoded != nullptr && m_decoded_max_size == max_size) {
+    return true;  // decoded by another view, not loaded yet
+  }
+  delete [] m_decoded;  m_decoded = nullptr;
+  uint8_t* image_buffer = const_cast<uint8_t*>(loadImage());
   if (image_buffer == nullptr) {
     ERR("Internal error during loading texture!");
     return false;
   }
 
-  glGenTextures(1, &m_id);
-  glBindTexture(GL_TEXTURE_2D, m_id);
+  uint32_t width = m_width, height = m_height;
+  uint32_t channels = bytesPerTexel(m_format, m_type);
+  if (m_type == GL_UNSIGNED_BYTE && channels != 0) {
+    image_buffer = downsample(image_buffer, &width, &height, channels, max_size);
+    if (m_placeholder == nullptr) {
+      // cache placeholder while image is decoded, so demotions never touch the source
+      size_t image_size = width * height * channels;
+      uint8_t* copy = new (std::nothrow) uint8_t[image_size];
+      if (copy != nullptr) {
+        std::memcpy(copy, image_buffer, image_size);
+        m_placeholder_width = width;  m_placeholder_height = height;
+        m_placeholder = downsample(copy, &m_placeholder_width, &m_placeholder_height, channels, placeholderSize);
+        m_placeholder_format = m_format;
+      }
+    }
+  } else if (max_size != 0) {
+    WRN("Texture %s could not be reduced, loading full size", m_filename);
+  }
+
+  m_decoded = image_buffer;
+  m_decoded_width = width;  m_decoded_height = height;
+  m_decoded_max_size = max_size;
+  return true;
+}
+
+bool Texture::canDecodeConcurrently() const {
+  return m_read_mode != ReadMode::ASSETS;
+}
+
+bool Texture::loadPlaceholder() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if (m_placeholder == nullptr) {
+    return load(placeholderSize);
+  }
+  return upload(m_placeholder, m_placeholder_width, m_placeholder_height, m_placeholder_format);
+}
+
+bool Texture::upload(const uint8_t* image, uint32_t width, uint32_t height, GLint format) {
+  if (!m_staging) {
+    evict();
+  }
+  size_t bytes = width * height * bytesPerTexel(format, m_type) * 4 / 3;  // with generated mipmaps
+  if (!GpuResources::get().fits(GpuCategory::TEXTURES, bytes)) {
+    WRN("Texture %s does not fit GPU memory budget", m_filename);
+    return false;
+  }
+  GLuint id = 0;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
   glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
 //  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 //  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 //  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 //  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexImage2D(GL_TEXTURE_2D, 0, m_format, m_width, m_height, 0, m_format, m_type, image_buffer);
-  delete [] image_buffer;  image_buffer = nullptr;
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // rows of RGB images are not 4-bytes aligned
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, m_type, image);
   glBindTexture(GL_TEXTURE_2D, 0);
 
   GLenum glerror = glGetError();
   if (glerror != GL_NO_ERROR) {
-    ERR("Error loading texture %s into OpenGL, gl error %zu", m_filename, glerror);
-    unload();
+    ERR("Error loading texture %s into OpenGL, gl error 0x%x", m_filename, glerror);
+    glDeleteTextures(1, &id);
+    if (!m_staging) {
+      unload();
+    }
     return false;
   }
+  setLevel(id, std::max(width, height), bytes);
   return true;
 }
 
-void Texture::unload() {
-  glBindTexture(GL_TEXTURE_2D, 0);
+void Texture::setLevel(GLuint id, uint32_t level_size, size_t bytes) {
+  GpuResources::get().allocated(GpuCategory::TEXTURES, bytes);
+  if (m_staging) {  // drawn level is kept until publish()
+    m_staged_id = id;
+    m_staged_generation = GpuResources::get().getGeneration();
+    m_staged_level_size = level_size;
+    m_staged_bytes = bytes;
+    return;
+  }
+  if (ContextGroup::get().getTotalContexts() > 1) {
+    glFinish();  // other views could bind it right away, GLES 1.x has no fences
+  }
+  m_id = id;
+  m_generation = GpuResources::get().getGeneration();
+  m_level_size = level_size;
+  m_gpu_bytes = bytes;
+}
+
+bool Texture::reserveStage() {
+  return !m_stage_reserved.exchange(true);
+}
+
+bool Texture::stage(uint32_t max_size) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  m_staging = true;
+  bool result = load(max_size);
+  m_staging = false;
+  return result;
+}
+
+void Texture::publish() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if (m_staged_id != 0) {
+    // drawing views switch from one level to another, but never see texture evicted
+    GLuint id = m_id.exchange(m_staged_id);
+    size_t bytes = m_gpu_bytes.exchange(m_staged_bytes);
+    uint32_t generation = m_generation.exchange(m_staged_generation);
+    m_level_size = m_staged_level_size;
+    if (id != 0) {
+      GpuResources::get().release(GpuCategory::TEXTURES, id, bytes, generation);
+    }
+    m_staged_id = 0;
+  }
+  m_stage_reserved.store(false);
+}
+
+void Texture::cancelStage() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  if (m_staged_id != 0) {
+    GpuResources::get().release(GpuCategory::TEXTURES, m_staged_id, m_staged_bytes, m_staged_generation);
+    m_staged_id = 0;
+  }
+  m_stage_reserved.store(false);
+}
+
+bool Texture::isStaging() const {
+  return m_stage_reserved.load();
+}
+
+void Texture::evict() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
   if (m_id != 0) {
-    glDeleteTextures(1, &m_id);
+    GpuResources::get().release(GpuCategory::TEXTURES, m_id, m_gpu_bytes, m_generation);
     m_id = 0;
   }
+  m_level_size = 0;
+  m_gpu_bytes = 0;
+}
+
+void Texture::unload() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  evict();
   m_format = 0;
   m_width = 0;
   m_height = 0;
 }
 
+size_t Texture::estimateBytes(uint32_t max_size) const {
+  uint32_t width = m_width, height = m_height;
+  while (max_size != 0 && std::max(width, height) > max_size && std::max(width, height) > 1) {
+    width = std::max(width >> 1, 1u);  height = std::max(height >> 1, 1u);
+  }
+  return width * height * bytesPerTexel(m_format, m_type) * 4 / 3;
+}
+
+bool Texture::canDecodeRGBA() const {
+  return m_type == GL_UNSIGNED_BYTE && bytesPerTexel(m_format, m_type) != 0;
+}
+
+uint8_t* Texture::decodeRGBA(uint32_t* width, uint32_t* height) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  uint8_t* image_buffer = const_cast<uint8_t*>(loadImage());
+  if (image_buffer == nullptr) {
+    ERR("Internal error during decoding texture!");
+    return nullptr;
+  }
+  uint32_t channels = bytesPerTexel(m_format, m_type);
+  if (m_type != GL_UNSIGNED_BYTE || channels == 0) {
+    delete [] image_buffer;  image_buffer = nullptr;
+    return nullptr;
+  }
+
+  size_t total_texels = m_width * m_height;
+  uint8_t* rgba = new (std::nothrow) uint8_t[total_texels * 4];
+  if (rgba != nullptr) {
+    for (size_t i = 0; i < total_texels; ++i) {
+      const uint8_t* in = &image_buffer[i * channels];
+      uint8_t* out = &rgba[i * 4];
+      switch (m_format) {
+        case GL_ALPHA:
+          out[0] = 255;  out[1] = 255;  out[2] = 255;  out[3] = in[0];
+          break;
+        case GL_LUMINANCE:
+          out[0] = in[0];  out[1] = in[0];  out[2] = in[0];  out[3] = 255;
+          break;
+        case GL_LUMINANCE_ALPHA:
+          out[0] = in[0];  out[1] = in[0];  out[2] = in[0];  out[3] = in[1];
+          break;
+        case GL_RGB:
+          out[0] = in[0];  out[1] = in[1];  out[2] = in[2];  out[3] = 255;
+          break;
+        default:
+          out[0] = in[0];  out[1] = in[1];  out[2] = in[2];  out[3] = in[3];
+          break;
+      }
+    }
+    *width = m_width;
+    *height = m_height;
+  }
+  delete [] image_buffer;  image_buffer = nullptr;
+  return rgba;
+}
+
+uint32_t Texture::bytesPerTexel(GLint format, GLint type) {
+  if (type != GL_UNSIGNED_BYTE) {
+    return 2;  // packed 16-bits formats
+  }
+  switch (format) {
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+      return 1;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    case GL_RGB:
+      return 3;
+    case GL_RGBA:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+uint8_t* Texture::downsample(uint8_t* image, uint32_t* width, uint32_t* height, uint32_t channels, uint32_t max_size) {
+  while (max_size != 0 && std::max(*width, *height) > max_size && std::max(*width, *height) > 1) {
+    uint32_t half_width = std::max(*width >> 1, 1u), half_height = std::max(*height >> 1, 1u);
+    uint8_t* half = new (std::nothrow) uint8_t[half_width * half_height * channels];
+    if (half == nullptr) {
+      WRN("Failed to allocate memory to downsample texture");
+      break;
+    }
+    // 2x2 box filter, odd last row and column are clamped
+    for (uint32_t y = 0; y < half_height; ++y) {
+      uint32_t y0 = std::min(y * 2, *height - 1), y1 = std::min(y * 2 + 1, *height - 1);
+      for (uint32_t x = 0; x < half_width; ++x) {
+        uint32_t x0 = std::min(x * 2, *width - 1), x1 = std::min(x * 2 + 1, *width - 1);
+        for (uint32_t c = 0; c < channels; ++c) {
+          uint32_t sum = image[(y0 * *width + x0) * channels + c] + image[(y0 * *width + x1) * channels + c] +
+                         image[(y1 * *width + x0) * channels + c] + image[(y1 * *width + x1) * channels + c];
+          half[(y * half_width + x) * channels + c] = static_cast<uint8_t>((sum + 2) / 4);
+        }
+      }
+    }
+    delete [] image;
+    image = half;
+    *width = half_width;  *height = half_height;
+  }
+  return image;
+}
+
 void Texture::apply() {
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, m_id);
 }
 
+const uint8_t* Texture::mapSource(size_t* size) {
+  *size = 0;
+  switch (m_read_mode) {
+    case ReadMode::ASSETS:
+      if (!m_assets->open(m_filename)) { return nullptr; }
+      m_source_size = m_assets->length();
+      m_source = const_cast<void*>(m_assets->buffer());
+      if (m_source == nullptr) {
+        // asset is compressed inside package, fallback to plain reading
+        m_source_copy = new (std::nothrow) uint8_t[m_source_size];
+        if (m_source_copy == nullptr || !m_assets->read(m_source_copy)) {
+          delete [] m_source_copy;  m_source_copy = nullptr;
+          m_assets->close();
+          m_source_size = 0;
+          return nullptr;
+        }
+        m_source = m_source_copy;
+      }
+      break;
+    case ReadMode::FILESYSTEM: {
+      int file_descriptor = ::open(m_filename, O_RDONLY);
+      if (file_descriptor < 0) { return nullptr; }
+      struct stat file_stat;
+      if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size <= 0) {
+        ::close(file_descriptor);
+        return nullptr;
+      }
+      void* address = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+      ::close(file_descriptor);  // mapping keeps file referenced
+      if (address == MAP_FAILED) { return nullptr; }
+      m_source = address;
+      m_source_size = file_stat.st_size;
+      break; }
+    case ReadMode::MEMORY_TEXELS:
+      // embedded texture keeps raw content of image file, size is in bytes
+      m_source = const_cast<aiTexel*>(m_data);
+      m_source_size = m_data_size;
+      break;
+  }
+  *size = m_source_size;
+  return static_cast<const uint8_t*>(m_source);
+}
+
+void Texture::unmapSource() {
+  if (m_source == nullptr) {
+    return;
+  }
+  switch (m_read_mode) {
+    case ReadMode::ASSETS:
+      delete [] m_source_copy;  m_source_copy = nullptr;
+      m_assets->close();
+      break;
+    case ReadMode::FILESYSTEM:
+      munmap(m_source, m_source_size);
+      break;
+    case ReadMode::MEMORY_TEXELS:
+      // no-op
+      break;
+  }
+  m_source = nullptr;
+  m_source_size = 0;
+}
+
 // ----------------------------------------------------------------------------
 BMPTexture::BMPTexture(AssetStorage* assets, const char* filename)
   : Texture(assets, filename) {
@@ -601,73 +1005,713 @@ TGATexture::~TGATexture() {
   DBG("TGATexture::~dtor");
 }
 
+/// @brief Swaps red and blue channels of tightly packed BGR(A) texels in-place.
+static void swizzleBGR(uint8_t* buffer, size_t count, uint32_t depth) {
+  if (depth == 4) {
+    // whole texel at once: swap bytes 0 and 2 of little-endian word
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t texel;
+      std::memcpy(&texel, buffer + i * 4, 4);
+      texel = (texel & 0xFF00FF00u) | ((texel >> 16) & 0xFFu) | ((texel & 0xFFu) << 16);
+      std::memcpy(buffer + i * 4, &texel, 4);
+    }
+  } else if (depth == 3) {
+    for (size_t i = 0; i < count * 3; i += 3) {
+      std::swap(buffer[i], buffer[i + 2]);
+    }
+  }
+}
+
 const uint8_t* TGATexture::loadImage() {
-//  FILE *filePtr;
-//  unsigned char ucharBad;
-//  short int sintBad;
-//  long imageSize;
-//  int colorMode;
-//  unsigned char colorSwap;
-//
-//  // Open the TGA file.
-//  filePtr = fopen(filename, "rb");
-//  if (filePtr == NULL)
-//  {
-//      return false;
-//  }
-//
-//  // Read the two first bytes we don't need.
-//  fread(&ucharBad, sizeof(unsigned char), 1, filePtr);
-//  fread(&ucharBad, sizeof(unsigned char), 1, filePtr);
-//
-//  // Which type of image gets stored in imageTypeCode.
-//  fread(&tgaFile->imageTypeCode, sizeof(unsigned char), 1, filePtr);
-//
-//  // For our purposes, the type code should be 2 (uncompressed RGB image)
-//  // or 3 (uncompressed black-and-white images).
-//  if (tgaFile->imageTypeCode != 2 && tgaFile->imageTypeCode != 3)
-//  {
-//      fclose(filePtr);
-//      return false;
-//  }
-//
-//  // Read 13 bytes of data we don't need.
-//  fread(&sintBad, sizeof(short int), 1, filePtr);
-//  fread(&sintBad, sizeof(short int), 1, filePtr);
-//  fread(&ucharBad, sizeof(unsigned char), 1, filePtr);
-//  fread(&sintBad, sizeof(short int), 1, filePtr);
-//  fread(&sintBad, sizeof(short int), 1, filePtr);
-//
-//  // Read the image's width and height.
-//  fread(&tgaFile->imageWidth, sizeof(short int), 1, filePtr);
-//  fread(&tgaFile->imageHeight, sizeof(short int), 1, filePtr);
-//
-//  // Read the bit depth.
-//  fread(&tgaFile->bitCount, sizeof(unsigned char), 1, filePtr);
-//
-//  // Read one byte of data we don't need.
-//  fread(&ucharBad, sizeof(unsigned char), 1, filePtr);
-//
-//  // Color mode -> 3 = BGR, 4 = BGRA.
-//  colorMode = tgaFile->bitCount / 8;
-//  imageSize = tgaFile->imageWidth * tgaFile->imageHeight * colorMode;
-//
-//  // Allocate memory for the image data.
-//  tgaFile->imageData = (unsigned char*)malloc(sizeof(unsigned char)*imageSize);
-//
-//  // Read the image data.
-//  fread(tgaFile->imageData, sizeof(unsigned char), imageSize, filePtr);
-//
-//  // Change from BGR to RGB so OpenGL can read the image data.
-//  for (int imageIdx = 0; imageIdx < imageSize; imageIdx += colorMode)
-//  {
-//      colorSwap = tgaFile->imageData[imageIdx];
-//      tgaFile->imageData[imageIdx] = tgaFile->imageData[imageIdx + 2];
-//      tgaFile->imageData[imageIdx + 2] = colorSwap;
-//  }
-//
-//  fclose(filePtr);
-//  return true;
+  const uint8_t* source = nullptr;
+  const uint8_t* source_end = nullptr;
+  const uint8_t* pixels = nullptr;
+  size_t source_size = 0;
+  uint8_t* image_buffer = nullptr;
+  uint8_t* image_ptr = nullptr;
+  uint8_t* image_end = nullptr;
+  uint32_t width = 0, height = 0, depth = 0;
+  uint32_t row_size = 0;
+  uint32_t colormap_size = 0;
+  size_t image_size = 0;  // width * height * depth
+  uint8_t image_type = 0;
+  uint8_t descriptor = 0;
+  int error_code = 0;
+
+  source = mapSource(&source_size);
+  if (source == nullptr) { error_code = 1; goto ERROR_TGA; }
+  if (source_size < 18) { error_code = 2; goto ERROR_TGA; }
+  source_end = source + source_size;
+
+  image_type = source[2];
+  if (image_type != 2 && image_type != 3 && image_type != 10 && image_type != 11) { error_code = 3; goto ERROR_TGA; }
+
+  width = source[12] | (source[13] << 8);
+  height = source[14] | (source[15] << 8);
+  depth = source[16] / 8;
+  descriptor = source[17];
+  m_width = width;  m_height = height;
+
+  switch (depth) {
+    case 1:
+      m_format = GL_LUMINANCE;
+      break;
+    case 3:
+      m_format = GL_RGB;
+      break;
+    case 4:
+      m_format = GL_RGBA;
+      break;
+    default:
+      error_code = 4; goto ERROR_TGA;
+  }
+  m_type = GL_UNSIGNED_BYTE;
+
+  // skip image id and color map, if any
+  colormap_size = (source[5] | (source[6] << 8)) * ((source[7] + 7) / 8);
+  pixels = source + 18 + source[0] + colormap_size;
+  if (pixels > source_end) { error_code = 2; goto ERROR_TGA; }
+
+  image_size = static_cast<size_t>(width) * height * depth;
+  image_buffer = new (std::nothrow) uint8_t[image_size];
+  if (image_buffer == nullptr) { error_code = 5; goto ERROR_TGA; }
+  image_ptr = image_buffer;
+  image_end = image_buffer + image_size;
+
+  if (image_type < 9) {  // uncompressed
+    if (static_cast<size_t>(source_end - pixels) < image_size) { error_code = 6; goto ERROR_TGA; }
+    std::memcpy(image_buffer, pixels, image_size);
+  } else {  // run-length encoded
+    while (image_ptr < image_end) {
+      if (pixels >= source_end) { error_code = 6; goto ERROR_TGA; }
+      uint8_t packet = *pixels++;
+      size_t count = (packet & 0x7F) + 1;
+      size_t run_size = count * depth;
+      if (static_cast<size_t>(image_end - image_ptr) < run_size) { error_code = 7; goto ERROR_TGA; }
+      if (packet & 0x80) {  // run packet: single texel repeated
+        if (static_cast<size_t>(source_end - pixels) < depth) { error_code = 6; goto ERROR_TGA; }
+        for (size_t i = 0; i < count; ++i, image_ptr += depth) {
+          std::memcpy(image_ptr, pixels, depth);
+        }
+        pixels += depth;
+      } else {  // raw packet
+        if (static_cast<size_t>(source_end - pixels) < run_size) { error_code = 6; goto ERROR_TGA; }
+        std::memcpy(image_ptr, pixels, run_size);
+        image_ptr += run_size;
+        pixels += run_size;
+      }
+    }
+  }
+  unmapSource();
+
+  swizzleBGR(image_buffer, static_cast<size_t>(width) * height, depth);
+
+  if (descriptor & 0x20) {  // top-left origin, while OpenGL expects bottom-left
+    row_size = width * depth;
+    for (uint32_t i = 0; i < height / 2; ++i) {
+      uint8_t* top = image_buffer + i * row_size;
+      uint8_t* bottom = image_buffer + (height - (i + 1)) * row_size;
+      std::swap_ranges(top, top + row_size, bottom);
+    }
+  }
+  return image_buffer;
+
+  ERROR_TGA:
+    m_error_code = static_cast<int>(ImageCode::tga) * 100 + error_code;
+    ERR("Error while reading TGA file: %s, code %i", m_filename, m_error_code);
+    unmapSource();
+    delete [] image_buffer;  image_buffer = nullptr;
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+static uint32_t readU32(const uint8_t* data) {
+  uint32_t value;
+  std::memcpy(&value, data, 4);
+  return value;
+}
+
+static uint64_t readU64(const uint8_t* data) {
+  uint64_t value;
+  std::memcpy(&value, data, 8);
+  return value;
+}
+
+static uint16_t readU16BigEndian(const uint8_t* data) {
+  return (data[0] << 8) | data[1];
+}
+
+static constexpr uint32_t fourCC(char a, char b, char c, char d) {
+  return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+         (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+CompressedTexture::CompressedTexture(AssetStorage* assets, const char* filename)
+  : Texture(assets, filename) {
+  DBG("CompressedTexture::ctor(assets)");
+}
+
+CompressedTexture::CompressedTexture(const char* filepath)
+  : Texture(filepath) {
+  DBG("CompressedTexture::ctor(file system)");
+}
+
+CompressedTexture::CompressedTexture(const aiTexel* data, unsigned int size)
+  : Texture(data, size) {
+  DBG("CompressedTexture::ctor(memory)");
+}
+
+CompressedTexture::~CompressedTexture() {
+  DBG("CompressedTexture::~dtor");
+}
+
+bool CompressedTexture::decode(uint32_t max_size) {
+  return true;
+}
+
+bool CompressedTexture::load(uint32_t max_size) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  m_levels.clear();
+  const uint8_t* source = loadImage();  // mapped, not decoded
+  if (source == nullptr) {
+    ERR("Internal error during loading compressed texture!");
+    return false;
+  }
+
+  // mipmaps could not be generated for compressed formats, so texture is
+  // filtered with mipmaps only if the whole chain is stored in container
+  size_t full_chain = 1;
+  for (uint32_t side = std::max(m_width, m_height); side > 1; side >>= 1) {
+    ++full_chain;
+  }
+  size_t total_levels = std::min(m_levels.size(), full_chain);
+  if (total_levels == 0) {
+    ERR("Compressed texture %s has no mip levels", m_filename);
+    unmapSource();
+    return false;
+  }
+
+  // stored levels are used as is, reduced texture starts from smaller one
+  size_t base_level = 0;
+  while (max_size != 0 && base_level + 1 < total_levels &&
+         std::max(m_levels[base_level].width, m_levels[base_level].height) > max_size) {
+    ++base_level;
+  }
+
+  if (!m_staging) {
+    evict();
+  }
+  size_t bytes = 0;
+  for (size_t level = base_level; level < total_levels; ++level) {
+    bytes += m_levels[level].size;
+  }
+  if (!GpuResources::get().fits(GpuCategory::TEXTURES, bytes)) {
+    WRN("Compressed texture %s does not fit GPU memory budget", m_filename);
+    m_levels.clear();
+    unmapSource();
+    return false;
+  }
+  GLuint id = 0;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+  for (size_t level = base_level; level < total_levels; ++level) {
+    const Level& mip = m_levels[level];
+    glCompressedTexImage2D(GL_TEXTURE_2D, level - base_level, m_format, mip.width, mip.height, 0, mip.size, mip.data);
+  }
+  uint32_t level_size = std::max(m_levels[base_level].width, m_levels[base_level].height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, total_levels == full_chain ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  m_levels.clear();
+  unmapSource();
+
+  GLenum glerror = glGetError();
+  if (glerror != GL_NO_ERROR) {
+    ERR("Error loading compressed texture %s into OpenGL, gl error 0x%x", m_filename, glerror);
+    glDeleteTextures(1, &id);
+    if (!m_staging) {
+      unload();
+    }
+    return false;
+  }
+  setLevel(id, level_size, bytes);
+  return true;
+}
+
+size_t CompressedTexture::estimateBytes(uint32_t max_size) const {
+  uint32_t width = m_width, height = m_height;
+  while (max_size != 0 && std::max(width, height) > max_size && std::max(width, height) > 1) {
+    width = std::max(width >> 1, 1u);  height = std::max(height >> 1, 1u);
+  }
+  size_t bytes = 0;
+  while (true) {
+    bytes += blockImageSize(m_format, width, height);
+    if (width == 1 && height == 1) {
+      break;
+    }
+    width = std::max(width >> 1, 1u);  height = std::max(height >> 1, 1u);
+  }
+  return bytes;
+}
+
+uint8_t* CompressedTexture::decodeRGBA(uint32_t* width, uint32_t* height) {
+  return nullptr;  // payload is never decoded on CPU side
+}
+
+bool CompressedTexture::canDecodeRGBA() const {
+  return false;
+}
+
+bool CompressedTexture::isFormatSupported(GLenum internal_format) {
+  GLint total_formats = 0;
+  glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &total_formats);
+  if (total_formats <= 0) {
+    return false;
+  }
+  std::vector<GLint> formats(total_formats);
+  glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, &formats[0]);
+  return std::find(formats.begin(), formats.end(), static_cast<GLint>(internal_format)) != formats.end();
+}
+
+GLsizei CompressedTexture::blockImageSize(GLenum internal_format, uint32_t width, uint32_t height) {
+  GLsizei block_size = 0;
+  switch (internal_format) {
+    case GL_ETC1_RGB8_OES:
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_ATC_RGB_AMD:
+      block_size = 8;
+      break;
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_ATC_RGBA_EXPLICIT_ALPHA_AMD:
+    case GL_ATC_RGBA_INTERPOLATED_ALPHA_AMD:
+      block_size = 16;
+      break;
+    case GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG:
+    case GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG:
+      // 4 bits per texel, but not less than 8x8 texels
+      return std::max(width, 8u) * std::max(height, 8u) / 2;
+    default:
+      return 0;  // unknown format
+  }
+  return ((width + 3) / 4) * ((height + 3) / 4) * block_size;
+}
+
+// ----------------------------------------------------------------------------
+static const uint8_t KTX1_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+KTXTexture::KTXTexture(AssetStorage* assets, const char* filename)
+  : CompressedTexture(assets, filename) {
+  DBG("KTXTexture::ctor(assets)");
+}
+
+KTXTexture::KTXTexture(const char* filepath)
+  : CompressedTexture(filepath) {
+  DBG("KTXTexture::ctor(file system)");
+}
+
+KTXTexture::KTXTexture(const aiTexel* data, unsigned int size)
+  : CompressedTexture(data, size) {
+  DBG("KTXTexture::ctor(memory)");
+}
+
+KTXTexture::~KTXTexture() {
+  DBG("KTXTexture::~dtor");
+}
+
+const uint8_t* KTXTexture::loadImage() {
+  size_t source_size = 0;
+  int error_code = 0;
+
+  const uint8_t* source = mapSource(&source_size);
+  if (source == nullptr) {
+    error_code = 1;
+  } else if (source_size >= 12 && std::memcmp(source, KTX1_IDENTIFIER, 12) == 0) {
+    error_code = parseKTX1(source, source_size);
+  } else if (source_size >= 12 && std::memcmp(source, KTX2_IDENTIFIER, 12) == 0) {
+    error_code = parseKTX2(source, source_size);
+  } else {
+    error_code = 2;
+  }
+
+  if (error_code != 0) {
+    m_error_code = static_cast<int>(ImageCode::ktx) * 100 + error_code;
+    ERR("Error while reading KTX file: %s, code %i", m_filename, m_error_code);
+    m_levels.clear();
+    unmapSource();
+    return nullptr;
+  }
+  return source;
+}
+
+int KTXTexture::parseKTX1(const uint8_t* data, size_t size) {
+  if (size < 64) { return 2; }
+
+  // endianness, glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat,
+  // pixelWidth, pixelHeight, pixelDepth, numberOfArrayElements, numberOfFaces,
+  // numberOfMipmapLevels, bytesOfKeyValueData
+  uint32_t header[13];
+  std::memcpy(header, data + 12, sizeof(header));
+  bool swap = false;
+  if (header[0] == 0x01020304) {
+    swap = true;
+  } else if (header[0] != 0x04030201) {
+    return 3;
+  }
+  if (swap) {
+    for (int i = 0; i < 13; ++i) { header[i] = __builtin_bswap32(header[i]); }
+  }
+
+  GLenum internal_format = header[4];
+  uint32_t width = header[6], height = header[7];
+  uint32_t total_levels = std::max(header[11], 1u);
+  if (header[1] != 0) { return 4; }
+  if (header[8] > 1 || header[9] > 0 || header[10] != 1) { return 5; }
+  if (blockImageSize(internal_format, width, height) == 0) { return 7; }
+  if (!isFormatSupported(internal_format)) { return 8; }
+  m_format = internal_format;
+  m_width = width;  m_height = height;
+
+  // sizes come from file: compared by subtraction, sums could overflow
+  if (header[12] > size - 64) { return 9; }
+  size_t offset = 64 + static_cast<size_t>(header[12]);
+  for (uint32_t level = 0; level < total_levels; ++level) {
+    if (offset > size || 4 > size - offset) { return 9; }
+    uint32_t image_size = readU32(data + offset);
+    if (swap) { image_size = __builtin_bswap32(image_size); }
+    offset += 4;
+    if (image_size > size - offset || image_size > INT32_MAX) { return 9; }
+    Level mip;
+    mip.data = data + offset;
+    mip.size = image_size;
+    mip.width = std::max(width >> level, 1u);
+    mip.height = std::max(height >> level, 1u);
+    m_levels.push_back(mip);
+    offset += (image_size + 3) & ~3u;  // mipPadding
+  }
+  return 0;
+}
+
+int KTXTexture::parseKTX2(const uint8_t* data, size_t size) {
+  if (size < 80) { return 2; }
+
+  // vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth, layerCount,
+  // faceCount, levelCount, supercompressionScheme
+  uint32_t header[9];
+  std::memcpy(header, data + 12, sizeof(header));
+
+  GLenum internal_format = 0;
+  switch (header[0]) {
+    case 131:  // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+      internal_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+      break;
+    case 133:  // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+      internal_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+      break;
+    case 135:  // VK_FORMAT_BC2_UNORM_BLOCK
+      internal_format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+      break;
+    case 137:  // VK_FORMAT_BC3_UNORM_BLOCK
+      internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+      break;
+    case 1000054001:  // VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG
+      internal_format = GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG;
+      break;
+    default:
+      return 7;
+  }
+
+  uint32_t width = header[2], height = header[3];
+  uint32_t total_levels = std::max(header[7], 1u);
+  if (header[4] > 1 || header[5] > 1 || header[6] != 1) { return 5; }
+  if (header[8] != 0) { return 6; }
+  if (!isFormatSupported(internal_format)) { return 8; }
+  m_format = internal_format;
+  m_width = width;  m_height = height;
+
+  // level index follows fixed header and index of data format descriptor,
+  // key/value data and supercompression global data
+  if (total_levels > (size - 80) / 24) { return 2; }
+  for (uint32_t level = 0; level < total_levels; ++level) {
+    uint64_t offset = readU64(data + 80 + static_cast<size_t>(level) * 24);
+    uint64_t length = readU64(data + 80 + static_cast<size_t>(level) * 24 + 8);
+    // values come from file: compared by subtraction, the sum could overflow
+    if (offset > size || length > size - offset || length > INT32_MAX) { return 9; }
+    Level mip;
+    mip.data = data + offset;
+    mip.size = static_cast<GLsizei>(length);
+    mip.width = std::max(width >> level, 1u);
+    mip.height = std::max(height >> level, 1u);
+    m_levels.push_back(mip);
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+DDSTexture::DDSTexture(AssetStorage* assets, const char* filename)
+  : CompressedTexture(assets, filename) {
+  DBG("DDSTexture::ctor(assets)");
+}
+
+DDSTexture::DDSTexture(const char* filepath)
+  : CompressedTexture(filepath) {
+  DBG("DDSTexture::ctor(file system)");
+}
+
+DDSTexture::DDSTexture(const aiTexel* data, unsigned int size)
+  : CompressedTexture(data, size) {
+  DBG("DDSTexture::ctor(memory)");
+}
+
+DDSTexture::~DDSTexture() {
+  DBG("DDSTexture::~dtor");
+}
+
+const uint8_t* DDSTexture::loadImage() {
+  const uint8_t* source = nullptr;
+  size_t source_size = 0;
+  size_t offset = 128;  // magic + DDS_HEADER
+  uint32_t width = 0, height = 0, total_levels = 0;
+  uint32_t pixel_flags = 0;
+  GLenum internal_format = 0;
+  int error_code = 0;
+
+  source = mapSource(&source_size);
+  if (source == nullptr) { error_code = 1; goto ERROR_DDS; }
+  if (source_size < 128 || std::memcmp(source, "DDS ", 4) != 0 || readU32(source + 4) != 124) { error_code = 2; goto ERROR_DDS; }
+
+  height = readU32(source + 12);
+  width = readU32(source + 16);
+  total_levels = (readU32(source + 8) & 0x20000) ? std::max(readU32(source + 28), 1u) : 1;  // DDSD_MIPMAPCOUNT
+  pixel_flags = readU32(source + 80);
+  if (!(pixel_flags & 0x4)) { error_code = 3; goto ERROR_DDS; }  // DDPF_FOURCC
+  if (readU32(source + 112) & (0x200 | 0x200000)) { error_code = 4; goto ERROR_DDS; }  // DDSCAPS2_CUBEMAP, DDSCAPS2_VOLUME
+
+  switch (readU32(source + 84)) {
+    case fourCC('D', 'X', 'T', '1'):
+      internal_format = (pixel_flags & 0x1) ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+      break;
+    case fourCC('D', 'X', 'T', '3'):
+      internal_format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+      break;
+    case fourCC('D', 'X', 'T', '5'):
+      internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+      break;
+    case fourCC('A', 'T', 'C', ' '):
+      internal_format = GL_ATC_RGB_AMD;
+      break;
+    case fourCC('A', 'T', 'C', 'A'):
+      internal_format = GL_ATC_RGBA_EXPLICIT_ALPHA_AMD;
+      break;
+    case fourCC('A', 'T', 'C', 'I'):
+      internal_format = GL_ATC_RGBA_INTERPOLATED_ALPHA_AMD;
+      break;
+    case fourCC('D', 'X', '1', '0'):
+      error_code = 3; goto ERROR_DDS;
+    default:
+      error_code = 5; goto ERROR_DDS;
+  }
+  if (!isFormatSupported(internal_format)) { error_code = 6; goto ERROR_DDS; }
+  m_format = internal_format;
+  m_width = width;  m_height = height;
+
+  for (uint32_t level = 0; level < total_levels; ++level) {
+    Level mip;
+    mip.width = std::max(width >> level, 1u);
+    mip.height = std::max(height >> level, 1u);
+    mip.size = blockImageSize(internal_format, mip.width, mip.height);
+    mip.data = source + offset;
+    if (offset + mip.size > source_size) { error_code = 7; goto ERROR_DDS; }
+    m_levels.push_back(mip);
+    offset += mip.size;
+  }
+  return source;
+
+  ERROR_DDS:
+    m_error_code = static_cast<int>(ImageCode::dds) * 100 + error_code;
+    ERR("Error while reading DDS file: %s, code %i", m_filename, m_error_code);
+    m_levels.clear();
+    unmapSource();
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+PKMTexture::PKMTexture(AssetStorage* assets, const char* filename)
+  : CompressedTexture(assets, filename) {
+  DBG("PKMTexture::ctor(assets)");
+}
+
+PKMTexture::PKMTexture(const char* filepath)
+  : CompressedTexture(filepath) {
+  DBG("PKMTexture::ctor(file system)");
+}
+
+PKMTexture::PKMTexture(const aiTexel* data, unsigned int size)
+  : CompressedTexture(data, size) {
+  DBG("PKMTexture::ctor(memory)");
+}
+
+PKMTexture::~PKMTexture() {
+  DBG("PKMTexture::~dtor");
+}
+
+const uint8_t* PKMTexture::loadImage() {
+  const uint8_t* source = nullptr;
+  size_t source_size = 0;
+  Level mip;
+  int error_code = 0;
+
+  source = mapSource(&source_size);
+  if (source == nullptr) { error_code = 1; goto ERROR_PKM; }
+  if (source_size < 16 || std::memcmp(source, "PKM ", 4) != 0) { error_code = 2; goto ERROR_PKM; }
+  if (std::memcmp(source + 4, "10", 2) != 0 || readU16BigEndian(source + 6) != 0) { error_code = 3; goto ERROR_PKM; }
+  if (!isFormatSupported(GL_ETC1_RGB8_OES)) { error_code = 4; goto ERROR_PKM; }
+
+  // header keeps dimensions padded to 4x4 blocks and original ones
+  mip.width = readU16BigEndian(source + 12);
+  mip.height = readU16BigEndian(source + 14);
+  mip.size = blockImageSize(GL_ETC1_RGB8_OES, mip.width, mip.height);
+  mip.data = source + 16;
+  if (16 + static_cast<size_t>(mip.size) > source_size) { error_code = 5; goto ERROR_PKM; }
+  m_format = GL_ETC1_RGB8_OES;
+  m_width = mip.width;  m_height = mip.height;
+  m_levels.push_back(mip);
+  return source;
+
+  ERROR_PKM:
+    m_error_code = static_cast<int>(ImageCode::pkm) * 100 + error_code;
+    ERR("Error while reading PKM file: %s, code %i", m_filename, m_error_code);
+    m_levels.clear();
+    unmapSource();
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+AtlasTexture::AtlasTexture(uint32_t size)
+  : Texture(static_cast<const aiTexel*>(nullptr), 0)
+  , m_size(size)
+  , m_image(new (std::nothrow) uint8_t[size * size * 4])
+  , m_total_tiles(0) {
+  DBG("AtlasTexture::ctor");
+  if (m_image != nullptr) {
+    std::memset(m_image, 0, size * size * 4);
+  }
+  SkylineNode node = {0, 0, size};
+  m_skyline.push_back(node);
+}
+
+AtlasTexture::~AtlasTexture() {
+  DBG("AtlasTexture::~dtor");
+  delete [] m_image;  m_image = nullptr;
+}
+
+uint32_t AtlasTexture::getTotalTiles() const { return m_total_tiles; }
+
+bool AtlasTexture::add(const uint8_t* tile, uint32_t width, uint32_t height, GLfloat* transform) {
+  if (m_image == nullptr || tile == nullptr) {
+    return false;
+  }
+
+  uint32_t padded_width = (width + gutter * 3 - 1) / gutter * gutter;  // tile, both gutters, aligned
+  uint32_t padded_height = (height + gutter * 3 - 1) / gutter * gutter;
+  uint32_t x = 0, y = 0;
+  if (!findPosition(padded_width, padded_height, &x, &y)) {
+    return false;
+  }
+  addSkylineLevel(x, y, padded_width, padded_height);
+
+  for (uint32_t row = 0; row < padded_height; ++row) {
+    uint32_t tile_row = std::min(static_cast<uint32_t>(std::max(static_cast<int>(row) - static_cast<int>(gutter), 0)), height - 1);
+    for (uint32_t col = 0; col < padded_width; ++col) {
+      uint32_t tile_col = std::min(static_cast<uint32_t>(std::max(static_cast<int>(col) - static_cast<int>(gutter), 0)), width - 1);
+      std::memcpy(&m_image[((y + row) * m_size + x + col) * 4], &tile[(tile_row * width + tile_col) * 4], 4);
+    }
+  }
+
+  transform[0] = static_cast<GLfloat>(width) / m_size;
+  transform[1] = static_cast<GLfloat>(height) / m_size;
+  transform[2] = static_cast<GLfloat>(x + gutter) / m_size;
+  transform[3] = static_cast<GLfloat>(y + gutter) / m_size;
+  ++m_total_tiles;
+  return true;
+}
+
+const uint8_t* AtlasTexture::loadImage() {
+  if (m_image == nullptr) {
+    ERR("Atlas image has not been allocated");
+    return nullptr;
+  }
+  size_t image_size = m_size * m_size * 4;
+  uint8_t* image_buffer = new (std::nothrow) uint8_t[image_size];
+  if (image_buffer == nullptr) {
+    ERR("Failed to allocate memory for atlas image");
+    return nullptr;
+  }
+  std::memcpy(image_buffer, m_image, image_size);  // loaded image is consumed by caller
+  m_width = m_size;
+  m_height = m_size;
+  m_format = GL_RGBA;
+  m_type = GL_UNSIGNED_BYTE;
+  return image_buffer;
+}
+
+bool AtlasTexture::findPosition(uint32_t width, uint32_t height, uint32_t* x, uint32_t* y) const {
+  bool found = false;
+  uint32_t best_y = m_size;
+  for (size_t i = 0; i < m_skyline.size(); ++i) {
+    uint32_t left = m_skyline[i].x;
+    if (left + width > m_size) {
+      break;
+    }
+    // tile rests on the highest node it spans
+    uint32_t top = 0;
+    for (size_t j = i; j < m_skyline.size() && m_skyline[j].x < left + width; ++j) {
+      top = std::max(top, m_skyline[j].y);
+    }
+    if (top + height <= m_size && (!found || top < best_y)) {
+      found = true;
+      best_y = top;
+      *x = left;
+      *y = top;
+    }
+  }
+  return found;
+}
+
+void AtlasTexture::addSkylineLevel(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+  size_t index = 0;
+  while (index < m_skyline.size() && m_skyline[index].x != x) {
+    ++index;
+  }
+  SkylineNode node = {x, y + height, width};
+  m_skyline.insert(m_skyline.begin() + index, node);
+
+  // nodes covered by new one are shrunk or removed
+  for (size_t i = index + 1; i < m_skyline.size(); ) {
+    uint32_t right = x + width;
+    if (m_skyline[i].x >= right) {
+      break;
+    }
+    uint32_t shrink = right - m_skyline[i].x;
+    if (m_skyline[i].width <= shrink) {
+      m_skyline.erase(m_skyline.begin() + i);
+      continue;
+    }
+    m_skyline[i].x += shrink;
+    m_skyline[i].width -= shrink;
+    break;
+  }
+
+  for (size_t i = 0; i + 1 < m_skyline.size(); ) {
+    if (m_skyline[i].y == m_skyline[i + 1].y) {
+      m_skyline[i].width += m_skyline[i + 1].width;
+      m_skyline.erase(m_skyline.begin() + i + 1);
+    } else {
+      ++i;
+    }
+  }
 }
 
 }  // namespace native
@@ -48,6 +48,14 @@ extern "C" {
 JNIEXPORT void JNICALL Java_com_orcchg_surface3d_Scene_nativeInit
   (JNIEnv *, jclass);
 
+/*
+ * Class:     com_orcchg_surface3d_Scene
+ * Method:    nativeSetImportProfile
+ * Signature: (JI)V
+ */
+JNIEXPORT void JNICALL Java_com_orcchg_surface3d_Scene_nativeSetImportProfile
+  (JNIEnv *, jobject, jlong, jint);
+
 /*
  * Class:     com_orcchg_surface3d_Scene
  * Method:    nativeGetVertices
@@ -165,6 +173,8 @@ JNIEXPORT jobjectArray JNICALL Java_com_orcchg_surface3d_Scene_getSeparateTextur
 #endif
 #endif
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <android/asset_manager.h>
@@ -178,24 +188,33 @@ JNIEXPORT jobjectArray JNICALL Java_com_orcchg_surface3d_Scene_getSeparateTextur
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "EventChannel.h"
 #include "logger.h"
 #include "Texture.h"
 
 
 namespace native {
 
+/// @brief Stages of import reported by STAGE events, values are shared with NativeEvent.java.
+enum class ImportStage : int {
+  READ = 0,
+  POST_PROCESS = 1
+};
+
 class SceneProgressHandler : public Assimp::ProgressHandler {
 public:
-  SceneProgressHandler(JNIEnv* env, jobject object);
+  SceneProgressHandler(EventChannel* events);
   virtual ~SceneProgressHandler();
 
   bool Update(float percentage) override final;
+  void UpdateFileRead(int currentStep, int numberOfSteps) override final;
+  void UpdatePostProcess(int currentStep, int numberOfSteps) override final;
 
+  /// Receiver of event batches of Java Scene
   static jmethodID method;
 
 private:
-  JNIEnv* jenv;
-  jobject object;
+  EventChannel* events;
 };
 
 /* Logging */
@@ -221,6 +240,12 @@ public:
 };
 
 // ----------------------------------------------
+/// @brief Sets of post processing steps applied at import, values are shared with Surface3DView.java.
+enum class ImportProfile : int {
+  QUALITY = 0,  // default, normals are smoothed over vertices close in space, slow on large scans
+  FAST = 1      // normals are accumulated through indices at identical positions
+};
+
 class Scene : public NativeObject {
 public:
   Scene();
@@ -228,6 +253,11 @@ public:
 
   Assimp::Importer* importer;
   const aiScene* scene;
+  ImportProfile import_profile;
+
+  /// @brief Takes effect for the next import.
+  inline void setImportProfile(ImportProfile profile) { import_profile = profile; }
+  unsigned int importFlags() const;
 
   unsigned int totalVertices() const;
   unsigned int totalPolygons() const;
@@ -239,6 +269,7 @@ public:
 
   std::vector<std::string> separateTexturesPaths() const;
   int findTextureIndexByName(const std::string& texture_name) const;
+  void addTexture(Texture* texture);
 
   // --------------------------------------------
   /* Used when fetching resources separately */
@@ -248,6 +279,7 @@ public:
 
   // not embedded textures
   std::vector<Texture*> textures;
+  std::unordered_map<std::string, int> texture_indices;  // normalized name -> index in textures
 
   // --------------------------------------------
   /* Used when referencing resources via Assimp */
@@ -30,7 +30,12 @@
 #define TEXTURE_H_
 
 #include <libgen.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
 #include <GLES/gl.h>
+#include <GLES/glext.h>
 #include <jpeglib.h>
 #include <png.h>
 #include <assimp/texture.h>
@@ -48,7 +53,8 @@ enum class ImageCode : int {
   mng = 1013, pal = 1014, pbm = 1015, pcd  = 1016,
   pcx = 1017, pgm = 1018, pic = 1019, png  = 1020,
   ppm = 1021, psd = 1022, psp = 1023, raw  = 1024,
-  sgi = 1025, tga = 1026, tif = 1027, IL = 1028
+  sgi = 1025, tga = 1026, tif = 1027, IL = 1028,
+  ktx = 1029, pkm = 1030, ktx2 = 1031
 };
 
 static const char* toString(ImageCode code) {
@@ -110,6 +116,12 @@ static const char* toString(ImageCode code) {
       return "tga";
     case ImageCode::tif:
       return "tif";
+    case ImageCode::ktx:
+      return "ktx";
+    case ImageCode::pkm:
+      return "pkm";
+    case ImageCode::ktx2:
+      return "ktx2";
   }
 }
 
@@ -128,13 +140,69 @@ public:
   const char* getName() const;
   int getErrorCode() const;
 
-  virtual bool load();
+  /// @brief Normalized name of texture file: lower-case base name, any path separators.
+  static std::string nameFromPath(const std::string& path);
+
+  /// @brief Side of placeholder image kept in memory for demoted textures.
+  constexpr static const uint32_t placeholderSize = 16;
+
+  bool load();
+  /// @brief Loads texture reduced so that none of its sides exceeds max_size.
+  /// @details Zero max_size means full resolution. Previously loaded level is replaced.
+  virtual bool load(uint32_t max_size);
+  /// @brief Loads low-res copy of texture, decoded image is cached on first load.
+  bool loadPlaceholder();
+  /// @brief Decodes image for the next load() with the same max_size, makes no GL calls.
+  /// @details Could run on worker thread, unless canDecodeConcurrently() is false.
+  virtual bool decode(uint32_t max_size);
+  /// @brief Whether decode() could run concurrently with other textures,
+  /// textures from assets share the only opened asset of AssetStorage.
+  bool canDecodeConcurrently() const;
+  /// @brief Marks texture as being staged, false if it is staged already.
+  bool reserveStage();
+  /// @brief Loads level as load() does, but keeps drawn level until publish().
+  /// @details Runs on upload thread with context of the same group current, after
+  /// reserveStage(), only if canDecodeConcurrently(). Nothing else loads or evicts
+  /// texture until publish() or cancelStage().
+  bool stage(uint32_t max_size);
+  /// @brief Replaces drawn level with staged one, which upload must have been completed.
+  void publish();
+  /// @brief Drops staged level, if any.
+  void cancelStage();
+  bool isStaging() const;
+  /// @brief Releases GPU memory but keeps texture description, so it could be loaded again.
+  /// @details Could be called from any thread, GL object is deleted by GpuResources on rendering thread.
+  void evict();
   virtual void unload();
   virtual void apply();
 
+  /// @brief Largest side of currently loaded level, 0 if texture is not resident.
+  uint32_t getLevelSize() const;
+  /// @brief Whether texture has been loaded by any view of the current context group.
+  bool isResident() const;
+  /// @brief GPU memory occupied by currently loaded level including its mipmaps.
+  size_t getGpuBytes() const;
+  /// @brief Approximate GPU memory for texture loaded with given max_size.
+  /// @details Valid after first successful load, when format and sizes are known.
+  virtual size_t estimateBytes(uint32_t max_size) const;
+
+  /// @brief Decodes full image into RGBA texels on CPU side, caller owns the result.
+  /// @details Returns nullptr for packed 16-bits and compressed formats.
+  virtual uint8_t* decodeRGBA(uint32_t* width, uint32_t* height);
+  /// @brief Whether decodeRGBA() supports format of texture, known after first load.
+  virtual bool canDecodeRGBA() const;
+
 protected:
   virtual const uint8_t* loadImage() = 0;
 
+  static uint32_t bytesPerTexel(GLint format, GLint type);
+
+  /// @brief Maps the whole source file into memory without decoding.
+  /// @details Files are mmap'ed, assets are accessed through their own memory
+  /// buffer, embedded data is taken as is. Returned pointer is valid until unmapSource().
+  const uint8_t* mapSource(size_t* size);
+  void unmapSource();
+
   enum class ReadMode : int {
     ASSETS = 0, FILESYSTEM = 1, MEMORY_TEXELS = 2
   };
@@ -142,14 +210,47 @@ protected:
   ReadMode m_read_mode;
   AssetStorage* m_assets;
   char* m_filename;
+  std::string m_name;
   const aiTexel* m_data;
   unsigned int m_data_size;
-  GLuint m_id;
+  std::atomic<GLuint> m_id;  // drawn by views of the group, while other ones load or evict it
   GLint m_format;
   GLint m_type;
   uint32_t m_width;
   uint32_t m_height;
+  std::atomic<uint32_t> m_level_size;
+  std::atomic<size_t> m_gpu_bytes;
+  std::atomic<uint32_t> m_generation;  // of context, where texture has been created
   int m_error_code;
+  bool m_staging;  // load() goes to staged level
+  /// @brief Serializes decoding, loading and eviction among views of context group.
+  std::recursive_mutex m_mutex;
+
+  /// @brief Accounts uploaded GL object as drawn or staged level.
+  void setLevel(GLuint id, uint32_t level_size, size_t bytes);
+
+private:
+  bool upload(const uint8_t* image, uint32_t width, uint32_t height, GLint format);
+
+  /// @brief Reduces image by halving until it fits max_size, takes ownership of image.
+  static uint8_t* downsample(uint8_t* image, uint32_t* width, uint32_t* height, uint32_t channels, uint32_t max_size);
+
+  uint8_t* m_placeholder;
+  uint32_t m_placeholder_width;
+  uint32_t m_placeholder_height;
+  GLint m_placeholder_format;
+  uint8_t* m_decoded;  // image decoded ahead of load()
+  uint32_t m_decoded_width;
+  uint32_t m_decoded_height;
+  uint32_t m_decoded_max_size;
+  GLuint m_staged_id;
+  uint32_t m_staged_generation;
+  uint32_t m_staged_level_size;
+  size_t m_staged_bytes;
+  std::atomic_bool m_stage_reserved;
+  void* m_source;
+  size_t m_source_size;
+  uint8_t* m_source_copy;
 };
 
 // ----------------------------------------------------------------------------
@@ -244,14 +345,165 @@ public:
 
 protected:
   const uint8_t* loadImage() override final;
+};
+
+/**
+ * Error codes (TGA):
+ *
+ * 102601 - mapSource() failed
+ * 102602 - header is truncated
+ * 102603 - image type is not supported (only 2, 3, 10, 11 are)
+ * 102604 - pixel depth is not supported (only 8, 24, 32 bits are)
+ * 102605 - image_buffer allocation failed
+ * 102606 - image data is truncated
+ * 102607 - RLE packet runs out of image bounds
+ */
+
+// ----------------------------------------------------------------------------
+/// @brief Base class for containers of pre-compressed texture data.
+/// @details Payload is never decoded nor copied: each stored mip level is passed
+/// directly from mapped source to glCompressedTexImage2D().
+class CompressedTexture : public Texture {
+public:
+  CompressedTexture(AssetStorage* assets, const char* filename);
+  CompressedTexture(const char* filepath);
+  CompressedTexture(const aiTexel* data, unsigned int size);
+  virtual ~CompressedTexture();
+
+  using Texture::load;
+  /// @brief Loads mip chain starting from the first stored level not exceeding max_size.
+  bool load(uint32_t max_size) override;
+  /// @brief Nothing to decode ahead, levels are mapped during load().
+  bool decode(uint32_t max_size) override;
+  size_t estimateBytes(uint32_t max_size) const override;
+  uint8_t* decodeRGBA(uint32_t* width, uint32_t* height) override;
+  bool canDecodeRGBA() const override;
+
+  static bool isFormatSupported(GLenum internal_format);
+
+protected:
+  struct Level {
+    const uint8_t* data;
+    GLsizei size;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  /// @brief Computes size of compressed image for formats of 4x4 texels blocks.
+  static GLsizei blockImageSize(GLenum internal_format, uint32_t width, uint32_t height);
+
+  std::vector<Level> m_levels;
+};
+
+// ----------------------------------------------------------------------------
+class KTXTexture : public CompressedTexture {
+public:
+  KTXTexture(AssetStorage* assets, const char* filename);
+  KTXTexture(const char* filepath);
+  KTXTexture(const aiTexel* data, unsigned int size);
+  virtual ~KTXTexture();
+
+protected:
+  const uint8_t* loadImage() override final;
+
+private:
+  int parseKTX1(const uint8_t* data, size_t size);
+  int parseKTX2(const uint8_t* data, size_t size);
+};
+
+/**
+ * Error codes (KTX, KTX2):
+ *
+ * 102901 - mapSource() failed
+ * 102902 - header is truncated or identifier is wrong
+ * 102903 - wrong endianness field (KTX)
+ * 102904 - not a compressed texture (KTX glType != 0)
+ * 102905 - cubemaps, arrays and 3D textures are not supported
+ * 102906 - supercompression is not supported (KTX2)
+ * 102907 - unknown internal format
+ * 102908 - internal format is not supported by device
+ * 102909 - mip level data is truncated
+ */
+
+// ----------------------------------------------------------------------------
+class DDSTexture : public CompressedTexture {
+public:
+  DDSTexture(AssetStorage* assets, const char* filename);
+  DDSTexture(const char* filepath);
+  DDSTexture(const aiTexel* data, unsigned int size);
+  virtual ~DDSTexture();
+
+protected:
+  const uint8_t* loadImage() override final;
+};
+
+/**
+ * Error codes (DDS):
+ *
+ * 100301 - mapSource() failed
+ * 100302 - header is truncated or magic is wrong
+ * 100303 - pixel format is not FourCC compressed (DX10 header is not supported either)
+ * 100304 - cubemaps and volume textures are not supported
+ * 100305 - unknown FourCC
+ * 100306 - internal format is not supported by device
+ * 100307 - mip level data is truncated
+ */
+
+// ----------------------------------------------------------------------------
+class PKMTexture : public CompressedTexture {
+public:
+  PKMTexture(AssetStorage* assets, const char* filename);
+  PKMTexture(const char* filepath);
+  PKMTexture(const aiTexel* data, unsigned int size);
+  virtual ~PKMTexture();
+
+protected:
+  const uint8_t* loadImage() override final;
+};
+
+/**
+ * Error codes (PKM):
+ *
+ * 103001 - mapSource() failed
+ * 103002 - header is truncated or magic is wrong
+ * 103003 - not an ETC1 file (ETC2 is not supported by OpenGL ES 1.x)
+ * 103004 - ETC1 is not supported by device
+ * 103005 - image data is truncated
+ */
+
+// ----------------------------------------------------------------------------
+/// @brief Texture composed of several small textures at import time.
+/// @details Tiles are placed by skyline bottom-left packing. Each tile is surrounded
+/// by gutter of replicated edge texels and aligned to gutter size, so neighbouring
+/// tiles do not bleed into each other in the first mip levels.
+class AtlasTexture : public Texture {
+public:
+  AtlasTexture(uint32_t size);
+  virtual ~AtlasTexture();
+
+  constexpr static const uint32_t gutter = 4;
+
+  /// @brief Places RGBA texels of decoded texture into atlas.
+  /// @param transform - scale and offset of tile: u' = u * t[0] + t[2], v' = v * t[1] + t[3].
+  /// @return false, if there is no space left.
+  bool add(const uint8_t* tile, uint32_t width, uint32_t height, GLfloat* transform);
+  uint32_t getTotalTiles() const;
+
+protected:
+  const uint8_t* loadImage() override final;
+
+private:
+  struct SkylineNode {
+    uint32_t x, y, width;
+  };
+
+  bool findPosition(uint32_t width, uint32_t height, uint32_t* x, uint32_t* y) const;
+  void addSkylineLevel(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 
-  typedef struct {
-    unsigned char imageTypeCode;
-    short int imageWidth;
-    short int imageHeight;
-    unsigned char bitCount;
-    unsigned char *imageData;
-  } TGAFile;
+  uint32_t m_size;
+  uint8_t* m_image;
+  uint32_t m_total_tiles;
+  std::vector<SkylineNode> m_skyline;
 };
 
 }  // namespace native
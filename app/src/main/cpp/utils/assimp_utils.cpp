@@ -26,6 +26,7 @@
  * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include "assimp_utils.h"
 
 
@@ -76,6 +77,14 @@ void getRawNormals(const aiVector3D* const normals, unsigned int total, float* b
   }
 }
 
+void getRawTransformNegativeXYZ(const aiMatrix4x4& transform, float* buffer) {
+  // -(L * v + t) = L * (-v) - t: linear part is kept, translation is negated
+  buffer[0] = transform.a1;  buffer[4] = transform.a2;  buffer[8] = transform.a3;   buffer[12] = -transform.a4;
+  buffer[1] = transform.b1;  buffer[5] = transform.b2;  buffer[9] = transform.b3;   buffer[13] = -transform.b4;
+  buffer[2] = transform.c1;  buffer[6] = transform.c2;  buffer[10] = transform.c3;  buffer[14] = -transform.c4;
+  buffer[3] = 0.0f;          buffer[7] = 0.0f;          buffer[11] = 0.0f;          buffer[15] = 1.0f;
+}
+
 void getRawTriangles(const aiFace* const faces, unsigned int total, GLuint* buffer) {
   for (int i = 0; i < total; ++i) {
     buffer[i * 3 + 0] = faces[i].mIndices[0];
@@ -125,5 +134,38 @@ aiTextureType findTexture(const aiMaterial* material, aiString* tex_name) {
   return aiTextureType_NONE;
 }
 
+void getMaterial(const aiMaterial* material, Material* out) {
+  aiColor3D ambient(0.0f, 0.0f, 0.0f);
+  aiColor3D diffuse(1.0f, 1.0f, 1.0f);
+  aiColor3D specular(0.5f, 0.5f, 0.5f);
+  float opacity = 1.0f;
+  float shininess = 128.0f;
+  int shading = aiShadingMode_Phong;
+
+  material->Get(AI_MATKEY_COLOR_AMBIENT, ambient);
+  material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+  material->Get(AI_MATKEY_COLOR_SPECULAR, specular);
+  material->Get(AI_MATKEY_OPACITY, opacity);
+  material->Get(AI_MATKEY_SHININESS, shininess);
+  material->Get(AI_MATKEY_SHADING_MODEL, shading);
+
+  out->ambient = Vector3Df(ambient.r, ambient.g, ambient.b);
+  out->diffuse = Vector3Df(diffuse.r, diffuse.g, diffuse.b);
+  out->specular = Vector3Df(specular.r, specular.g, specular.b);
+  out->transparency = opacity;
+  out->shininess = std::min(std::max(shininess, 0.0f), 128.0f);  // OpenGL ES range
+  switch (shading) {  // back to 'illum' of MTL
+    case aiShadingMode_NoShading:
+      out->illumination = 0.0f;
+      break;
+    case aiShadingMode_Gouraud:
+      out->illumination = 1.0f;
+      break;
+    default:
+      out->illumination = 2.0f;
+      break;
+  }
+}
+
 }  // namespace assimp
 }  // namespace utils
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include "bvh.h"
+
+
+namespace utils {
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy() {
+}
+
+void BoundingVolumeHierarchy::build(const Vector3Df* mins, const Vector3Df* maxs, uint32_t total) {
+  clear();
+  if (total == 0) {
+    return;
+  }
+  m_items.resize(total);
+  for (uint32_t i = 0; i < total; ++i) {
+    m_items[i] = i;
+  }
+  m_nodes.reserve(total * 2);
+  buildNode(mins, maxs, 0, total);
+}
+
+void BoundingVolumeHierarchy::clear() {
+  m_nodes.clear();
+  m_items.clear();
+}
+
+void BoundingVolumeHierarchy::buildNode(const Vector3Df* mins, const Vector3Df* maxs, uint32_t first, uint32_t count) {
+  uint32_t index = m_nodes.size();
+  m_nodes.emplace_back();
+  Vector3Df min = mins[m_items[first]], max = maxs[m_items[first]];
+  for (uint32_t i = first + 1; i < first + count; ++i) {
+    for (int k = 0; k < 3; ++k) {
+      min[k] = std::min(min[k], mins[m_items[i]][k]);
+      max[k] = std::max(max[k], maxs[m_items[i]][k]);
+    }
+  }
+  m_nodes[index].min = min;
+  m_nodes[index].max = max;
+  if (count <= maxLeafItems) {
+    m_nodes[index].first = first;
+    m_nodes[index].count = count;
+    return;
+  }
+
+  // split by centers along the longest axis of node
+  int axis = 0;
+  for (int k = 1; k < 3; ++k) {
+    if (max[k] - min[k] > max[axis] - min[axis]) {
+      axis = k;
+    }
+  }
+  uint32_t half = count / 2;
+  std::nth_element(m_items.begin() + first, m_items.begin() + first + half, m_items.begin() + first + count,
+      [mins, maxs, axis](uint32_t lhs, uint32_t rhs) {
+        return mins[lhs][axis] + maxs[lhs][axis] < mins[rhs][axis] + maxs[rhs][axis];
+      });
+  buildNode(mins, maxs, first, half);
+  m_nodes[index].first = m_nodes.size();
+  m_nodes[index].count = 0;
+  buildNode(mins, maxs, first + half, count - half);
+}
+
+uint32_t BoundingVolumeHierarchy::cull(const GLfloat planes[6][4], std::vector<uint32_t>* visible) const {
+  visible->clear();
+  if (m_nodes.empty()) {
+    return 0;
+  }
+  uint32_t rejected = 0;
+  uint32_t stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    uint32_t index = stack[--top];
+    const Node& node = m_nodes[index];
+    Containment containment = boxInFrustum(planes, node.min, node.max);
+    if (containment == Containment::OUTSIDE) {
+      ++rejected;
+    } else if (containment == Containment::INSIDE || node.count > 0) {
+      collect(index, visible);
+    } else {
+      stack[top++] = node.first;
+      stack[top++] = index + 1;
+    }
+  }
+  return rejected;
+}
+
+void BoundingVolumeHierarchy::collect(uint32_t node, std::vector<uint32_t>* visible) const {
+  // subtree occupies consecutive nodes up to the end of its last right child
+  uint32_t last = node;
+  while (m_nodes[last].count == 0) {
+    last = m_nodes[last].first;
+  }
+  for (uint32_t i = node; i <= last; ++i) {
+    if (m_nodes[i].count > 0) {
+      visible->insert(visible->end(), m_items.begin() + m_nodes[i].first, m_items.begin() + m_nodes[i].first + m_nodes[i].count);
+    }
+  }
+}
+
+const Vector3Df& BoundingVolumeHierarchy::getMin() const {
+  return m_nodes[0].min;
+}
+
+const Vector3Df& BoundingVolumeHierarchy::getMax() const {
+  return m_nodes[0].max;
+}
+
+}
@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include "gesture.h"
+
+
+namespace gesture {
+
+Tracker::Tracker()
+  : m_mode(Mode::NONE)
+  , m_clock(0.0f)
+  , m_last_move(0.0f)
+  , m_last_release(-dragTapInterval - 1.0f)
+  , m_x(0.0f), m_y(0.0f)
+  , m_spacing(0.0f)
+  , m_velocity_x(0.0f), m_velocity_y(0.0f)
+  , m_coasting(false)
+  , m_coast_mode(Mode::NONE) {
+}
+
+void Tracker::touch(const Touch& sample, GLfloat width, GLfloat height, Motion* motion) {
+  m_clock += sample.dt;
+  switch (sample.action) {
+    case Touch::Action::DOWN:
+      m_coasting = false;  // touch catches coasting view
+      m_mode = m_clock - m_last_release <= dragTapInterval ? Mode::DRAG : Mode::ROTATE;
+      m_x = sample.x0;
+      m_y = sample.y0;
+      m_velocity_x = 0.0f;
+      m_velocity_y = 0.0f;
+      m_last_move = m_clock;
+      break;
+    case Touch::Action::POINTER_DOWN:
+      if (sample.pointers >= 2) {
+        m_mode = Mode::ZOOM;
+        m_spacing = std::hypot(sample.x1 - sample.x0, sample.y1 - sample.y0);
+      }
+      break;
+    case Touch::Action::MOVE:
+      if (m_mode == Mode::NONE) {  // release or touch has been lost, moves start over
+        m_mode = Mode::ROTATE;
+        m_x = sample.x0;
+        m_y = sample.y0;
+        m_velocity_x = 0.0f;
+        m_velocity_y = 0.0f;
+      } else if (m_mode == Mode::ZOOM) {
+        if (sample.pointers < 2) {
+          break;
+        }
+        GLfloat spacing = std::hypot(sample.x1 - sample.x0, sample.y1 - sample.y0);
+        if (spacing > minPinchSpacing && m_spacing > minPinchSpacing) {
+          motion->zoom *= spacing / m_spacing;
+        }
+        m_spacing = spacing;
+      } else {
+        GLfloat dx = sample.x0 - m_x, dy = sample.y0 - m_y;
+        move(m_mode, dx, dy, width, height, motion);
+        if (sample.dt > 0.0f) {
+          GLfloat alpha = 1.0f - std::exp(-sample.dt / velocitySmoothing);
+          m_velocity_x += alpha * (dx / sample.dt - m_velocity_x);
+          m_velocity_y += alpha * (dy / sample.dt - m_velocity_y);
+        }
+        m_x = sample.x0;
+        m_y = sample.y0;
+        m_last_move = m_clock;
+      }
+      break;
+    case Touch::Action::POINTER_UP:
+      m_mode = Mode::NONE;  // remaining pointer starts rotating from its next move
+      break;
+    case Touch::Action::UP:
+      if ((m_mode == Mode::ROTATE || m_mode == Mode::DRAG) && m_clock - m_last_move <= releaseTimeout &&
+          std::hypot(m_velocity_x, m_velocity_y) >= minCoastSpeed) {
+        m_coasting = true;
+        m_coast_mode = m_mode;
+      }
+      m_mode = Mode::NONE;
+      m_last_release = m_clock;
+      break;
+    case Touch::Action::CANCEL:
+      m_mode = Mode::NONE;
+      break;
+  }
+}
+
+bool Tracker::coast(GLfloat elapsed, GLfloat width, GLfloat height, Motion* motion) {
+  if (!m_coasting) {
+    return false;
+  }
+  // exact integral of exponentially decaying velocity over elapsed time
+  GLfloat decay = std::exp(-elapsed / inertiaDecay);
+  GLfloat distance = inertiaDecay * (1.0f - decay);
+  move(m_coast_mode, m_velocity_x * distance, m_velocity_y * distance, width, height, motion);
+  m_velocity_x *= decay;
+  m_velocity_y *= decay;
+  m_coasting = std::hypot(m_velocity_x, m_velocity_y) >= minCoastSpeed;
+  return m_coasting;
+}
+
+void Tracker::stop() {
+  m_mode = Mode::NONE;
+  m_coasting = false;
+  m_velocity_x = 0.0f;
+  m_velocity_y = 0.0f;
+}
+
+void Tracker::move(Mode mode, GLfloat dx, GLfloat dy, GLfloat width, GLfloat height, Motion* motion) {
+  if (mode == Mode::DRAG) {
+    motion->translation_x += dx * translationPerPixel;
+    motion->translation_y -= dy * translationPerPixel;
+  } else if (width > 0.0f && height > 0.0f) {
+    // vertical motion turns around X axis of scene, horizontal one around Y axis
+    motion->angle_x += rotationPerScreen * dy / height;
+    motion->angle_y += rotationPerScreen * dx / width;
+  }
+}
+
+}  // namespace gesture
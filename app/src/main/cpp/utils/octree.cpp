@@ -0,0 +1,325 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <string>
+#include <unistd.h>
+#include "logger.h"
+#include "octree.h"
+
+
+namespace utils {
+
+PointOctree::PointOctree()
+  : m_cache(nullptr)
+  , m_cache_path(nullptr)
+  , m_total_points(0)
+  , m_resident_bytes(0)
+  , m_frame(0) {
+}
+
+PointOctree::~PointOctree() {
+  for (Node& node : m_nodes) {
+    delete [] node.points;  node.points = nullptr;
+  }
+  if (m_cache != nullptr) {
+    std::fclose(m_cache);
+    m_cache = nullptr;
+    std::remove(m_cache_path);
+  }
+  delete [] m_cache_path;  m_cache_path = nullptr;
+}
+
+void PointOctree::addPoints(const GLfloat* vertices, uint32_t stride, const GLfloat* colors, uint32_t total) {
+  m_build_points.reserve(m_build_points.size() + total);
+  for (uint32_t i = 0; i < total; ++i) {
+    Point point;
+    std::copy(&vertices[i * stride], &vertices[i * stride + 3], point.position);
+    for (int k = 0; k < 4; ++k) {
+      GLfloat component = colors != nullptr ? colors[i * 4 + k] : 1.0f;
+      point.color[k] = static_cast<GLubyte>(std::min(std::max(component, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+    m_build_points.push_back(point);
+  }
+}
+
+bool PointOctree::build(const char* cache_directory) {
+  m_total_points = m_build_points.size();
+  if (m_total_points == 0) {
+    return false;
+  }
+  if (cache_directory != nullptr) {
+    // unique per octree, several views could stream their clouds at once
+    std::string cache_path = std::string(cache_directory) + "/surface3D_points.XXXXXX";
+    m_cache_path = new char[cache_path.size() + 1];
+    strcpy(m_cache_path, cache_path.c_str());
+    int descriptor = mkstemp(m_cache_path);
+    m_cache = descriptor >= 0 ? fdopen(descriptor, "w+b") : nullptr;
+    if (m_cache == nullptr) {
+      WRN("Point cache in %s could not be opened, all points are kept in memory", cache_directory);
+      if (descriptor >= 0) {
+        close(descriptor);
+        std::remove(m_cache_path);
+      }
+      delete [] m_cache_path;  m_cache_path = nullptr;
+    }
+  }
+
+  // shuffled order makes the first point in each cell a random sample of it
+  uint32_t total = m_total_points;
+  const uint32_t primes[] = {2654435761u, 2246822519u, 3266489917u, 668265263u};
+  auto gcd = [](uint32_t a, uint32_t b) {
+    while (b != 0) {
+      uint32_t t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  };
+  uint32_t step = 1;
+  for (uint32_t prime : primes) {
+    if (prime % total > 1 && gcd(prime % total, total) == 1) {  // visits every point once
+      step = prime % total;
+      break;
+    }
+  }
+  if (step > 1) {
+    std::vector<Point> shuffled(total);
+    uint64_t index = 0;
+    for (uint32_t i = 0; i < total; ++i) {
+      shuffled[i] = m_build_points[index];
+      index = (index + step) % total;
+    }
+    m_build_points.swap(shuffled);
+  }
+
+  GLfloat min[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (const Point& point : m_build_points) {
+    for (int k = 0; k < 3; ++k) {
+      min[k] = std::min(min[k], point.position[k]);
+      max[k] = std::max(max[k], point.position[k]);
+    }
+  }
+  GLfloat size = std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2])) * 1.0001f;
+  size = std::max(size, 1e-6f);
+  buildNode(0, total, min, size, 0);
+  std::vector<Point>().swap(m_build_points);
+  if (m_cache != nullptr) {
+    std::fflush(m_cache);
+  }
+  INF("Point octree: %zu points in %zu nodes, %s", m_total_points, m_nodes.size(), m_cache != nullptr ? "streamed from cache" : "in memory");
+  return true;
+}
+
+uint32_t PointOctree::buildNode(uint32_t first, uint32_t count, const GLfloat* min, GLfloat size, int depth) {
+  uint32_t index = m_nodes.size();
+  Node node;
+  std::copy(min, min + 3, node.min);
+  node.size = size;
+  std::fill(node.children, node.children + 8, -1);
+  node.total_points = 0;
+  node.offset = 0;
+  node.points = nullptr;
+  node.last_used = 0;
+  node.failed = false;
+  m_nodes.push_back(node);
+
+  Point* points = &m_build_points[first];
+  if (count <= maxLeafPoints || depth >= maxDepth) {
+    storeNode(index, points, count);
+    return index;
+  }
+
+  // first point of each occupied cell stays in this node, stable sort keeps the shuffled order within cells
+  std::vector<uint64_t> keys(count);
+  GLfloat factor = gridResolution / size;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t cell = 0;
+    for (int k = 0; k < 3; ++k) {
+      uint32_t c = static_cast<uint32_t>((points[i].position[k] - min[k]) * factor);
+      cell = cell * gridResolution + std::min(c, gridResolution - 1);
+    }
+    keys[i] = cell << 32 | i;
+  }
+  std::sort(keys.begin(), keys.end());
+  std::vector<Point> sampled, rest[8];
+  for (uint32_t i = 0; i < count; ++i) {
+    const Point& point = points[keys[i] & 0xFFFFFFFF];
+    if (i == 0 || (keys[i] >> 32) != (keys[i - 1] >> 32)) {
+      sampled.push_back(point);
+      continue;
+    }
+    int octant = 0;
+    for (int k = 0; k < 3; ++k) {
+      if (point.position[k] >= min[k] + size * 0.5f) {
+        octant |= 1 << k;
+      }
+    }
+    rest[octant].push_back(point);
+  }
+  std::vector<uint64_t>().swap(keys);
+  storeNode(index, &sampled[0], sampled.size());
+  std::vector<Point>().swap(sampled);
+
+  // children reuse the range of this node, which points are already stored
+  uint32_t offset = first;
+  uint32_t ranges[8][2];
+  for (int octant = 0; octant < 8; ++octant) {
+    std::copy(rest[octant].begin(), rest[octant].end(), m_build_points.begin() + offset);
+    ranges[octant][0] = offset;
+    ranges[octant][1] = rest[octant].size();
+    offset += rest[octant].size();
+    std::vector<Point>().swap(rest[octant]);
+  }
+  for (int octant = 0; octant < 8; ++octant) {
+    if (ranges[octant][1] == 0) {
+      continue;
+    }
+    GLfloat child_min[3];
+    for (int k = 0; k < 3; ++k) {
+      child_min[k] = min[k] + ((octant >> k) & 1) * size * 0.5f;
+    }
+    int32_t child = buildNode(ranges[octant][0], ranges[octant][1], child_min, size * 0.5f, depth + 1);
+    m_nodes[index].children[octant] = child;
+  }
+  return index;
+}
+
+void PointOctree::storeNode(uint32_t node, const Point* points, uint32_t count) {
+  m_nodes[node].total_points = count;
+  if (m_cache != nullptr) {
+    m_nodes[node].offset = std::ftell(m_cache);
+    if (std::fwrite(points, sizeof(Point), count, m_cache) == count) {
+      return;
+    }
+    WRN("Point cache write has failed, node %u is kept in memory", node);
+  }
+  m_nodes[node].points = new Point[count];
+  std::copy(points, points + count, m_nodes[node].points);
+  m_resident_bytes += count * sizeof(Point);
+}
+
+void PointOctree::select(const GLfloat planes[6][4], const Matrix4f& modelview, GLfloat pixels_per_unit, GLfloat z_near,
+                         uint32_t point_budget, std::vector<uint32_t>* selected, std::vector<uint32_t>* missing) {
+  selected->clear();
+  missing->clear();
+  if (m_nodes.empty()) {
+    return;
+  }
+  ++m_frame;
+  GLfloat scale = modelview.maxScale();
+  auto projectedSize = [this, &modelview, scale, pixels_per_unit, z_near](uint32_t index) {
+    const Node& node = m_nodes[index];
+    GLfloat half = node.size * 0.5f;
+    Vector3Df center = modelview.transformPoint(Vector3Df(node.min[0] + half, node.min[1] + half, node.min[2] + half));
+    GLfloat radius = half * 1.7320508f * scale;
+    GLfloat depth = std::max(-center[2] - radius, z_near);
+    return 2.0f * radius * pixels_per_unit / depth;
+  };
+
+  std::priority_queue<std::pair<GLfloat, uint32_t>> queue;
+  queue.emplace(projectedSize(0), 0);
+  uint32_t total_points = 0;
+  while (!queue.empty()) {
+    GLfloat size = queue.top().first;
+    uint32_t index = queue.top().second;
+    queue.pop();
+    Node& node = m_nodes[index];
+    Vector3Df min(node.min[0], node.min[1], node.min[2]);
+    Vector3Df max(node.min[0] + node.size, node.min[1] + node.size, node.min[2] + node.size);
+    if (node.failed || boxInFrustum(planes, min, max) == Containment::OUTSIDE) {
+      continue;
+    }
+    if (total_points + node.total_points > point_budget) {
+      break;
+    }
+    node.last_used = m_frame;
+    if (node.points == nullptr) {
+      missing->push_back(index);
+      continue;
+    }
+    selected->push_back(index);
+    total_points += node.total_points;
+    if (size / gridResolution < 1.0f) {
+      continue;  // cells of this node are smaller than a pixel already
+    }
+    for (int32_t child : node.children) {
+      if (child >= 0) {
+        queue.emplace(projectedSize(child), child);
+      }
+    }
+  }
+}
+
+size_t PointOctree::load(uint32_t index) {
+  Node& node = m_nodes[index];
+  if (node.points != nullptr) {
+    return 0;
+  }
+  if (m_cache == nullptr || std::fseek(m_cache, node.offset, SEEK_SET) != 0) {
+    node.failed = true;
+    return 0;
+  }
+  node.points = new Point[node.total_points];
+  if (std::fread(node.points, sizeof(Point), node.total_points, m_cache) != node.total_points) {
+    ERR("Point cache read has failed, node %u is not drawn anymore", index);
+    delete [] node.points;  node.points = nullptr;
+    node.failed = true;
+    return 0;
+  }
+  size_t bytes = node.total_points * sizeof(Point);
+  m_resident_bytes += bytes;
+  return bytes;
+}
+
+void PointOctree::evict(size_t max_bytes) {
+  if (m_resident_bytes <= max_bytes || m_cache == nullptr) {
+    return;  // nothing to reload from otherwise
+  }
+  std::vector<uint32_t> resident;
+  for (uint32_t i = 0; i < m_nodes.size(); ++i) {
+    if (m_nodes[i].points != nullptr && m_nodes[i].last_used < m_frame) {
+      resident.push_back(i);
+    }
+  }
+  std::sort(resident.begin(), resident.end(),
+      [this](uint32_t lhs, uint32_t rhs) { return m_nodes[lhs].last_used < m_nodes[rhs].last_used; });
+  for (uint32_t i : resident) {
+    if (m_resident_bytes <= max_bytes) {
+      break;
+    }
+    delete [] m_nodes[i].points;  m_nodes[i].points = nullptr;
+    m_resident_bytes -= m_nodes[i].total_points * sizeof(Point);
+  }
+}
+
+}
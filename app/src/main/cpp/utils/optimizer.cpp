@@ -0,0 +1,279 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "optimizer.h"
+
+
+namespace utils {
+namespace optimizer {
+
+static uint32_t simulateCache(const GLuint* indices, uint32_t total_indices, uint32_t total_vertices, uint32_t cache_size) {
+  // vertex is in FIFO cache while less than cache_size misses happened after it has been loaded
+  std::vector<uint32_t> loaded_at(total_vertices, 0);
+  uint32_t misses = 0;
+  for (uint32_t i = 0; i < total_indices; ++i) {
+    GLuint vertex = indices[i];
+    if (loaded_at[vertex] == 0 || misses - loaded_at[vertex] >= cache_size) {
+      ++misses;
+      loaded_at[vertex] = misses;
+    }
+  }
+  return misses;
+}
+
+GLfloat computeACMR(const GLuint* indices, uint32_t total_indices, uint32_t total_vertices, uint32_t cache_size) {
+  if (total_indices < 3) {
+    return 0.0f;
+  }
+  return static_cast<GLfloat>(simulateCache(indices, total_indices, total_vertices, cache_size)) / (total_indices / 3);
+}
+
+GLfloat computeATVR(const GLuint* indices, uint32_t total_indices, uint32_t total_vertices, uint32_t cache_size) {
+  std::vector<bool> used(total_vertices, false);
+  uint32_t total_used = 0;
+  for (uint32_t i = 0; i < total_indices; ++i) {
+    if (!used[indices[i]]) {
+      used[indices[i]] = true;
+      ++total_used;
+    }
+  }
+  if (total_used == 0) {
+    return 0.0f;
+  }
+  return static_cast<GLfloat>(simulateCache(indices, total_indices, total_vertices, cache_size)) / total_used;
+}
+
+/* Tipsify: Sander P., Nehab D., Barczak J. Fast Triangle Reordering for Vertex Locality and Reduced Overdraw */
+// ----------------------------------------------------------------------------
+void optimizeVertexCache(GLuint* indices, uint32_t total_indices, uint32_t total_vertices,
+                         uint32_t cache_size, std::vector<uint32_t>* clusters) {
+  uint32_t total_triangles = total_indices / 3;
+  if (total_triangles == 0 || total_vertices == 0) {
+    return;
+  }
+
+  // vertex-triangle adjacency in compressed form
+  std::vector<uint32_t> offsets(total_vertices + 1, 0);
+  for (uint32_t i = 0; i < total_triangles * 3; ++i) {
+    ++offsets[indices[i] + 1];
+  }
+  for (uint32_t v = 0; v < total_vertices; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<uint32_t> live(total_vertices);  // not yet emitted triangles per vertex
+  for (uint32_t v = 0; v < total_vertices; ++v) {
+    live[v] = offsets[v + 1] - offsets[v];
+  }
+  std::vector<uint32_t> adjacency(total_triangles * 3);
+  {
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (uint32_t t = 0; t < total_triangles; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        adjacency[cursor[indices[t * 3 + k]]++] = t;
+      }
+    }
+  }
+
+  std::vector<uint32_t> cache_time(total_vertices, 0);
+  std::vector<bool> emitted(total_triangles, false);
+  std::vector<uint32_t> dead_end;  // recently referenced vertices
+  std::vector<uint32_t> candidates;
+  std::vector<GLuint> output;
+  output.reserve(total_triangles * 3);
+  if (clusters != nullptr) {
+    clusters->clear();
+    clusters->push_back(0);
+  }
+
+  uint32_t timestamp = cache_size + 1;
+  uint32_t scan = 0;  // next vertex to look at, when there are no other options
+  int64_t fanning = 0;
+  while (fanning >= 0) {
+    candidates.clear();
+    for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+      uint32_t t = adjacency[a];
+      if (emitted[t]) {
+        continue;
+      }
+      for (int k = 0; k < 3; ++k) {
+        GLuint v = indices[t * 3 + k];
+        output.push_back(v);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (timestamp - cache_time[v] > cache_size) {
+          cache_time[v] = timestamp++;
+        }
+      }
+      emitted[t] = true;
+    }
+
+    // next fanning vertex: the oldest candidate, which would still be in cache after its fan is emitted
+    int64_t next = -1;
+    uint32_t best_priority = 0;
+    for (uint32_t v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      uint32_t priority = 0;
+      if (timestamp - cache_time[v] + 2 * live[v] <= cache_size) {
+        priority = timestamp - cache_time[v];
+      }
+      if (next < 0 || priority > best_priority) {
+        best_priority = priority;
+        next = v;
+      }
+    }
+    if (next < 0) {
+      // dead end: fall back to recently referenced vertices, then to the input order
+      while (!dead_end.empty() && next < 0) {
+        uint32_t v = dead_end.back();
+        dead_end.pop_back();
+        if (live[v] > 0) {
+          next = v;
+        }
+      }
+      while (next < 0 && scan < total_vertices) {
+        if (live[scan] > 0) {
+          next = scan;
+        }
+        ++scan;
+      }
+      if (next >= 0 && clusters != nullptr) {
+        clusters->push_back(output.size() / 3);
+      }
+    }
+    fanning = next;
+  }
+  std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(GLuint* indices, uint32_t total_indices, const GLfloat* vertices, uint32_t stride,
+                      const std::vector<uint32_t>& clusters) {
+  uint32_t total_triangles = total_indices / 3;
+  uint32_t total_clusters = clusters.size();
+  if (total_clusters < 2) {
+    return;
+  }
+
+  struct Cluster {
+    uint32_t begin, end;
+    GLfloat centroid[3];
+    GLfloat normal[3];
+    GLfloat sort_key;
+  };
+  std::vector<Cluster> items(total_clusters);
+  GLfloat mesh_centroid[3] = {0.0f, 0.0f, 0.0f};
+  GLfloat mesh_area = 0.0f;
+  for (uint32_t c = 0; c < total_clusters; ++c) {
+    Cluster& cluster = items[c];
+    cluster.begin = clusters[c];
+    cluster.end = c + 1 < total_clusters ? clusters[c + 1] : total_triangles;
+    GLfloat area = 0.0f;
+    std::memset(cluster.centroid, 0, sizeof(cluster.centroid));
+    std::memset(cluster.normal, 0, sizeof(cluster.normal));
+    for (uint32_t t = cluster.begin; t < cluster.end; ++t) {
+      const GLfloat* p0 = &vertices[indices[t * 3 + 0] * stride];
+      const GLfloat* p1 = &vertices[indices[t * 3 + 1] * stride];
+      const GLfloat* p2 = &vertices[indices[t * 3 + 2] * stride];
+      GLfloat e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      GLfloat e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      GLfloat n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      GLfloat double_area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int k = 0; k < 3; ++k) {
+        cluster.centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * double_area;
+        cluster.normal[k] += n[k];  // area weighted already
+      }
+      area += double_area;
+    }
+    for (int k = 0; k < 3; ++k) {
+      mesh_centroid[k] += cluster.centroid[k];
+      cluster.centroid[k] = area > 0.0f ? cluster.centroid[k] / area : 0.0f;
+    }
+    mesh_area += area;
+  }
+  for (int k = 0; k < 3; ++k) {
+    mesh_centroid[k] = mesh_area > 0.0f ? mesh_centroid[k] / mesh_area : 0.0f;
+  }
+
+  // clusters far out along their own normal occlude the inner ones
+  GLfloat orientation = 0.0f;
+  for (Cluster& cluster : items) {
+    cluster.sort_key = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+      cluster.sort_key += (cluster.centroid[k] - mesh_centroid[k]) * cluster.normal[k];
+    }
+    orientation += cluster.sort_key;
+  }
+  if (orientation < 0.0f) {  // winding is clockwise for outer side, e.g. after mirroring
+    for (Cluster& cluster : items) {
+      cluster.sort_key = -cluster.sort_key;
+    }
+  }
+  std::stable_sort(items.begin(), items.end(), [](const Cluster& lhs, const Cluster& rhs) { return lhs.sort_key > rhs.sort_key; });
+
+  std::vector<GLuint> output;
+  output.reserve(total_triangles * 3);
+  for (const Cluster& cluster : items) {
+    output.insert(output.end(), &indices[cluster.begin * 3], &indices[cluster.end * 3]);
+  }
+  std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeVertexFetch(GLuint* indices, uint32_t total_indices, uint32_t total_vertices, GLuint* remap) {
+  const GLuint unused = static_cast<GLuint>(-1);
+  std::fill(remap, remap + total_vertices, unused);
+  GLuint next = 0;
+  for (uint32_t i = 0; i < total_indices; ++i) {
+    GLuint& target = remap[indices[i]];
+    if (target == unused) {
+      target = next++;
+    }
+    indices[i] = target;
+  }
+  for (uint32_t v = 0; v < total_vertices; ++v) {
+    if (remap[v] == unused) {
+      remap[v] = next++;
+    }
+  }
+}
+
+void remapBuffer(GLfloat* buffer, uint32_t components, const GLuint* remap, uint32_t total_vertices) {
+  GLfloat* backup = new GLfloat[total_vertices * components];
+  std::memcpy(backup, buffer, total_vertices * components * sizeof(GLfloat));
+  for (uint32_t v = 0; v < total_vertices; ++v) {
+    std::memcpy(&buffer[remap[v] * components], &backup[v * components], components * sizeof(GLfloat));
+  }
+  delete [] backup;  backup = nullptr;
+}
+
+}  // namespace optimizer
+}  // namespace utils
@@ -0,0 +1,273 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "raycast.h"
+
+
+namespace utils {
+
+// per triangle in build bounds: min[3], max[3]
+constexpr static const int boundsStride = 6;
+
+TriangleHierarchy::TriangleHierarchy()
+  : m_vertices(nullptr)
+  , m_stride(0)
+  , m_indices(nullptr) {
+}
+
+inline const GLfloat* TriangleHierarchy::vertex(uint32_t triangle, int corner) const {
+  uint32_t index = m_indices != nullptr ? m_indices[triangle * 3 + corner] : triangle * 3 + corner;
+  return &m_vertices[index * m_stride];
+}
+
+void TriangleHierarchy::build(const GLfloat* vertices, uint32_t stride, const GLushort* indices, uint32_t total_triangles) {
+  m_vertices = vertices;
+  m_stride = stride;
+  m_indices = indices;
+  m_nodes.clear();
+  m_triangles.resize(total_triangles);
+  if (total_triangles == 0) {
+    return;
+  }
+  std::vector<GLfloat> bounds(total_triangles * boundsStride);
+  for (uint32_t t = 0; t < total_triangles; ++t) {
+    GLfloat* box = &bounds[t * boundsStride];
+    const GLfloat* p0 = vertex(t, 0);
+    const GLfloat* p1 = vertex(t, 1);
+    const GLfloat* p2 = vertex(t, 2);
+    for (int k = 0; k < 3; ++k) {
+      box[k] = std::min(p0[k], std::min(p1[k], p2[k]));
+      box[3 + k] = std::max(p0[k], std::max(p1[k], p2[k]));
+    }
+    m_triangles[t] = t;
+  }
+  m_nodes.reserve(total_triangles / 2 + 1);
+  buildNode(bounds, 0, total_triangles, 0);
+}
+
+static GLfloat halfArea(const GLfloat* min, const GLfloat* max) {
+  GLfloat dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+static void grow(GLfloat* min, GLfloat* max, const GLfloat* box) {
+  for (int k = 0; k < 3; ++k) {
+    min[k] = std::min(min[k], box[k]);
+    max[k] = std::max(max[k], box[3 + k]);
+  }
+}
+
+void TriangleHierarchy::buildNode(const std::vector<GLfloat>& bounds, uint32_t first, uint32_t count, int depth) {
+  uint32_t index = m_nodes.size();
+  m_nodes.emplace_back();
+  Node node;
+  GLfloat centroid_min[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, centroid_max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  std::fill(node.min, node.min + 3, FLT_MAX);
+  std::fill(node.max, node.max + 3, -FLT_MAX);
+  for (uint32_t i = first; i < first + count; ++i) {
+    const GLfloat* box = &bounds[m_triangles[i] * boundsStride];
+    grow(node.min, node.max, box);
+    for (int k = 0; k < 3; ++k) {
+      GLfloat centroid = box[k] + box[3 + k];
+      centroid_min[k] = std::min(centroid_min[k], centroid);
+      centroid_max[k] = std::max(centroid_max[k], centroid);
+    }
+  }
+  node.first = first;
+  node.count = count;
+  m_nodes[index] = node;
+  if (count <= maxLeafTriangles || depth >= maxDepth) {
+    return;
+  }
+
+  // binned SAH along the longest axis of centroids
+  int axis = 0;
+  for (int k = 1; k < 3; ++k) {
+    if (centroid_max[k] - centroid_min[k] > centroid_max[axis] - centroid_min[axis]) {
+      axis = k;
+    }
+  }
+  GLfloat extent = centroid_max[axis] - centroid_min[axis];
+  uint32_t split = first + count / 2;
+  if (extent > 0.0f) {
+    struct Bin {
+      GLfloat min[3], max[3];
+      uint32_t count;
+    };
+    Bin bins[totalBins];
+    for (Bin& bin : bins) {
+      std::fill(bin.min, bin.min + 3, FLT_MAX);
+      std::fill(bin.max, bin.max + 3, -FLT_MAX);
+      bin.count = 0;
+    }
+    GLfloat factor = totalBins * (1.0f - 1e-5f) / extent;
+    auto binOf = [&bounds, axis, factor, &centroid_min](uint32_t triangle) {
+      const GLfloat* box = &bounds[triangle * boundsStride];
+      return static_cast<int>((box[axis] + box[3 + axis] - centroid_min[axis]) * factor);
+    };
+    for (uint32_t i = first; i < first + count; ++i) {
+      Bin& bin = bins[binOf(m_triangles[i])];
+      grow(bin.min, bin.max, &bounds[m_triangles[i] * boundsStride]);
+      ++bin.count;
+    }
+    // sweep from the right to get areas of right sides, then from the left
+    GLfloat right_cost[totalBins];
+    GLfloat min[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    uint32_t right_count = 0;
+    for (int b = totalBins - 1; b > 0; --b) {
+      if (bins[b].count > 0) {
+        GLfloat box[6] = {bins[b].min[0], bins[b].min[1], bins[b].min[2], bins[b].max[0], bins[b].max[1], bins[b].max[2]};
+        grow(min, max, box);
+      }
+      right_count += bins[b].count;
+      right_cost[b] = right_count > 0 ? right_count * halfArea(min, max) : 0.0f;
+    }
+    std::fill(min, min + 3, FLT_MAX);
+    std::fill(max, max + 3, -FLT_MAX);
+    uint32_t left_count = 0;
+    int best_bin = -1;
+    GLfloat best_cost = count * halfArea(node.min, node.max);  // cost of leaf
+    for (int b = 1; b < totalBins; ++b) {
+      if (bins[b - 1].count > 0) {
+        GLfloat box[6] = {bins[b - 1].min[0], bins[b - 1].min[1], bins[b - 1].min[2], bins[b - 1].max[0], bins[b - 1].max[1], bins[b - 1].max[2]};
+        grow(min, max, box);
+      }
+      left_count += bins[b - 1].count;
+      if (left_count == 0 || left_count == count) {
+        continue;
+      }
+      GLfloat cost = left_count * halfArea(min, max) + right_cost[b];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_bin = b;
+      }
+    }
+    if (best_bin < 0) {
+      return;  // splitting does not pay off
+    }
+    split = std::partition(m_triangles.begin() + first, m_triangles.begin() + first + count,
+        [&binOf, best_bin](uint32_t triangle) { return binOf(triangle) < best_bin; }) - m_triangles.begin();
+  } else {
+    // coincident centroids, split in halves just to bound leaf size
+    split = first + count / 2;
+  }
+
+  uint32_t left_count = split - first;
+  buildNode(bounds, first, left_count, depth + 1);
+  m_nodes[index].first = m_nodes.size();
+  m_nodes[index].count = 0;
+  buildNode(bounds, split, count - left_count, depth + 1);
+}
+
+GLfloat TriangleHierarchy::intersectBox(const GLfloat* min, const GLfloat* max, const GLfloat* origin, const GLfloat* inverse_direction, GLfloat max_distance) {
+  GLfloat t_enter = 0.0f, t_exit = max_distance;
+  for (int k = 0; k < 3; ++k) {
+    GLfloat t0 = (min[k] - origin[k]) * inverse_direction[k];
+    GLfloat t1 = (max[k] - origin[k]) * inverse_direction[k];
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    // NaN from zero direction on the slab plane is skipped by comparisons
+    t_enter = t0 > t_enter ? t0 : t_enter;
+    t_exit = t1 < t_exit ? t1 : t_exit;
+  }
+  return t_enter <= t_exit ? t_enter : -1.0f;
+}
+
+bool TriangleHierarchy::intersect(const Vector3Df& origin, const Vector3Df& direction, Hit* hit) const {
+  if (m_nodes.empty()) {
+    return false;
+  }
+  GLfloat o[3] = {origin[0], origin[1], origin[2]};
+  GLfloat d[3] = {direction[0], direction[1], direction[2]};
+  GLfloat inverse_direction[3] = {1.0f / d[0], 1.0f / d[1], 1.0f / d[2]};
+  bool found = false;
+  uint32_t stack[maxDepth + 4];
+  int top = 0;
+  if (intersectBox(m_nodes[0].min, m_nodes[0].max, o, inverse_direction, hit->distance) < 0.0f) {
+    return false;
+  }
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node& node = m_nodes[stack[--top]];
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        // Moller-Trumbore
+        uint32_t t = m_triangles[i];
+        const GLfloat* p0 = vertex(t, 0);
+        const GLfloat* p1 = vertex(t, 1);
+        const GLfloat* p2 = vertex(t, 2);
+        GLfloat e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        GLfloat e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        GLfloat p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+        GLfloat det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (std::fabs(det) < 1e-12f) {
+          continue;
+        }
+        GLfloat inverse_det = 1.0f / det;
+        GLfloat s[3] = {o[0] - p0[0], o[1] - p0[1], o[2] - p0[2]};
+        GLfloat u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverse_det;
+        if (u < 0.0f || u > 1.0f) {
+          continue;
+        }
+        GLfloat q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+        GLfloat v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inverse_det;
+        if (v < 0.0f || u + v > 1.0f) {
+          continue;
+        }
+        GLfloat distance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverse_det;
+        if (distance >= 0.0f && distance < hit->distance) {
+          hit->triangle = t;
+          hit->distance = distance;
+          hit->u = u;
+          hit->v = v;
+          found = true;
+        }
+      }
+      continue;
+    }
+    // nearer child is pushed last to be visited first
+    uint32_t left = &node - &m_nodes[0] + 1, right = node.first;
+    GLfloat t_left = intersectBox(m_nodes[left].min, m_nodes[left].max, o, inverse_direction, hit->distance);
+    GLfloat t_right = intersectBox(m_nodes[right].min, m_nodes[right].max, o, inverse_direction, hit->distance);
+    if (t_left >= 0.0f && t_right >= 0.0f) {
+      stack[top++] = t_left < t_right ? right : left;
+      stack[top++] = t_left < t_right ? left : right;
+    } else if (t_left >= 0.0f) {
+      stack[top++] = left;
+    } else if (t_right >= 0.0f) {
+      stack[top++] = right;
+    }
+  }
+  return found;
+}
+
+}
@@ -0,0 +1,365 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include "simplifier.h"
+
+
+namespace utils {
+namespace simplifier {
+
+constexpr static const double borderWeight = 10.0;  // border planes keep open edges in place
+constexpr static const double attributeWeight = 0.02;  // fraction of mesh size, which costs the same as attributes jump
+constexpr static const double maxFlipCosine = 0.2;
+
+/// @brief Symmetric 4x4 matrix of squared distances to planes, normalized by total weight.
+struct Quadric {
+  double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+  double weight;
+
+  Quadric() { std::memset(this, 0, sizeof(Quadric)); }
+
+  Quadric(double a, double b, double c, double d, double w)
+    : a2(a * a * w), ab(a * b * w), ac(a * c * w), ad(a * d * w)
+    , b2(b * b * w), bc(b * c * w), bd(b * d * w)
+    , c2(c * c * w), cd(c * d * w), d2(d * d * w)
+    , weight(w) {
+  }
+
+  Quadric& operator += (const Quadric& rhs) {
+    a2 += rhs.a2;  ab += rhs.ab;  ac += rhs.ac;  ad += rhs.ad;
+    b2 += rhs.b2;  bc += rhs.bc;  bd += rhs.bd;
+    c2 += rhs.c2;  cd += rhs.cd;  d2 += rhs.d2;
+    weight += rhs.weight;
+    return *this;
+  }
+
+  double error(const double* p) const {
+    double x = p[0], y = p[1], z = p[2];
+    double value = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                 + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                 + c2 * z * z + 2 * cd * z
+                 + d2;
+    return weight > 0.0 ? std::fabs(value) / weight : 0.0;
+  }
+};
+
+struct Collapse {
+  uint32_t from, to;  // welded positions
+  double cost;
+};
+
+static void normal(const double* p0, const double* p1, const double* p2, double* n) {
+  double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+  double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+  n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+  n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+  n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static double length(const double* v) {
+  return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+GLfloat simplify(const GLfloat* vertices, uint32_t stride, const GLfloat* normals, const GLfloat* texture_coords,
+                 uint32_t total_vertices, const GLuint* indices, uint32_t total_indices,
+                 uint32_t target_indices, std::vector<GLuint>* result) {
+  result->assign(indices, indices + total_indices);
+  if (total_indices <= target_indices || total_vertices == 0) {
+    return 0.0f;
+  }
+
+  // weld vertices by exact position
+  std::vector<uint32_t> position(total_vertices);
+  std::vector<double> coords;
+  {
+    struct KeyHash {
+      size_t operator()(const std::array<uint32_t, 3>& key) const {
+        return (key[0] * 73856093u) ^ (key[1] * 19349663u) ^ (key[2] * 83492791u);
+      }
+    };
+    std::unordered_map<std::array<uint32_t, 3>, uint32_t, KeyHash> welded;
+    welded.reserve(total_vertices);
+    for (uint32_t v = 0; v < total_vertices; ++v) {
+      std::array<uint32_t, 3> key;
+      std::memcpy(&key[0], &vertices[v * stride], sizeof(key));
+      auto it = welded.emplace(key, static_cast<uint32_t>(welded.size())).first;
+      position[v] = it->second;
+      if (it->second * 3 == coords.size()) {
+        coords.push_back(vertices[v * stride + 0]);
+        coords.push_back(vertices[v * stride + 1]);
+        coords.push_back(vertices[v * stride + 2]);
+      }
+    }
+  }
+  uint32_t total_positions = coords.size() / 3;
+  std::vector<uint32_t> position_offsets(total_positions + 1, 0), position_vertices(total_vertices);
+  for (uint32_t v = 0; v < total_vertices; ++v) {
+    ++position_offsets[position[v] + 1];
+  }
+  for (uint32_t p = 0; p < total_positions; ++p) {
+    position_offsets[p + 1] += position_offsets[p];
+  }
+  {
+    std::vector<uint32_t> cursor(position_offsets.begin(), position_offsets.end() - 1);
+    for (uint32_t v = 0; v < total_vertices; ++v) {
+      position_vertices[cursor[position[v]]++] = v;
+    }
+  }
+
+  double min[3] = {coords[0], coords[1], coords[2]}, max[3] = {coords[0], coords[1], coords[2]};
+  for (uint32_t p = 0; p < total_positions; ++p) {
+    for (int k = 0; k < 3; ++k) {
+      min[k] = std::min(min[k], coords[p * 3 + k]);
+      max[k] = std::max(max[k], coords[p * 3 + k]);
+    }
+  }
+  double extent[3] = {max[0] - min[0], max[1] - min[1], max[2] - min[2]};
+  double attribute_scale = attributeWeight * length(extent);
+  attribute_scale *= attribute_scale;
+
+  // quadrics of triangle planes and of planes perpendicular to open edges
+  std::vector<Quadric> quadrics(total_positions);
+  std::vector<uint64_t> edges;
+  std::vector<GLuint>& current = *result;
+  for (size_t t = 0; t + 2 < current.size(); t += 3) {
+    const double* p[3] = {&coords[position[current[t]] * 3], &coords[position[current[t + 1]] * 3], &coords[position[current[t + 2]] * 3]};
+    double n[3];
+    normal(p[0], p[1], p[2], n);
+    double area = length(n);
+    if (area <= 0.0) {
+      continue;
+    }
+    n[0] /= area;  n[1] /= area;  n[2] /= area;
+    Quadric plane(n[0], n[1], n[2], -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]), area * 0.5);
+    for (int k = 0; k < 3; ++k) {
+      quadrics[position[current[t + k]]] += plane;
+      uint64_t a = position[current[t + k]], b = position[current[t + (k + 1) % 3]];
+      edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  for (size_t t = 0; t + 2 < current.size(); t += 3) {
+    const double* p[3] = {&coords[position[current[t]] * 3], &coords[position[current[t + 1]] * 3], &coords[position[current[t + 2]] * 3]};
+    double n[3];
+    normal(p[0], p[1], p[2], n);
+    double area = length(n);
+    if (area <= 0.0) {
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      uint64_t a = position[current[t + k]], b = position[current[t + (k + 1) % 3]];
+      uint64_t key = std::min(a, b) << 32 | std::max(a, b);
+      auto range = std::equal_range(edges.begin(), edges.end(), key);
+      if (range.second - range.first != 1) {
+        continue;
+      }
+      const double* p0 = p[k];
+      const double* p1 = p[(k + 1) % 3];
+      double e[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      double m[3] = {e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0]};
+      double m_length = length(m);
+      if (m_length <= 0.0) {
+        continue;
+      }
+      m[0] /= m_length;  m[1] /= m_length;  m[2] /= m_length;
+      Quadric border(m[0], m[1], m[2], -(m[0] * p0[0] + m[1] * p0[1] + m[2] * p0[2]), (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]) * borderWeight);
+      quadrics[a] += border;
+      quadrics[b] += border;
+    }
+  }
+
+  // attributes difference of vertices; corner moving from vertex u takes the closest vertex at target position
+  auto attributeDistance = [normals, texture_coords](uint32_t u, uint32_t w) {
+    double distance = 0.0;
+    if (normals != nullptr) {
+      distance += 1.0 - (normals[u * 3] * normals[w * 3] + normals[u * 3 + 1] * normals[w * 3 + 1] + normals[u * 3 + 2] * normals[w * 3 + 2]);
+    }
+    if (texture_coords != nullptr) {
+      double du = texture_coords[u * 2] - texture_coords[w * 2], dv = texture_coords[u * 2 + 1] - texture_coords[w * 2 + 1];
+      distance += du * du + dv * dv;
+    }
+    return distance;
+  };
+  std::vector<uint32_t> remap(total_vertices);
+  for (uint32_t v = 0; v < total_vertices; ++v) {
+    remap[v] = v;
+  }
+  auto bestMatch = [&](uint32_t u, uint32_t to, double* distance) {
+    uint32_t best = 0;
+    *distance = -1.0;
+    for (uint32_t i = position_offsets[to]; i < position_offsets[to + 1]; ++i) {
+      uint32_t w = position_vertices[i];
+      if (remap[w] != w) {
+        continue;
+      }
+      double d = attributeDistance(u, w);
+      if (*distance < 0.0 || d < *distance) {
+        *distance = d;
+        best = w;
+      }
+    }
+    return best;
+  };
+
+  double max_cost = 0.0;
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> triangle_offsets, triangles;
+  std::vector<bool> locked(total_positions);
+  while (current.size() > target_indices) {
+    // candidates are both directions of each edge
+    edges.clear();
+    for (size_t t = 0; t + 2 < current.size(); t += 3) {
+      for (int k = 0; k < 3; ++k) {
+        uint64_t a = position[current[t + k]], b = position[current[t + (k + 1) % 3]];
+        edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    collapses.clear();
+    for (uint64_t edge : edges) {
+      uint32_t ends[2] = {static_cast<uint32_t>(edge >> 32), static_cast<uint32_t>(edge & 0xFFFFFFFF)};
+      for (int direction = 0; direction < 2; ++direction) {
+        uint32_t from = ends[direction], to = ends[1 - direction];
+        Quadric quadric = quadrics[from];
+        quadric += quadrics[to];
+        double cost = quadric.error(&coords[to * 3]);
+        double attributes = 0.0;
+        for (uint32_t i = position_offsets[from]; i < position_offsets[from + 1]; ++i) {
+          uint32_t u = position_vertices[i];
+          if (remap[u] != u) {
+            continue;
+          }
+          double distance = 0.0;
+          bestMatch(u, to, &distance);
+          attributes = std::max(attributes, distance);
+        }
+        Collapse collapse = {from, to, cost + attributes * attribute_scale};
+        collapses.push_back(collapse);
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+    // triangles around each position
+    triangle_offsets.assign(total_positions + 1, 0);
+    for (size_t i = 0; i < current.size(); ++i) {
+      ++triangle_offsets[position[current[i]] + 1];
+    }
+    for (uint32_t p = 0; p < total_positions; ++p) {
+      triangle_offsets[p + 1] += triangle_offsets[p];
+    }
+    triangles.resize(current.size());
+    {
+      std::vector<uint32_t> cursor(triangle_offsets.begin(), triangle_offsets.end() - 1);
+      for (size_t i = 0; i < current.size(); ++i) {
+        triangles[cursor[position[current[i]]]++] = i / 3;
+      }
+    }
+
+    // independent collapses of the lowest cost, each one removes two triangles in general
+    std::fill(locked.begin(), locked.end(), false);
+    size_t needed = (current.size() - target_indices) / 6 + 1;
+    size_t applied = 0;
+    for (const Collapse& collapse : collapses) {
+      if (applied >= needed) {
+        break;
+      }
+      if (locked[collapse.from] || locked[collapse.to]) {
+        continue;
+      }
+      bool flipped = false;
+      for (uint32_t i = triangle_offsets[collapse.from]; i < triangle_offsets[collapse.from + 1] && !flipped; ++i) {
+        uint32_t t = triangles[i];
+        uint32_t corners[3] = {position[current[t * 3]], position[current[t * 3 + 1]], position[current[t * 3 + 2]]};
+        if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+          continue;  // degenerates and goes away
+        }
+        const double* before[3] = {&coords[corners[0] * 3], &coords[corners[1] * 3], &coords[corners[2] * 3]};
+        const double* after[3] = {before[0], before[1], before[2]};
+        for (int k = 0; k < 3; ++k) {
+          if (corners[k] == collapse.from) {
+            after[k] = &coords[collapse.to * 3];
+          }
+        }
+        double n0[3], n1[3];
+        normal(before[0], before[1], before[2], n0);
+        normal(after[0], after[1], after[2], n1);
+        double l0 = length(n0), l1 = length(n1);
+        if (l1 <= 0.0 || (l0 > 0.0 && (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2]) < maxFlipCosine * l0 * l1)) {
+          flipped = true;
+        }
+      }
+      if (flipped) {
+        continue;
+      }
+
+      for (uint32_t i = position_offsets[collapse.from]; i < position_offsets[collapse.from + 1]; ++i) {
+        uint32_t u = position_vertices[i];
+        if (remap[u] == u) {
+          double distance = 0.0;
+          remap[u] = bestMatch(u, collapse.to, &distance);
+        }
+      }
+      quadrics[collapse.to] += quadrics[collapse.from];
+      max_cost = std::max(max_cost, collapse.cost);
+      // whole neighbourhood is locked, so that checks above stay valid in this pass
+      for (uint32_t i = triangle_offsets[collapse.from]; i < triangle_offsets[collapse.from + 1]; ++i) {
+        uint32_t t = triangles[i];
+        for (int k = 0; k < 3; ++k) {
+          locked[position[current[t * 3 + k]]] = true;
+        }
+      }
+      locked[collapse.to] = true;
+      ++applied;
+    }
+    if (applied == 0) {
+      break;  // nothing could be collapsed without flips
+    }
+
+    size_t kept = 0;
+    for (size_t t = 0; t + 2 < current.size(); t += 3) {
+      GLuint a = remap[current[t]], b = remap[current[t + 1]], c = remap[current[t + 2]];
+      if (position[a] == position[b] || position[b] == position[c] || position[a] == position[c]) {
+        continue;
+      }
+      current[kept++] = a;
+      current[kept++] = b;
+      current[kept++] = c;
+    }
+    current.resize(kept);
+  }
+  return static_cast<GLfloat>(std::sqrt(max_cost));
+}
+
+}  // namespace simplifier
+}  // namespace utils
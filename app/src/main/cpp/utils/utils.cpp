@@ -26,6 +26,8 @@
  * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cmath>
+
 #include "exceptions.h"
 #include "logger.h"
 #include "rgbstruct.h"
@@ -192,52 +194,61 @@ void setColorBuffer(uint32_t size, GLfloat* buffer, const GLfloat* color) {
   }
 }
 
-void rearrange2(GLuint total_polygons, GLuint* indices, GLfloat* buffer, uint32_t size) {
-  uint32_t raw_polygons = total_polygons * 3;
-  GLfloat* backup = new GLfloat[raw_polygons * 2];
-  for (uint32_t i = 0; i < size; ++i) {
-    backup[i * 2 + 0] = buffer[i * 2 + 0];
-    backup[i * 2 + 1] = buffer[i * 2 + 1];
-  }
-  for (uint32_t i = 0; i < raw_polygons; ++i) {
-    buffer[0 + 2 * i] = backup[0 + 2 * indices[i]];
-    buffer[1 + 2 * i] = backup[1 + 2 * indices[i]];
+void boundingBox(const GLfloat* vertices, uint32_t total, uint32_t stride, Vector3Df* min, Vector3Df* max) {
+  if (total == 0) {
+    *min = Vector3Df(0.0f, 0.0f, 0.0f);
+    *max = *min;
+    return;
+  }
+  *min = Vector3Df(vertices[0], vertices[1], vertices[2]);
+  *max = *min;
+  for (uint32_t i = 1; i < total; ++i) {
+    const GLfloat* vertex = &vertices[i * stride];
+    for (int k = 0; k < 3; ++k) {
+      if (vertex[k] < (*min)[k]) (*min)[k] = vertex[k];
+      if (vertex[k] > (*max)[k]) (*max)[k] = vertex[k];
+    }
+  }
+}
+
+void boundingSphere(const GLfloat* vertices, uint32_t total, uint32_t stride, Vector3Df* center, GLfloat* radius) {
+  if (total == 0) {
+    *center = Vector3Df(0.0f, 0.0f, 0.0f);
+    *radius = 0.0f;
+    return;
+  }
+  // center of axis-aligned box, then farthest vertex from it
+  Vector3Df min, max;
+  boundingBox(vertices, total, stride, &min, &max);
+  *center = (min + max) / 2.0f;
+  GLfloat squared_radius = 0.0f;
+  for (uint32_t i = 0; i < total; ++i) {
+    const GLfloat* vertex = &vertices[i * stride];
+    GLfloat dx = vertex[0] - (*center)[0], dy = vertex[1] - (*center)[1], dz = vertex[2] - (*center)[2];
+    GLfloat squared_distance = dx * dx + dy * dy + dz * dz;
+    if (squared_distance > squared_radius) squared_radius = squared_distance;
+  }
+  *radius = std::sqrt(squared_radius);
+}
+
+void faceNormals(const GLfloat* vertices, uint32_t stride, uint32_t total_polygons, GLfloat* normals) {
+  for (uint32_t pi = 0; pi < total_polygons; ++pi) {
+    const GLfloat* a = &vertices[(pi * 3 + 0) * stride];
+    const GLfloat* b = &vertices[(pi * 3 + 1) * stride];
+    const GLfloat* c = &vertices[(pi * 3 + 2) * stride];
+    GLfloat ux = b[0] - a[0], uy = b[1] - a[1], uz = b[2] - a[2];
+    GLfloat vx = c[0] - a[0], vy = c[1] - a[1], vz = c[2] - a[2];
+    GLfloat nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+    GLfloat length = std::sqrt(nx * nx + ny * ny + nz * nz);
+    if (length > 0.0f) {
+      nx /= length;  ny /= length;  nz /= length;
+    }  // degenerate triangles cover no pixels, zero normal is harmless
+    for (int k = 0; k < 3; ++k) {
+      normals[(pi * 3 + k) * 3 + 0] = nx;
+      normals[(pi * 3 + k) * 3 + 1] = ny;
+      normals[(pi * 3 + k) * 3 + 2] = nz;
+    }
   }
-  delete [] backup;  backup = nullptr;
-}
-
-void rearrange3(GLuint total_polygons, GLuint* indices, GLfloat* buffer, uint32_t size) {
-  uint32_t raw_polygons = total_polygons * 3;
-  GLfloat* backup = new GLfloat[raw_polygons * 3];
-  for (uint32_t i = 0; i < size; ++i) {
-    backup[i * 3 + 0] = buffer[i * 3 + 0];
-    backup[i * 3 + 1] = buffer[i * 3 + 1];
-    backup[i * 3 + 2] = buffer[i * 3 + 2];
-  }
-  for (uint32_t i = 0; i < raw_polygons; ++i) {
-    buffer[0 + 3 * i] = backup[0 + 3 * indices[i]];
-    buffer[1 + 3 * i] = backup[1 + 3 * indices[i]];
-    buffer[1 + 3 * i] = backup[1 + 3 * indices[i]];
-  }
-  delete [] backup;  backup = nullptr;
-}
-
-void rearrange4(GLuint total_polygons, GLuint* indices, GLfloat* buffer, uint32_t size) {
-  uint32_t raw_polygons = total_polygons * 3;
-  GLfloat* backup = new GLfloat[raw_polygons * 4];
-  for (uint32_t i = 0; i < size; ++i) {
-    backup[i * 4 + 0] = buffer[i * 4 + 0];
-    backup[i * 4 + 1] = buffer[i * 4 + 1];
-    backup[i * 4 + 2] = buffer[i * 4 + 2];
-    backup[i * 4 + 3] = buffer[i * 4 + 3];
-  }
-  for (uint32_t i = 0; i < raw_polygons; ++i) {
-    buffer[0 + 4 * i] = backup[0 + 4 * indices[i]];
-    buffer[1 + 4 * i] = backup[1 + 4 * indices[i]];
-    buffer[1 + 4 * i] = backup[1 + 4 * indices[i]];
-    buffer[1 + 4 * i] = backup[1 + 4 * indices[i]];
-  }
-  delete [] backup;  backup = nullptr;
 }
 
 void print2(GLuint* buffer, size_t size) {
@@ -0,0 +1,222 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include "edge.h"
+#include "JobSystem.h"
+#include "wireframe.h"
+
+
+namespace utils {
+namespace wireframe {
+
+constexpr static const uint32_t trianglesPerThread = 16384;
+constexpr static const uint32_t emptySlot = 0xFFFFFFFF;
+constexpr static const uint32_t nonManifold = 0xFFFFFFFE;  // third face met on the edge
+constexpr static const uint64_t emptyEdge = ~0ull;
+
+static uint32_t capacityFor(uint32_t total) {
+  uint32_t capacity = 16;
+  while (capacity < total + total / 4) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+static inline uint32_t mix(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xFF51AFD7ED558CCDull;
+  value ^= value >> 33;
+  return static_cast<uint32_t>(value);
+}
+
+/// @brief Runs function(chunk, begin, end) over contiguous chunks of [0, total) on the shared job system.
+template <typename Function>
+static void parallelChunks(uint32_t total, uint32_t total_chunks, Function function) {
+  JobSystem::get().parallelChunks(total, total_chunks, [&function](unsigned int chunk, size_t begin, size_t end) {
+    function(chunk, static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+  });
+}
+
+// ----------------------------------------------------------------------------
+uint32_t buildEdges(const GLfloat* vertices, uint32_t stride, uint32_t total_vertices,
+                    const GLushort* indices, uint32_t total_triangles,
+                    GLfloat feature_angle, std::vector<GLuint>* edges) {
+  edges->clear();
+  if (total_triangles == 0 || total_vertices == 0) {
+    return 0;
+  }
+  uint32_t total_threads = std::max(1u, std::min(JobSystem::get().concurrency(), total_triangles / trianglesPerThread));
+  auto corner = [indices](uint32_t triangle, uint32_t k) -> GLuint {
+    return indices != nullptr ? indices[triangle * 3 + k] : triangle * 3 + k;
+  };
+
+  // weld equal positions: the vertex which has taken the slot represents all others
+  uint32_t weld_capacity = capacityFor(total_vertices * 2);
+  std::atomic<uint32_t>* weld_slots = new std::atomic<uint32_t>[weld_capacity];
+  GLuint* welded = new GLuint[total_vertices];
+  parallelChunks(weld_capacity, total_threads, [weld_slots](uint32_t, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+      weld_slots[i].store(emptySlot, std::memory_order_relaxed);
+    }
+  });
+  parallelChunks(total_vertices, total_threads, [&](uint32_t, uint32_t begin, uint32_t end) {
+    for (uint32_t vi = begin; vi < end; ++vi) {
+      const GLfloat* position = &vertices[vi * stride];
+      uint32_t bits[3];
+      for (int k = 0; k < 3; ++k) {
+        GLfloat value = position[k] + 0.0f;  // -0 and +0 weld together
+        std::memcpy(&bits[k], &value, sizeof(GLfloat));
+      }
+      uint32_t slot = mix((static_cast<uint64_t>(bits[0]) << 32 | bits[1]) ^ (static_cast<uint64_t>(bits[2]) * 0x9E3779B97F4A7C15ull));
+      while (true) {
+        slot &= weld_capacity - 1;
+        uint32_t owner = emptySlot;
+        if (weld_slots[slot].compare_exchange_strong(owner, vi, std::memory_order_acq_rel)) {
+          welded[vi] = vi;
+          break;
+        }
+        const GLfloat* other = &vertices[owner * stride];
+        if (other[0] == position[0] && other[1] == position[1] && other[2] == position[2]) {
+          welded[vi] = owner;
+          break;
+        }
+        ++slot;
+      }
+    }
+  });
+  delete [] weld_slots;  weld_slots = nullptr;
+
+  // face normals are needed for dihedral angles only
+  GLfloat* normals = nullptr;
+  if (feature_angle > 0.0f) {
+    normals = new GLfloat[total_triangles * 3];
+    parallelChunks(total_triangles, total_threads, [&](uint32_t, uint32_t begin, uint32_t end) {
+      for (uint32_t ti = begin; ti < end; ++ti) {
+        const GLfloat* a = &vertices[corner(ti, 0) * stride];
+        const GLfloat* b = &vertices[corner(ti, 1) * stride];
+        const GLfloat* c = &vertices[corner(ti, 2) * stride];
+        GLfloat ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        GLfloat ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        GLfloat* normal = &normals[ti * 3];
+        normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+        normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+        normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+        GLfloat length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length > 0.0f) {
+          normal[0] /= length;  normal[1] /= length;  normal[2] /= length;
+        }
+      }
+    });
+  }
+
+  // hash edges of all triangles, remembering up to two adjacent faces per edge
+  uint32_t edge_capacity = capacityFor(total_triangles * 3);
+  std::atomic<uint64_t>* keys = new std::atomic<uint64_t>[edge_capacity];
+  std::atomic<uint32_t>* faces = new std::atomic<uint32_t>[edge_capacity * 2];
+  parallelChunks(edge_capacity, total_threads, [keys, faces](uint32_t, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+      keys[i].store(emptyEdge, std::memory_order_relaxed);
+      faces[i * 2].store(emptySlot, std::memory_order_relaxed);
+      faces[i * 2 + 1].store(emptySlot, std::memory_order_relaxed);
+    }
+  });
+  parallelChunks(total_triangles, total_threads, [&](uint32_t, uint32_t begin, uint32_t end) {
+    for (uint32_t ti = begin; ti < end; ++ti) {
+      for (uint32_t k = 0; k < 3; ++k) {
+        GLuint v0 = welded[corner(ti, k)];
+        GLuint v1 = welded[corner(ti, (k + 1) % 3)];
+        if (v0 == v1) {
+          continue;  // collapsed by welding
+        }
+        uint64_t key = Edge(v0, v1).key();
+        uint32_t slot = mix(key);
+        while (true) {
+          slot &= edge_capacity - 1;
+          uint64_t current = emptyEdge;
+          if (keys[slot].compare_exchange_strong(current, key, std::memory_order_acq_rel) || current == key) {
+            break;
+          }
+          ++slot;
+        }
+        uint32_t face = emptySlot;
+        if (!faces[slot * 2].compare_exchange_strong(face, ti, std::memory_order_relaxed)) {
+          face = emptySlot;
+          if (!faces[slot * 2 + 1].compare_exchange_strong(face, ti, std::memory_order_relaxed)) {
+            faces[slot * 2 + 1].store(nonManifold, std::memory_order_relaxed);
+          }
+        }
+      }
+    }
+  });
+  delete [] welded;  welded = nullptr;
+
+  // select edges per chunk of table, then merge and sort for locality of vertex fetch
+  GLfloat min_cosine = std::cos(feature_angle * static_cast<GLfloat>(M_PI) / 180.0f);
+  std::vector<std::vector<uint64_t>> selected(total_threads);
+  parallelChunks(edge_capacity, total_threads, [&](uint32_t thread, uint32_t begin, uint32_t end) {
+    std::vector<uint64_t>& output = selected[thread];
+    for (uint32_t slot = begin; slot < end; ++slot) {
+      uint64_t key = keys[slot].load(std::memory_order_relaxed);
+      if (key == emptyEdge) {
+        continue;
+      }
+      uint32_t f0 = faces[slot * 2].load(std::memory_order_relaxed);
+      uint32_t f1 = faces[slot * 2 + 1].load(std::memory_order_relaxed);
+      if (normals != nullptr && f1 != emptySlot && f1 != nonManifold) {
+        const GLfloat* n0 = &normals[f0 * 3];
+        const GLfloat* n1 = &normals[f1 * 3];
+        if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] > min_cosine) {
+          continue;  // smooth enough, not a feature
+        }
+      }
+      output.push_back(key);
+    }
+  });
+  delete [] keys;  keys = nullptr;
+  delete [] faces;  faces = nullptr;
+  delete [] normals;  normals = nullptr;
+
+  std::vector<uint64_t> sorted;
+  for (std::vector<uint64_t>& output : selected) {
+    sorted.insert(sorted.end(), output.begin(), output.end());
+  }
+  std::sort(sorted.begin(), sorted.end());
+  edges->resize(sorted.size() * 2);
+  for (size_t ei = 0; ei < sorted.size(); ++ei) {
+    (*edges)[ei * 2] = static_cast<GLuint>(sorted[ei] >> 32);
+    (*edges)[ei * 2 + 1] = static_cast<GLuint>(sorted[ei] & 0xFFFFFFFF);
+  }
+  return static_cast<uint32_t>(sorted.size());
+}
+
+}  // namespace wireframe
+}  // namespace utils
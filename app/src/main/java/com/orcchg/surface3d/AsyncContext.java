@@ -29,6 +29,7 @@
 package com.orcchg.surface3d;
 
 import android.content.res.AssetManager;
+import android.view.MotionEvent;
 import android.view.Surface;
 
 class AsyncContext {
@@ -39,6 +40,7 @@ class AsyncContext {
   }
   
   OnFireEventFromAsyncContext fireEventListener;
+  private final float[] frameStatistics = new float[NativeEvent.TOTAL_FRAME_STATS];
   
   AsyncContext() {
     descriptor = initContext();
@@ -69,6 +71,52 @@ class AsyncContext {
     nativeRotate(descriptor, x, y, z, x_angle, y_angle, z_angle);
   }
   void zoom(float scale_x, float scale_y, float scale_z) { nativeZoom(descriptor, scale_x, scale_y, scale_z); }
+  
+  /* Raw touches, recognized into gestures natively; must match gesture::Touch */
+  private static final int TOUCH_DOWN = 0;
+  private static final int TOUCH_MOVE = 1;
+  private static final int TOUCH_UP = 2;
+  private static final int TOUCH_POINTER_DOWN = 3;
+  private static final int TOUCH_POINTER_UP = 4;
+  private static final int TOUCH_CANCEL = 5;
+  private static final int TOUCH_SAMPLE_SIZE = 7;  // dt, action, pointers, x0, y0, x1, y1
+  
+  private float[] touchSamples = new float[TOUCH_SAMPLE_SIZE * 8];
+  private long lastTouchTime = 0;
+  
+  // event with all its historical samples is passed in a single call
+  void touch(final MotionEvent event) {
+    int action;
+    switch (event.getActionMasked()) {
+      case MotionEvent.ACTION_DOWN: action = TOUCH_DOWN; break;
+      case MotionEvent.ACTION_MOVE: action = TOUCH_MOVE; break;
+      case MotionEvent.ACTION_UP: action = TOUCH_UP; break;
+      case MotionEvent.ACTION_POINTER_DOWN: action = TOUCH_POINTER_DOWN; break;
+      case MotionEvent.ACTION_POINTER_UP: action = TOUCH_POINTER_UP; break;
+      case MotionEvent.ACTION_CANCEL: action = TOUCH_CANCEL; break;
+      default: return;
+    }
+    int history = action == TOUCH_MOVE ? event.getHistorySize() : 0;
+    int total = history + 1;
+    if (touchSamples.length < total * TOUCH_SAMPLE_SIZE) {
+      touchSamples = new float[total * TOUCH_SAMPLE_SIZE];
+    }
+    int pointers = Math.min(event.getPointerCount(), 2);
+    for (int h = 0; h < total; ++h) {
+      boolean current = h == history;
+      long time = current ? event.getEventTime() : event.getHistoricalEventTime(h);
+      int offset = h * TOUCH_SAMPLE_SIZE;
+      touchSamples[offset + 0] = lastTouchTime == 0 ? 0.0f : (float) (time - lastTouchTime);
+      touchSamples[offset + 1] = current ? action : TOUCH_MOVE;
+      touchSamples[offset + 2] = pointers;
+      touchSamples[offset + 3] = current ? event.getX(0) : event.getHistoricalX(0, h);
+      touchSamples[offset + 4] = current ? event.getY(0) : event.getHistoricalY(0, h);
+      touchSamples[offset + 5] = pointers < 2 ? 0.0f : current ? event.getX(1) : event.getHistoricalX(1, h);
+      touchSamples[offset + 6] = pointers < 2 ? 0.0f : current ? event.getY(1) : event.getHistoricalY(1, h);
+      lastTouchTime = time;
+    }
+    nativeTouch(descriptor, touchSamples, total);
+  }
 
   TranslationSignature getCurrentTranslation() {
     TranslationSignature sig = new TranslationSignature();
@@ -113,7 +161,20 @@ class AsyncContext {
   }
   
   AsyncContextError getError() {
-    int error_code = nativeGetError(descriptor);
+    return toError(nativeGetError(descriptor));
+  }
+  
+  /**
+   * Statistics of the last rendered frame, delivered from native code at limited rate
+   * @param key one of NativeEvent.STATS_* constants
+   */
+  float getFrameStatistic(int key) {
+    synchronized (frameStatistics) {
+      return frameStatistics[key];
+    }
+  }
+  
+  private static AsyncContextError toError(int error_code) {
     switch (error_code) {
       default:
       case 0: return AsyncContextError.ACONTEXT_OK;
@@ -125,17 +186,60 @@ class AsyncContext {
   
   void setVertexLimit(int limit) { nativeSetVertexLimit(descriptor, limit); }
   void setDrawType(int type) { nativeSetDrawType(descriptor, type); }
+  void setFlatShading(boolean enabled) { nativeSetFlatShading(descriptor, enabled); }
   void setBackgroundColor(final String bgColor) { nativeSetBackgroundColor(descriptor, bgColor); }
   void showAxis(boolean isVisible) { nativeShowAxis(descriptor, isVisible); }
   
+  /* GPU memory, bytes; zero budget means unlimited */
+  static final int GPU_TEXTURES = 0;
+  static final int GPU_BUFFERS = 1;
+  
+  long getGpuMemory(int category) { return nativeGetGpuMemory(descriptor, category); }
+  long getGpuMemoryBudget(int category) { return nativeGetGpuMemoryBudget(descriptor, category); }
+  void setGpuMemoryBudget(int category, long bytes) { nativeSetGpuMemoryBudget(descriptor, category, bytes); }
+  
+  PickResult pick(float x, float y) {
+    int[] indices = new int[3];
+    float[] values = new float[5];
+    if (!nativePick(descriptor, x, y, indices, values)) {
+      return null;
+    }
+    PickResult result = new PickResult();
+    result.mesh = indices[0];
+    result.instance = indices[1];
+    result.triangle = indices[2];
+    result.u = values[0];
+    result.v = values[1];
+    result.x = values[2];
+    result.y = values[3];
+    result.z = values[4];
+    return result;
+  }
+  
   void uploadMesh(long mesh_descriptor) { uploadMesh(descriptor, mesh_descriptor); }
   void uploadTexturedMesh(long mesh_descriptor) { uploadTexturedMesh(descriptor, mesh_descriptor); }
   void uploadScene(long scene_descriptor) { uploadScene(descriptor, scene_descriptor); }
   
   /* Event firing */
   // --------------------------------------------------------------------------
-  private void fireStringEventFromAsyncContext(final String message) {
-    fireEventListener.onFireEvent(message);
+  private void fireEventsFromAsyncContext(int count, int[] codes, float[] values) {
+    for (int i = 0; i < count; ++i) {
+      int code = NativeEvent.code(codes, i);
+      switch (NativeEvent.type(codes, i)) {
+        case NativeEvent.STATS:
+          if (code < NativeEvent.TOTAL_FRAME_STATS) {
+            synchronized (frameStatistics) {
+              frameStatistics[code] = values[i];
+            }
+          }
+          break;
+        case NativeEvent.ERROR:
+          if (fireEventListener != null) {
+            fireEventListener.onFireEvent(toError(code));
+          }
+          break;
+      }
+    }
   }
   
   /* Private methods */
@@ -156,6 +260,7 @@ class AsyncContext {
   private native void nativeTranslate(long descriptor, float x, float y, float z);
   private native void nativeRotate(long descriptor, boolean x, boolean y, boolean z, float x_angle, float y_angle, float z_angle);
   private native void nativeZoom(long descriptor, float scale_x, float scale_y, float scale_z);
+  private native void nativeTouch(long descriptor, float[] samples, int count);
   
   // get translation | rotation | zoom parameters of scene
   private native float nativeGetTranslationX(long descriptor);
@@ -184,8 +289,13 @@ class AsyncContext {
   
   private native void nativeSetVertexLimit(long descriptor, int limit);
   private native void nativeSetDrawType(long descriptor, int type);
+  private native void nativeSetFlatShading(long descriptor, boolean enabled);
   private native void nativeSetBackgroundColor(long descriptor, final String bgColor);
   private native void nativeShowAxis(long descriptor, boolean isVisible);
+  private native long nativeGetGpuMemory(long descriptor, int category);
+  private native long nativeGetGpuMemoryBudget(long descriptor, int category);
+  private native void nativeSetGpuMemoryBudget(long descriptor, int category, long bytes);
+  private native boolean nativePick(long descriptor, float x, float y, int[] indices, float[] values);
   
   private native void uploadMesh(long descriptor, long mesh_descriptor);
   private native void uploadTexturedMesh(long descriptor, long mesh_descriptor);
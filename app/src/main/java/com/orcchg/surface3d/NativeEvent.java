@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2015, Alov Maxim <alovmax@yandex.ru>
+ * 
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ * and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided with
+ * the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+package com.orcchg.surface3d;
+
+/**
+ * Events delivered from native code in batches: codes hold pairs of type and code,
+ * values hold one value per event. Constants mirror EventChannel.h, Scene.h and AsyncContext.h
+ */
+final class NativeEvent {
+  static final int PROGRESS = 0;  // value - percents
+  static final int STAGE = 1;     // code - stage, value - step within stage
+  static final int STATS = 2;     // code - statistic key, value - its value
+  static final int ERROR = 3;     // code - error code
+  
+  /* Import stages */
+  static final int STAGE_READ = 0;
+  static final int STAGE_POST_PROCESS = 1;
+  
+  /* Frame statistics */
+  static final int STATS_DRAW_CALLS = 0;
+  static final int STATS_DRAWN_MESHES = 1;
+  static final int STATS_DRAWN_POLYGONS = 2;
+  static final int STATS_DRAWN_EDGES = 3;
+  static final int STATS_DRAWN_POINTS = 4;
+  static final int STATS_CULLED_MESHES = 5;
+  static final int TOTAL_FRAME_STATS = 6;
+  
+  static int type(int[] codes, int index) { return codes[index * 2]; }
+  static int code(int[] codes, int index) { return codes[index * 2 + 1]; }
+  
+  private NativeEvent() {}
+}
@@ -86,9 +86,11 @@ final class Scene extends NativeObject {
     this();
     this.viewRef = new WeakReference<Surface3DView>(view);
     this.listenerRef = new WeakReference<LoadSceneProgressListener>(view.mSceneListener);
+    nativeSetImportProfile(descriptor, view.getImportProfile().getValue());  // before import thread starts
   }
   
   private static native void nativeInit();
+  private native void nativeSetImportProfile(long descriptor, int profile);
   
   /* Get scene info */
   // --------------------------------------------
@@ -127,11 +129,23 @@ final class Scene extends NativeObject {
   
   /* Async Task */
   // --------------------------------------------------------------------------
-  private void publishProgress(float progress) {
-    if (listenerRef != null) {
-      final LoadSceneProgressListener listener = listenerRef.get();
-      if (listener != null) {
-        listener.setProgress(progress);
+  /**
+   * Receives coalesced events of import from native code, progress is delivered at limited rate
+   */
+  private void publishEvents(int count, int[] codes, float[] values) {
+    for (int i = 0; i < count; ++i) {
+      switch (NativeEvent.type(codes, i)) {
+        case NativeEvent.PROGRESS:
+          if (listenerRef != null) {
+            final LoadSceneProgressListener listener = listenerRef.get();
+            if (listener != null) {
+              listener.setProgress(values[i]);
+            }
+          }
+          break;
+        case NativeEvent.STAGE:
+          Log.d(TAG, "Import stage " + NativeEvent.code(codes, i) + ", step " + (int) values[i]);
+          break;
       }
     }
   }
@@ -82,6 +82,7 @@ public class Surface3DView extends SurfaceView {
   private int height;
   
   private boolean showProgressBar = true;
+  private ImportProfile mImportProfile = ImportProfile.QUALITY;
   private boolean showProgressBarAtEvent = false;
   private float mProgress = 0;
   private Paint mPaint1, mPaint2;
@@ -120,6 +121,17 @@ public class Surface3DView extends SurfaceView {
     }
   }
   
+  /**
+   * Post processing of imported scenes: QUALITY smooths normals over vertices close in space,
+   * which is slow on large scans, FAST accumulates them through shared indices. QUALITY by default
+   */
+  public static enum ImportProfile {
+    QUALITY(0), FAST(1);
+    private int value;
+    ImportProfile(int value) { this.value = value; }
+    public int getValue() { return value; }
+  }
+  
   public interface ModelLoadedListener {
     public void onLoaded(SceneInfo scene_info);
     public void onFailed(String message);
@@ -237,6 +249,17 @@ public class Surface3DView extends SurfaceView {
     showProgressBar = flag;
   }
   
+  /**
+   * Applied to resources loaded afterwards
+   */
+  public void setImportProfile(ImportProfile profile) {
+    mImportProfile = profile;
+  }
+  
+  public ImportProfile getImportProfile() {
+    return mImportProfile;
+  }
+  
   public void setVertexLimit(int limit) {
     acontext.setVertexLimit(limit);
   }
@@ -255,6 +278,13 @@ public class Surface3DView extends SurfaceView {
     }
   }
   
+  /**
+   * Draws meshes lit and colored per triangle, loaded scene is uploaded again.
+   */
+  public void setFlatShading(boolean enabled) {
+    acontext.setFlatShading(enabled);
+  }
+  
   @Override
   public void setBackgroundColor(int color) {
     String bgColor = String.format("#%08X", (0xFFFFFFFF & color));
@@ -349,6 +379,14 @@ public class Surface3DView extends SurfaceView {
     return acontext.getCurrentZoom();
   }
   
+  /**
+   * Finds what is drawn under point (x, y) of this view.
+   * @return null, if there is nothing or scene is still being uploaded
+   */
+  public PickResult pick(float x, float y) {
+    return acontext.pick(x, y);
+  }
+  
   /* Draw on Canvas */
   // --------------------------------------------------------------------------
   @Override
@@ -441,6 +479,11 @@ public class Surface3DView extends SurfaceView {
       public void onMoveAction_PointerUp(final MotionEvent event) {
         onMoveAction_PointerUp_S3D(event);
       }
+      
+      @Override
+      public void onMoveAction_Cancel(final MotionEvent event) {
+        onMoveAction_Cancel_S3D(event);
+      }
     });
   }
   
@@ -472,47 +515,38 @@ public class Surface3DView extends SurfaceView {
   
   /* Move actions */
   // --------------------------------------------------------------------------
+  // raw touches are passed to native side, which recognizes rotation, drag and pinch
+  // and keeps released view moving by inertia
   protected void onMoveAction_Down_S3D(final MotionEvent event) {
-    mMotionStat.setBase(event.getX(), event.getY());
+    acontext.touch(event);
   }
   
   protected void onMoveAction_Move_S3D(final MotionEvent event) {
-    mMotionStat.rotate(event);
-    acontext.rotate(
-      mMotionStat.m_rot_sig.x,
-      mMotionStat.m_rot_sig.y,
-      mMotionStat.m_rot_sig.z,
-      mMotionStat.m_rot_sig.x_angle,
-      mMotionStat.m_rot_sig.y_angle,
-      mMotionStat.m_rot_sig.z_angle);
+    acontext.touch(event);
   }
 
   protected void onMoveAction_Up_S3D(final MotionEvent event) {
-    mMotionStat.clearMaintainedSwipeDirection();
-    mMotionStat.stopDrag(event);
+    acontext.touch(event);
   }
   
   protected void onMoveAction_PointerDown_S3D(final MotionEvent event) {
+    acontext.touch(event);
   }
   
   protected void onMoveAction_Pinch_S3D(final MotionEvent event) {
-    mMotionStat.pinch(event);
-    acontext.zoom(
-      mMotionStat.m_zoom_sig.scale_x,
-      mMotionStat.m_zoom_sig.scale_y,
-      mMotionStat.m_zoom_sig.scale_z);
+    acontext.touch(event);
   }
   
   protected void onMoveAction_Drag_S3D(final MotionEvent event) {
-    mMotionStat.drag(event);
-    acontext.translate(
-      mMotionStat.m_drag_sig.x,
-      mMotionStat.m_drag_sig.y,
-      mMotionStat.m_drag_sig.z);
+    acontext.touch(event);
   }
   
   protected void onMoveAction_PointerUp_S3D(final MotionEvent event) {
-    mMotionStat.stopPinch(event);
+    acontext.touch(event);
+  }
+  
+  protected void onMoveAction_Cancel_S3D(final MotionEvent event) {
+    acontext.touch(event);
   }
   
   /* Inner classes */
@@ -529,7 +563,7 @@ public class Surface3DView extends SurfaceView {
       final Surface3DView view = viewRef.get();
       if (view != null) {
         if (view.mNativeEventListener != null) {
-          Log.i(TAG, "Message from native: " + (String) data[0] + ", error code: " + view.acontext.getError());
+          Log.i(TAG, "Error from native: " + data[0]);
           view.mNativeEventListener.onEvent(MODEL_LOAD_FAILURE);
         }
       }
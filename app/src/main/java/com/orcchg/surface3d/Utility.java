@@ -41,7 +41,8 @@ class Utility {
     "mng" /* 1013 */, "pal" /* 1014 */, "pbm" /* 1015 */, "pcd"  /* 1016 */,
     "pcx" /* 1017 */, "pgm" /* 1018 */, "pic" /* 1019 */, "png"  /* 1020 */,
     "ppm" /* 1021 */, "psd" /* 1022 */, "psp" /* 1023 */, "raw"  /* 1024 */,
-    "sgi" /* 1025 */, "tga" /* 1026 */, "tif" /* 1027 */
+    "sgi" /* 1025 */, "tga" /* 1026 */, "tif" /* 1027 */, null  /* 1028 */,  // IL, not a file
+    "ktx" /* 1029 */, "pkm" /* 1030 */, "ktx2" /* 1031 */  // compressed texture containers
   };
   
   static MeshFileType getMeshFileType(final String filename) {